@@ -0,0 +1,142 @@
+#include <InteractiveToolkit-Extension/atlas/Atlas.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace ITKExtension::Atlas;
+
+// Atlas::organizePositions: the legacy packer (fast and slow mode) against the
+// Skyline and MaxRects-BSSF packers. Reports the texture size, the occupancy
+// (element area over texture area) and the time. Every result is checked for
+// elements outside the texture or overlapping.
+//
+// usage: benchmark-Atlas [legacy fast limit] [legacy slow limit]
+// (the legacy packer is quadratic, it only runs up to the given element counts,
+// default 1000 in fast mode and 100 in slow mode)
+
+struct ElementSize
+{
+    int w;
+    int h;
+};
+
+enum class Packer : int
+{
+    LegacyFast,
+    LegacySlow,
+    Skyline,
+    MaxRects
+};
+
+static const char *packer_name(Packer packer)
+{
+    switch (packer)
+    {
+    case Packer::LegacyFast:
+        return "legacy fast";
+    case Packer::LegacySlow:
+        return "legacy slow";
+    case Packer::Skyline:
+        return "Skyline";
+    default:
+        return "MaxRectsBSSF";
+    }
+}
+
+// glyphs: small, similar heights. sprites: mixed sizes.
+static std::vector<ElementSize> make_sizes(int count, bool sprites, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::vector<ElementSize> result;
+    for (int i = 0; i < count; i++)
+    {
+        if (sprites)
+            result.push_back({8 + (int)(random() % 200), 8 + (int)(random() % 200)});
+        else
+            result.push_back({6 + (int)(random() % 30), 12 + (int)(random() % 28)});
+    }
+    return result;
+}
+
+static bool valid_placement(const Atlas &atlas, const std::vector<std::shared_ptr<AtlasElement>> &elements)
+{
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        if (!elements[i]->rect.inside(atlas.textureResolution, atlas.xspacing / 2, atlas.yspacing / 2))
+            return false;
+        for (size_t j = i + 1; j < elements.size(); j++)
+            if (elements[i]->rect.overlaps(elements[j]->rect, atlas.xspacing, atlas.yspacing))
+                return false;
+    }
+    return true;
+}
+
+static void run(const char *label, const std::vector<ElementSize> &sizes, int spacing, Packer packer)
+{
+    Atlas atlas(spacing, spacing);
+    std::vector<std::shared_ptr<AtlasElement>> elements;
+    double element_area = 0.0;
+    for (const auto &size : sizes)
+    {
+        elements.push_back(atlas.addElement("element", size.w, size.h));
+        element_area += (double)size.w * (double)size.h;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    switch (packer)
+    {
+    case Packer::LegacyFast:
+        atlas.organizePositions(true);
+        break;
+    case Packer::LegacySlow:
+        atlas.organizePositions(false);
+        break;
+    case Packer::Skyline:
+        atlas.organizePositions(PackingAlgorithm::Skyline);
+        break;
+    case Packer::MaxRects:
+        atlas.organizePositions(PackingAlgorithm::MaxRectsBSSF);
+        break;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    double texture_area = (double)atlas.textureResolution.w * (double)atlas.textureResolution.h;
+    printf("%8s %6zu %14s %6dx%-6d %9.3f %12.2f %s\n", label, sizes.size(), packer_name(packer),
+           atlas.textureResolution.w, atlas.textureResolution.h,
+           element_area / texture_area, ms,
+           valid_placement(atlas, elements) ? "ok" : "INVALID");
+}
+
+int main(int argc, char **argv)
+{
+    int legacy_fast_limit = (argc > 1) ? atoi(argv[1]) : 1000;
+    int legacy_slow_limit = (argc > 2) ? atoi(argv[2]) : 100;
+
+    printf("%8s %6s %14s %13s %9s %12s\n", "set", "count", "packer", "texture", "occupancy", "ms");
+
+    const int counts[] = {100, 1000, 5000};
+    for (int sprites = 0; sprites < 2; sprites++)
+        for (int count : counts)
+        {
+            std::vector<ElementSize> sizes = make_sizes(count, sprites != 0, (unsigned)(count + sprites));
+            const char *label = sprites ? "sprites" : "glyphs";
+            for (int p = 0; p < 4; p++)
+            {
+                Packer packer = (Packer)p;
+                if ((packer == Packer::LegacyFast && count > legacy_fast_limit) ||
+                    (packer == Packer::LegacySlow && count > legacy_slow_limit))
+                    continue;
+                run(label, sizes, 2, packer);
+            }
+        }
+
+    // equal squares, the size search must find the square texture
+    std::vector<ElementSize> squares(100, {100, 100});
+    for (int p = 0; p < 4; p++)
+        run("squares", squares, 0, (Packer)p);
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <InteractiveToolkit-Extension/hashing/Bcrypt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+using namespace ITKExtension::Hashing;
+
+// Bcrypt::hash per cost against a reference of the rolled EksBlowfish cost loop
+// (16 Feistel rounds in a loop, the key bytes cycled on every ExpandKey call).
+//
+// The reference runs the same 2^cost ExpandKey(state, 0, password) and
+// ExpandKey(state, 0, salt) pairs on a state filled with arbitrary words: the
+// work does not depend on the values, so the timings are comparable.
+//
+// Then Bcrypt::recommendCost is run for a latency budget, with all cores hashing.
+//
+// usage: benchmark-Bcrypt [max cost] [latency budget ms]
+
+struct RolledBlowfish
+{
+    uint32_t P[18];
+    uint32_t S[4][256];
+
+    RolledBlowfish()
+    {
+        uint32_t x = 0x243f6a88;
+        for (int i = 0; i < 18; i++)
+            P[i] = x = x * 1664525u + 1013904223u;
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 256; j++)
+                S[i][j] = x = x * 1664525u + 1013904223u;
+    }
+
+    uint32_t F(uint32_t x) const
+    {
+        return ((S[0][(x >> 24) & 0xff] + S[1][(x >> 16) & 0xff]) ^ S[2][(x >> 8) & 0xff]) + S[3][x & 0xff];
+    }
+
+    void encrypt(uint32_t *xl, uint32_t *xr) const
+    {
+        uint32_t l = *xl, r = *xr;
+        for (int i = 0; i < 16; i += 2)
+        {
+            l ^= P[i];
+            r ^= F(l);
+            r ^= P[i + 1];
+            l ^= F(r);
+        }
+        l ^= P[16];
+        r ^= P[17];
+        *xl = r;
+        *xr = l;
+    }
+
+    void expandKey(const uint8_t *key, size_t keyLen)
+    {
+        for (int i = 0; i < 18; ++i)
+        {
+            uint32_t data = 0;
+            for (int j = 0; j < 4; ++j)
+                data = (data << 8) | key[(i * 4 + j) % keyLen];
+            P[i] ^= data;
+        }
+        uint32_t l = 0, r = 0;
+        for (int i = 0; i < 18; i += 2)
+        {
+            encrypt(&l, &r);
+            P[i] = l;
+            P[i + 1] = r;
+        }
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 256; j += 2)
+            {
+                encrypt(&l, &r);
+                S[i][j] = l;
+                S[i][j + 1] = r;
+            }
+    }
+};
+
+static double milliseconds_since(const std::chrono::steady_clock::time_point &begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char **argv)
+{
+    int max_cost = (argc > 1) ? atoi(argv[1]) : 12;
+    double budget_ms = (argc > 2) ? atof(argv[2]) : 250.0;
+    if (max_cost < 4 || max_cost > 31 || budget_ms <= 0.0)
+    {
+        printf("usage: %s [max cost, 4..31] [latency budget ms]\n", argv[0]);
+        return 1;
+    }
+
+    const char *password = "correct horse battery staple";
+    uint8_t salt[16];
+    for (int i = 0; i < 16; i++)
+        salt[i] = (uint8_t)(i * 17 + 3);
+
+    printf("%5s %14s %14s %10s\n", "cost", "hash() ms", "rolled ms", "speedup");
+    uint32_t sink = 0;
+    for (int cost = 4; cost <= max_cost; cost++)
+    {
+        // about the same total time for every cost
+        int repeat = (cost < 10) ? (1 << (10 - cost)) : 1;
+
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++)
+            sink += (uint32_t)Bcrypt::hash(password, cost, salt, 'b')[40];
+        double hash_ms = milliseconds_since(begin) / repeat;
+
+        begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++)
+        {
+            RolledBlowfish state;
+            for (uint64_t round = 0; round < ((uint64_t)1 << cost); round++)
+            {
+                state.expandKey((const uint8_t *)password, 29);
+                state.expandKey(salt, 16);
+            }
+            sink += state.P[0];
+        }
+        double rolled_ms = milliseconds_since(begin) / repeat;
+
+        printf("%5d %14.3f %14.3f %9.2fx\n", cost, hash_ms, rolled_ms, rolled_ms / hash_ms);
+    }
+
+    // keeps the loops from being optimized away
+    printf("(%u)\n\n", sink);
+
+    std::vector<Bcrypt::CostBenchmark> report;
+    int recommended = Bcrypt::recommendCost(budget_ms, &report, 0, max_cost);
+    printf("recommendCost, all threads hashing at once:\n");
+    printf("%5s %14s %14s\n", "cost", "ms/hash", "hashes/s");
+    for (const auto &entry : report)
+        printf("%5d %14.3f %14.1f\n", entry.cost, entry.ms_per_hash, entry.hashes_per_second);
+    if (recommended < 0)
+        printf("no cost fits in %.1f ms\n", budget_ms);
+    else
+        printf("recommended cost for %.1f ms: %d\n", budget_ms, recommended);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <InteractiveToolkit-Extension/image/BatchLoader.h>
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit/ITKCommon/FileSystem/Directory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ITKExtension::Image;
+
+// BatchLoader throughput (images/sec) against the decoder thread count, over
+// every PNG and JPG of a directory.
+//
+// usage: benchmark-BatchLoader <directory> [memory budget in MB, 0 = unlimited] [repeat]
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <directory> [memory budget MB] [repeat]\n", argv[0]);
+        return 1;
+    }
+    size_t budget = (argc > 2) ? (size_t)atoi(argv[2]) * 1024 * 1024 : 0;
+    int repeat = (argc > 3) ? atoi(argv[3]) : 1;
+    if (repeat < 1)
+        repeat = 1;
+
+    std::vector<std::string> files;
+    for (auto &file : ITKCommon::FileSystem::Directory(argv[1]))
+    {
+        if (file.isDirectory)
+            continue;
+        if (PNG::isPNGFilename(file.full_path.c_str()) || JPG::isJPGFilename(file.full_path.c_str()))
+            files.push_back(file.full_path);
+    }
+    if (files.size() == 0)
+    {
+        printf("no PNG or JPG files in %s\n", argv[1]);
+        return 1;
+    }
+
+    int max_threads = (std::max)(1, (int)std::thread::hardware_concurrency());
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    printf("%zu files x %d, memory budget %zu MB, %d hardware thread(s)\n",
+           files.size(), repeat, budget / (1024 * 1024), max_threads);
+    printf("%8s %10s %12s %10s %14s\n", "threads", "seconds", "images/s", "speedup", "peak MB");
+
+    double base = 0.0;
+    for (int threads : thread_counts)
+    {
+        BatchLoader loader(threads, budget);
+        for (int r = 0; r < repeat; r++)
+            for (const auto &file : files)
+                loader.addFile(file);
+
+        BatchLoader::Stats stats = loader.run(nullptr);
+        if (base == 0.0)
+            base = stats.images_per_second;
+
+        printf("%8d %10.3f %12.1f %9.2fx %14.1f", threads, stats.seconds, stats.images_per_second,
+               (base > 0.0) ? stats.images_per_second / base : 0.0,
+               (double)stats.peak_memory / (1024.0 * 1024.0));
+        if (stats.failed > 0)
+            printf("   (%zu failed)", stats.failed);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <InteractiveToolkit-Extension/image/JPG.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include <jpeglib.h>
+
+using namespace ITKExtension::Image;
+
+// JPG encode and decode speed of the libjpeg backend the library is built with.
+// Build it once with LIB_JPEG=FromSource and once with LIB_JPEG=TurboFromSource
+// to compare the two.
+//
+// usage: benchmark-JPG [size] [iterations]
+
+#ifndef ITKEXT_LIB_JPEG
+#define ITKEXT_LIB_JPEG "unknown"
+#endif
+
+static double milliseconds_since(const std::chrono::steady_clock::time_point &begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// smooth gradients with some noise, closer to a photo than pure noise
+static std::vector<char> make_image(int w, int h, int chann)
+{
+    std::vector<char> result((size_t)w * h * chann);
+    srand(7);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            for (int c = 0; c < chann; c++)
+            {
+                double v = 128.0 + 90.0 * sin(x * 0.011 + c * 1.7) * cos(y * 0.007 + c) + (rand() % 16);
+                result[((size_t)y * w + x) * chann + c] = (char)(uint8_t)(v < 0.0 ? 0.0 : (v > 255.0 ? 255.0 : v));
+            }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int size = (argc > 1) ? atoi(argv[1]) : 2048;
+    int iterations = (argc > 2) ? atoi(argv[2]) : 10;
+    if (size < 8 || iterations < 1)
+    {
+        printf("usage: %s [size] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+#ifdef LIBJPEG_TURBO_VERSION
+    printf("backend: %s, libjpeg-turbo (JPEG_LIB_VERSION %d)\n", ITKEXT_LIB_JPEG, JPEG_LIB_VERSION);
+#else
+    printf("backend: %s, libjpeg (JPEG_LIB_VERSION %d)\n", ITKEXT_LIB_JPEG, JPEG_LIB_VERSION);
+#endif
+    printf("%dx%d, quality 90, %d iteration(s)\n", size, size, iterations);
+    printf("%6s %12s %12s %12s %12s %12s\n", "chann", "KB", "encode ms", "decode ms", "scaled ms", "decode MP/s");
+
+    const int channels[] = {1, 3, 4};
+    for (int chann : channels)
+    {
+        std::vector<char> image = make_image(size, size, chann);
+
+        int compressed_size = 0;
+        char *compressed = nullptr;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            JPG::closeJPG(compressed);
+            compressed = JPG::writeJPGToMemory(&compressed_size, size, size, chann, image.data(), 90);
+        }
+        double encode_ms = milliseconds_since(begin) / iterations;
+        if (compressed == nullptr)
+        {
+            printf("%6d encode error\n", chann);
+            continue;
+        }
+
+        int w, h, out_chann, depth;
+        begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            char *decoded = JPG::readJPGFromMemory(compressed, compressed_size, &w, &h, &out_chann, &depth);
+            JPG::closeJPG(decoded);
+        }
+        double decode_ms = milliseconds_since(begin) / iterations;
+
+        // 1/8 DCT scaling, the thumbnail path
+        begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            char *decoded = JPG::readJPGFromMemoryScaled(compressed, compressed_size, size / 8, size / 8, &w, &h, &out_chann, &depth);
+            JPG::closeJPG(decoded);
+        }
+        double scaled_ms = milliseconds_since(begin) / iterations;
+
+        printf("%6d %12.1f %12.2f %12.2f %12.2f %12.1f\n", chann, compressed_size / 1024.0,
+               encode_ms, decode_ms, scaled_ms, (double)size * size / (decode_ms * 1000.0));
+
+        JPG::closeJPG(compressed);
+    }
+    return 0;
+}
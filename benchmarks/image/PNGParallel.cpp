@@ -0,0 +1,118 @@
+#include <InteractiveToolkit-Extension/image/PNG.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace ITKExtension::Image;
+
+// PNG encode speed of writePNGToMemoryParallel from 1 to N threads, against the
+// single threaded writePNGToMemory. Every output is decoded back and compared
+// with the input, a mismatch is reported in the last column.
+//
+// usage: benchmark-PNGParallel [size] [max threads] [iterations]
+
+static double milliseconds_since(const std::chrono::steady_clock::time_point &begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// smooth gradients with some noise, closer to a screenshot or photo than pure noise
+static std::vector<char> make_image(int w, int h, int chann)
+{
+    std::vector<char> result((size_t)w * h * chann);
+    srand(7);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            for (int c = 0; c < chann; c++)
+            {
+                double v = 128.0 + 90.0 * sin(x * 0.011 + c * 1.7) * cos(y * 0.007 + c) + (rand() % 8);
+                result[((size_t)y * w + x) * chann + c] = (char)(uint8_t)(v < 0.0 ? 0.0 : (v > 255.0 ? 255.0 : v));
+            }
+    return result;
+}
+
+static bool decodes_to(const char *png, int png_size, const std::vector<char> &image, int w, int h, int chann)
+{
+    int out_w, out_h, out_chann, out_depth;
+    char *decoded = PNG::readPNGFromMemory(png, png_size, &out_w, &out_h, &out_chann, &out_depth);
+    bool result = decoded != nullptr &&
+                  out_w == w && out_h == h && out_chann == chann && out_depth == 8 &&
+                  memcmp(decoded, image.data(), image.size()) == 0;
+    PNG::closePNG(decoded);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int hardware = (int)std::thread::hardware_concurrency();
+    int size = (argc > 1) ? atoi(argv[1]) : 2048;
+    int max_threads = (argc > 2) ? atoi(argv[2]) : (hardware > 4 ? hardware : 4);
+    int iterations = (argc > 3) ? atoi(argv[3]) : 3;
+    if (size < 8 || max_threads < 1 || iterations < 1)
+    {
+        printf("usage: %s [size] [max threads] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    const int chann = 4;
+    std::vector<char> image = make_image(size, size, chann);
+    double megabytes = (double)image.size() / (1024.0 * 1024.0);
+
+    printf("%dx%d RGBA, %d hardware thread(s), %d iteration(s)\n", size, size, hardware, iterations);
+
+    struct Preset
+    {
+        const char *name;
+        PNG::EncodeOptions options;
+    };
+    const Preset presets[] = {
+        {"default", PNG::EncodeOptions::Default()},
+        {"fast", PNG::EncodeOptions::Fast()},
+    };
+
+    bool all_match = true;
+    for (const Preset &preset : presets)
+    {
+        printf("\n%s\n", preset.name);
+        printf("%8s %12s %12s %10s %12s %8s\n", "threads", "encode ms", "MB/s", "speedup", "KB", "match");
+
+        int output_size = 0;
+        char *output = nullptr;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            PNG::closePNG(output);
+            output = PNG::writePNGToMemory(&output_size, size, size, chann, image.data(), preset.options);
+        }
+        double serial_ms = milliseconds_since(begin) / iterations;
+        bool match = decodes_to(output, output_size, image, size, size, chann);
+        all_match = all_match && match;
+        printf("%8s %12.2f %12.1f %10s %12.1f %8s\n", "serial", serial_ms, megabytes * 1000.0 / serial_ms,
+               "1.00x", output_size / 1024.0, match ? "yes" : "NO");
+        PNG::closePNG(output);
+
+        for (int threads = 1; threads <= max_threads; threads++)
+        {
+            output = nullptr;
+            begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                PNG::closePNG(output);
+                output = PNG::writePNGToMemoryParallel(&output_size, size, size, chann, image.data(), preset.options, false, threads);
+            }
+            double ms = milliseconds_since(begin) / iterations;
+            match = decodes_to(output, output_size, image, size, size, chann);
+            all_match = all_match && match;
+            printf("%8d %12.2f %12.1f %9.2fx %12.1f %8s\n", threads, ms, megabytes * 1000.0 / ms,
+                   serial_ms / ms, output_size / 1024.0, match ? "yes" : "NO");
+            PNG::closePNG(output);
+        }
+    }
+
+    return all_match ? 0 : 1;
+}
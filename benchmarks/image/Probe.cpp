@@ -0,0 +1,105 @@
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit/ITKCommon/FileSystem/Directory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace ITKExtension::Image;
+
+// Header only probe (probePNG / probeJPG) against the full decode of the same
+// files, over every PNG and JPG of a directory.
+//
+// usage: benchmark-Probe <directory> [repeat]
+
+static double seconds_since(const std::chrono::steady_clock::time_point &begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static void run(const char *label, const std::vector<std::string> &files, int repeat,
+                bool (*probe)(const char *, int *, int *, int *, int *, std::string *),
+                bool (*decode)(const std::string &, size_t *))
+{
+    if (files.size() == 0)
+        return;
+
+    int w, h, chann, depth;
+    int failed = 0;
+    size_t pixels = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+        for (const auto &file : files)
+            if (!probe(file.c_str(), &w, &h, &chann, &depth, nullptr))
+                failed++;
+    double probe_s = seconds_since(begin);
+
+    begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+        for (const auto &file : files)
+            if (!decode(file, &pixels))
+                failed++;
+    double decode_s = seconds_since(begin);
+
+    double count = (double)files.size() * (double)repeat;
+    printf("%4s %6zu files %12.2f us/probe %12.2f us/decode %10.1fx   (%.1f Mpixel decoded, %d failed)\n",
+           label, files.size(),
+           probe_s * 1e6 / count, decode_s * 1e6 / count,
+           decode_s / (probe_s > 0.0 ? probe_s : 1e-9),
+           (double)pixels / 1e6, failed);
+}
+
+static bool decode_png(const std::string &file, size_t *pixels)
+{
+    int w, h, chann, depth;
+    char *buffer = PNG::readPNG(file.c_str(), &w, &h, &chann, &depth);
+    if (buffer == nullptr)
+        return false;
+    *pixels += (size_t)w * (size_t)h;
+    PNG::closePNG(buffer);
+    return true;
+}
+
+static bool decode_jpg(const std::string &file, size_t *pixels)
+{
+    int w, h, chann, depth;
+    char *buffer = JPG::readJPG(file.c_str(), &w, &h, &chann, &depth);
+    if (buffer == nullptr)
+        return false;
+    *pixels += (size_t)w * (size_t)h;
+    JPG::closeJPG(buffer);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <directory> [repeat]\n", argv[0]);
+        return 1;
+    }
+    int repeat = (argc > 2) ? atoi(argv[2]) : 5;
+    if (repeat < 1)
+        repeat = 1;
+
+    std::vector<std::string> png_files;
+    std::vector<std::string> jpg_files;
+    for (auto &file : ITKCommon::FileSystem::Directory(argv[1]))
+    {
+        if (file.isDirectory)
+            continue;
+        if (PNG::isPNGFilename(file.full_path.c_str()))
+            png_files.push_back(file.full_path);
+        else if (JPG::isJPGFilename(file.full_path.c_str()))
+            jpg_files.push_back(file.full_path);
+    }
+
+    printf("%s, %d repeat(s)\n", argv[1], repeat);
+    run("PNG", png_files, repeat, PNG::probePNG, decode_png);
+    run("JPG", jpg_files, repeat, JPG::probeJPG, decode_jpg);
+    return 0;
+}
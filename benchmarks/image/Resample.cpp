@@ -0,0 +1,224 @@
+#include <InteractiveToolkit-Extension/image/Resample.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+using namespace ITKExtension::Image;
+
+// Resample::resize against a naive reference: direct 2D filtering in double,
+// linear color space, clamp edges, no alpha weighting. The reference is also
+// used to check the results, on random small sizes and on the timed resize.
+//
+// usage: benchmark-Resample [source size] [target size]
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef double (*KernelFunction)(double x);
+
+static double kernel_box(double x)
+{
+    return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+}
+
+static double kernel_triangle(double x)
+{
+    x = fabs(x);
+    return (x < 1.0) ? 1.0 - x : 0.0;
+}
+
+static double sinc(double x)
+{
+    if (x == 0.0)
+        return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double kernel_lanczos3(double x)
+{
+    x = fabs(x);
+    return (x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+static double kernel_mitchell(double x)
+{
+    const double B = 1.0 / 3.0, C = 1.0 / 3.0;
+    x = fabs(x);
+    double x2 = x * x, x3 = x2 * x;
+    if (x < 1.0)
+        return ((12.0 - 9.0 * B - 6.0 * C) * x3 + (-18.0 + 12.0 * B + 6.0 * C) * x2 + (6.0 - 2.0 * B)) / 6.0;
+    if (x < 2.0)
+        return ((-B - 6.0 * C) * x3 + (6.0 * B + 30.0 * C) * x2 + (-12.0 * B - 48.0 * C) * x + (8.0 * B + 24.0 * C)) / 6.0;
+    return 0.0;
+}
+
+struct Kernel
+{
+    const char *name;
+    Resample::Filter filter;
+    KernelFunction function;
+    double support;
+};
+
+static const Kernel kernels[] = {
+    {"Box", Resample::Filter::Box, kernel_box, 0.5},
+    {"Bilinear", Resample::Filter::Bilinear, kernel_triangle, 1.0},
+    {"Lanczos3", Resample::Filter::Lanczos3, kernel_lanczos3, 3.0},
+    {"Mitchell", Resample::Filter::Mitchell, kernel_mitchell, 2.0}};
+
+// every target pixel sums the whole 2D footprint of the stretched kernel
+static void naive_resize(const uint8_t *src, int src_w, int src_h, int chann,
+                         uint8_t *dst, int dst_w, int dst_h, const Kernel &kernel)
+{
+    double scale_x = (double)src_w / (double)dst_w;
+    double scale_y = (double)src_h / (double)dst_h;
+    double stretch_x = (scale_x > 1.0) ? scale_x : 1.0;
+    double stretch_y = (scale_y > 1.0) ? scale_y : 1.0;
+
+    for (int y = 0; y < dst_h; y++)
+        for (int x = 0; x < dst_w; x++)
+        {
+            double center_x = (x + 0.5) * scale_x;
+            double center_y = (y + 0.5) * scale_y;
+            double acc[4] = {0, 0, 0, 0};
+            double weight_sum = 0.0;
+
+            int j_min = (int)floor(center_y - kernel.support * stretch_y);
+            int j_max = (int)ceil(center_y + kernel.support * stretch_y);
+            int i_min = (int)floor(center_x - kernel.support * stretch_x);
+            int i_max = (int)ceil(center_x + kernel.support * stretch_x);
+            for (int j = j_min; j <= j_max; j++)
+                for (int i = i_min; i <= i_max; i++)
+                {
+                    double weight = kernel.function((i + 0.5 - center_x) / stretch_x) *
+                                    kernel.function((j + 0.5 - center_y) / stretch_y);
+                    if (weight == 0.0)
+                        continue;
+                    int si = (i < 0) ? 0 : ((i >= src_w) ? src_w - 1 : i);
+                    int sj = (j < 0) ? 0 : ((j >= src_h) ? src_h - 1 : j);
+                    const uint8_t *pixel = &src[((size_t)sj * src_w + si) * chann];
+                    for (int c = 0; c < chann; c++)
+                        acc[c] += weight * pixel[c];
+                    weight_sum += weight;
+                }
+
+            uint8_t *out = &dst[((size_t)y * dst_w + x) * chann];
+            for (int c = 0; c < chann; c++)
+            {
+                double v = acc[c] / weight_sum;
+                v = (v < 0.0) ? 0.0 : ((v > 255.0) ? 255.0 : v);
+                out[c] = (uint8_t)(v + 0.5);
+            }
+        }
+}
+
+static int max_difference(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+{
+    int result = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        int d = abs((int)a[i] - (int)b[i]);
+        if (d > result)
+            result = d;
+    }
+    return result;
+}
+
+static double milliseconds_since(const std::chrono::steady_clock::time_point &begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char **argv)
+{
+    int src_size = (argc > 1) ? atoi(argv[1]) : 2048;
+    int dst_size = (argc > 2) ? atoi(argv[2]) : 1024;
+    if (src_size < 1 || dst_size < 1)
+    {
+        printf("usage: %s [source size] [target size]\n", argv[0]);
+        return 1;
+    }
+
+    Resample::Options options;
+    options.color_space = Resample::ColorSpace::Linear;
+
+    // random small sizes against the reference
+    srand(5);
+    int small_difference = 0;
+    for (int it = 0; it < 200; it++)
+    {
+        const Kernel &kernel = kernels[rand() % 4];
+        int sw = 1 + rand() % 60, sh = 1 + rand() % 60;
+        int dw = 1 + rand() % 60, dh = 1 + rand() % 60;
+        int chann = (rand() % 2) ? 3 : 1;
+        if (kernel.filter == Resample::Filter::Box)
+        {
+            // the box filter only matches the direct sum on exact 2x reductions
+            sw += sw % 2;
+            sh += sh % 2;
+            dw = sw / 2;
+            dh = sh / 2;
+        }
+
+        std::vector<uint8_t> src((size_t)sw * sh * chann);
+        for (int y = 0; y < sh; y++)
+            for (int x = 0; x < sw; x++)
+                for (int c = 0; c < chann; c++)
+                    src[((size_t)y * sw + x) * chann + c] = (uint8_t)(128.0 + 100.0 * sin(x * 0.3 + c) * cos(y * 0.2) + (rand() % 20));
+
+        std::vector<uint8_t> fast((size_t)dw * dh * chann), reference((size_t)dw * dh * chann);
+        options.filter = kernel.filter;
+        Resample::resize(src.data(), sw, sh, (size_t)sw * chann, chann, fast.data(), dw, dh, (size_t)dw * chann, options);
+        naive_resize(src.data(), sw, sh, chann, reference.data(), dw, dh, kernel);
+
+        int d = max_difference(fast, reference);
+        if (d > small_difference)
+            small_difference = d;
+    }
+    printf("random sizes: max difference to the reference %d\n\n", small_difference);
+
+    // timing, RGBA
+    std::vector<uint8_t> src((size_t)src_size * src_size * 4);
+    for (auto &v : src)
+        v = (uint8_t)rand();
+    std::vector<uint8_t> fast((size_t)dst_size * dst_size * 4), reference(fast.size());
+
+    printf("RGBA %dx%d -> %dx%d\n", src_size, src_size, dst_size, dst_size);
+    printf("%10s %12s %12s %10s %10s\n", "filter", "resize ms", "naive ms", "speedup", "max diff");
+    for (const Kernel &kernel : kernels)
+    {
+        options.filter = kernel.filter;
+
+        auto begin = std::chrono::steady_clock::now();
+        Resample::resize(src.data(), src_size, src_size, (size_t)src_size * 4, 4,
+                         fast.data(), dst_size, dst_size, (size_t)dst_size * 4, options);
+        double fast_ms = milliseconds_since(begin);
+
+        begin = std::chrono::steady_clock::now();
+        naive_resize(src.data(), src_size, src_size, 4, reference.data(), dst_size, dst_size, kernel);
+        double naive_ms = milliseconds_since(begin);
+
+        // RGBA is filtered weighted by alpha, so only the alpha channel is comparable
+        int alpha_difference = 0;
+        for (size_t i = 3; i < fast.size(); i += 4)
+        {
+            int d = abs((int)fast[i] - (int)reference[i]);
+            if (d > alpha_difference)
+                alpha_difference = d;
+        }
+
+        printf("%10s %12.1f %12.1f %9.1fx %10d\n", kernel.name, fast_ms, naive_ms, naive_ms / fast_ms, alpha_difference);
+    }
+
+    Resample::Options mip_options;
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<Resample::MipLevel> levels = Resample::generateMipChain(src.data(), src_size, src_size, (size_t)src_size * 4, 4, mip_options);
+    printf("\nmip chain (Mitchell, sRGB) %zu levels: %.1f ms\n", levels.size(), milliseconds_since(begin));
+
+    return 0;
+}
@@ -9,7 +9,13 @@ unset(JPEG_LIBRARY CACHE)
 unset(JPEG_LIBRARIES CACHE)
 
 set( LIB_JPEG TryFindPackageFirst CACHE STRING "Choose the Library Source." )
-set_property(CACHE LIB_JPEG PROPERTY STRINGS None TryFindPackageFirst UsingFindPackage FromSource)
+set_property(CACHE LIB_JPEG PROPERTY STRINGS None TryFindPackageFirst UsingFindPackage FromSource TurboFromSource)
+
+# TurboFromSource: libjpeg-turbo (SIMD DCT and color conversion) built from this source tree.
+# When the directory does not exist, the repository is cloned there.
+set( LIB_JPEG_TURBO_SOURCE_DIR "${ARIBEIRO_LIBS_DIR}/libjpeg-turbo" CACHE PATH "libjpeg-turbo source tree used by LIB_JPEG=TurboFromSource." )
+# release tag checked out by the clone, an existing source tree is used as it is
+set( LIB_JPEG_TURBO_TAG "3.0.4" CACHE STRING "libjpeg-turbo release tag cloned by LIB_JPEG=TurboFromSource." )
 
 if(LIB_JPEG STREQUAL "TryFindPackageFirst")
     find_package(JPEG QUIET)
@@ -43,6 +49,83 @@ if(LIB_JPEG STREQUAL "FromSource")
 
     #include_directories("${ARIBEIRO_GEN_INCLUDE_DIR}/libjpeg/")
 
+elseif(LIB_JPEG STREQUAL "TurboFromSource")
+
+    if(NOT EXISTS "${LIB_JPEG_TURBO_SOURCE_DIR}/CMakeLists.txt")
+        if (NOT LIB_JPEG_TURBO_SOURCE_DIR STREQUAL "${ARIBEIRO_LIBS_DIR}/libjpeg-turbo")
+            message(FATAL_ERROR "[LIB_JPEG] libjpeg-turbo not found at: ${LIB_JPEG_TURBO_SOURCE_DIR}")
+        endif()
+        tool_download_git_package_branch("https://github.com/libjpeg-turbo/libjpeg-turbo.git" ${LIB_JPEG_TURBO_TAG} libjpeg-turbo)
+    endif()
+
+    message(STATUS "[LIB_JPEG] compiling libjpeg-turbo from: ${LIB_JPEG_TURBO_SOURCE_DIR}")
+    if(CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86|X86|i.86|AMD64|amd64|x86_64)$")
+        message(STATUS "[LIB_JPEG] the x86 SIMD code needs NASM or Yasm in the PATH, without it libjpeg-turbo builds the plain C code.")
+    endif()
+
+    # libjpeg-turbo does not support being added with add_subdirectory,
+    # it is built and installed as an external project.
+    include(ExternalProject)
+
+    set(jpeg_turbo_BINARY_PATH "${ARIBEIRO_LIBS_DIR}/build/libjpeg-turbo")
+    set(jpeg_turbo_INSTALL_PATH "${jpeg_turbo_BINARY_PATH}/install")
+    if (MSVC)
+        set(jpeg_turbo_LIBRARY_FILE "${jpeg_turbo_INSTALL_PATH}/lib/jpeg-static.lib")
+    else()
+        set(jpeg_turbo_LIBRARY_FILE "${jpeg_turbo_INSTALL_PATH}/lib/${CMAKE_STATIC_LIBRARY_PREFIX}jpeg${CMAKE_STATIC_LIBRARY_SUFFIX}")
+    endif()
+
+    set(jpeg_turbo_BUILD_TYPE ${CMAKE_BUILD_TYPE})
+    if (NOT jpeg_turbo_BUILD_TYPE)
+        set(jpeg_turbo_BUILD_TYPE Release)
+    endif()
+
+    set(jpeg_turbo_CMAKE_ARGS
+        -DCMAKE_BUILD_TYPE=${jpeg_turbo_BUILD_TYPE}
+        -DCMAKE_INSTALL_PREFIX=${jpeg_turbo_INSTALL_PATH}
+        -DCMAKE_INSTALL_LIBDIR=lib
+        -DCMAKE_INSTALL_INCLUDEDIR=include
+        -DCMAKE_C_COMPILER=${CMAKE_C_COMPILER}
+        -DCMAKE_POSITION_INDEPENDENT_CODE=ON
+        -DENABLE_SHARED=OFF
+        -DENABLE_STATIC=ON
+        -DWITH_TURBOJPEG=OFF
+        -DWITH_SIMD=ON
+    )
+    if (CMAKE_TOOLCHAIN_FILE)
+        list(APPEND jpeg_turbo_CMAKE_ARGS -DCMAKE_TOOLCHAIN_FILE=${CMAKE_TOOLCHAIN_FILE})
+    endif()
+    if (CMAKE_OSX_ARCHITECTURES)
+        list(APPEND jpeg_turbo_CMAKE_ARGS -DCMAKE_OSX_ARCHITECTURES=${CMAKE_OSX_ARCHITECTURES})
+    endif()
+
+    ExternalProject_Add(libjpeg-turbo-build
+        SOURCE_DIR "${LIB_JPEG_TURBO_SOURCE_DIR}"
+        BINARY_DIR "${jpeg_turbo_BINARY_PATH}/build"
+        INSTALL_DIR "${jpeg_turbo_INSTALL_PATH}"
+        CMAKE_ARGS ${jpeg_turbo_CMAKE_ARGS}
+        BUILD_BYPRODUCTS "${jpeg_turbo_LIBRARY_FILE}"
+    )
+    set_target_properties(libjpeg-turbo-build PROPERTIES FOLDER "LIBS")
+
+    # the include directory is only filled by the install step
+    file(MAKE_DIRECTORY "${jpeg_turbo_INSTALL_PATH}/include")
+
+    add_library(libjpeg STATIC IMPORTED GLOBAL)
+    set_target_properties(libjpeg PROPERTIES
+        IMPORTED_LOCATION "${jpeg_turbo_LIBRARY_FILE}"
+        INTERFACE_INCLUDE_DIRECTORIES "${jpeg_turbo_INSTALL_PATH}/include"
+    )
+    add_dependencies(libjpeg libjpeg-turbo-build)
+
+    set(JPEG_INCLUDE_DIR "${jpeg_turbo_INSTALL_PATH}/include")
+    set(JPEG_LIBRARY libjpeg)
+    set(JPEG_LIBRARIES ${JPEG_LIBRARY})
+
+    tool_make_global(JPEG_INCLUDE_DIR)
+    tool_make_global(JPEG_LIBRARY)
+    tool_make_global(JPEG_LIBRARIES)
+
 elseif(LIB_JPEG STREQUAL "UsingFindPackage")
 
     find_package(JPEG REQUIRED QUIET)
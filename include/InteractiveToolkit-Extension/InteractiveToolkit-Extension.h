@@ -12,8 +12,16 @@
 #endif
 
 #ifdef ITKEXT_IMAGE
+#include "image/Allocator.h"
 #include "image/JPG.h"
 #include "image/PNG.h"
+#include "image/PixelFormat.h"
+#include "image/Resample.h"
+#include "image/BlockCompression.h"
+#include "image/DecodedCache.h"
+#include "image/Image.h"
+#include "image/BatchLoader.h"
+#include "image/ProgressiveDecoder.h"
 #endif
 
 #include "io/AdvancedReader.h"
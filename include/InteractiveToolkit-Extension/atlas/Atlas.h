@@ -9,6 +9,9 @@
 
 #include "AtlasRect.h"
 #include "AtlasElement.h"
+#include "AtlasPacker.h"
+
+#include <InteractiveToolkit-Extension/image/PNG.h>
 
 namespace ITKExtension
 {
@@ -46,6 +49,8 @@ namespace ITKExtension
         /// // after add all elements
         /// // compute the final atlas image
         /// atlas.organizePositions(true); // fast mode: true
+        /// // or, much faster for thousands of elements:
+        /// // atlas.organizePositions(PackingAlgorithm::Skyline);
         ///
         /// // export the atlas image
         /// atlas.savePNG("atlas.png");
@@ -72,8 +77,19 @@ namespace ITKExtension
 
             bool repositionAllElements(const AtlasRect &screen, bool fastMode);
 
+            bool packElements(const AtlasRect &screen, PackingAlgorithm algorithm, const std::vector<int> &order);
+
             std::vector<std::shared_ptr<AtlasElement>> elements;
 
+            // online mode
+            bool onlineMode;
+            MaxRectsPacker onlinePacker;
+            std::vector<AtlasRect> clearRects;                          // removed areas to clear in the next update
+            std::vector<std::shared_ptr<AtlasElement>> pendingElements; // inserted elements to draw in the next update
+
+            AtlasRect spacedRect(const AtlasElement *element) const;
+            void endOnlineMode();
+
             void clearElements();
 
         public:
@@ -111,12 +127,106 @@ namespace ITKExtension
             ///
             std::shared_ptr<AtlasElement> addElement(const std::string &name, int w, int h);
 
+            /// \brief Add new atlas element with the pixels of an image
+            ///
+            /// The image can be a crop or flipped view (see Image::Image), its pixels are copied
+            /// straight into the element.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param name Name of the sprite
+            /// \param image 8 bits image with 1 to 4 channels
+            /// \return Pointer to a created AtlasElement, nullptr if the image is empty or not 8 bits
+            ///
+            std::shared_ptr<AtlasElement> addElement(const std::string &name, const Image::Image &image);
+
             /// \brief Remove Last Inserted Element
             ///
             /// \author Alessandro Ribeiro
             ///
             void removeLastInsertedElement();
 
+            /// \brief Remove an element from this Atlas
+            ///
+            /// In online mode its area is cleared in the next #updateRGBA and reused by the next insertions.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param element An element of this atlas
+            /// \return false if the element is not in this atlas
+            ///
+            bool removeElement(const std::shared_ptr<AtlasElement> &element);
+
+            /// \brief Start placing the elements one by one, without repacking the atlas
+            ///
+            /// Made for caches that grow while rendering (glyphs of a dynamic font).
+            /// The elements already in the atlas keep the positions computed by #organizePositions,
+            /// the new ones go to the free space with #insertElement. Only the changed regions
+            /// of the texture are written by #updateRGBA.
+            ///
+            /// When #insertElement fails, call this method again with a larger resolution: the positions
+            /// are kept and the texture needs to be created again with #createRGBA.
+            ///
+            /// #organizePositions and #read end the online mode.
+            ///
+            /// \code
+            ///
+            /// atlas.organizePositions(PackingAlgorithm::Skyline);
+            /// atlas.beginOnlineMode(atlas.textureResolution);
+            /// std::shared_ptr<uint8_t[]> texture = atlas.createRGBA();
+            ///
+            /// // while rendering
+            /// auto glyph = atlas.insertElement("U+4E2D", w, h);
+            /// if (glyph != nullptr)
+            ///     glyph->copyFromRGBABuffer(rgba, w * 4);
+            /// ...
+            /// std::vector<AtlasRect> dirty;
+            /// atlas.updateRGBA(texture.get(), &dirty);
+            /// for (const auto &rect : dirty)
+            ///     upload(texture, rect); // glTexSubImage2D
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param resolution The texture resolution, the current elements need to be inside it
+            ///
+            void beginOnlineMode(const AtlasRect &resolution);
+
+            bool isOnlineMode() const;
+
+            /// \brief Place a new element in the free space of the texture (online mode)
+            ///
+            /// Set the element pixels before the next #updateRGBA.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param name Name of the sprite
+            /// \param w Width
+            /// \param h Height
+            /// \return The placed element, nullptr when there is no free space left
+            ///
+            std::shared_ptr<AtlasElement> insertElement(const std::string &name, int w, int h);
+
+            /// \brief Place a new element with the pixels of an image (online mode)
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param name Name of the sprite
+            /// \param image 8 bits image with 1 to 4 channels
+            /// \return The placed element, nullptr when the image is empty, not 8 bits or there is no free space left
+            ///
+            std::shared_ptr<AtlasElement> insertElement(const std::string &name, const Image::Image &image);
+
+            /// \brief There are inserted or removed elements not written by #updateRGBA yet
+            bool hasPendingUpdates() const;
+
+            /// \brief Write the changes since the last update into a texture created by #createRGBA
+            ///
+            /// The areas of the removed elements are cleared and the inserted elements are copied
+            /// with their borders. The other pixels are not touched.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param rgba The texture, with #textureResolution size
+            /// \param[out] dirtyRects The regions written (optional)
+            ///
+            void updateRGBA(uint8_t *rgba, std::vector<AtlasRect> *dirtyRects = nullptr);
+
             /// \brief Organize the positions of the sprites in a single image.
             ///
             /// The RGBA buffers are not modified.
@@ -128,6 +238,25 @@ namespace ITKExtension
             ///
             void organizePositions(bool fastMode);
 
+            /// \brief Organize the positions of the sprites in a single image with a rectangle packer.
+            ///
+            /// Much faster than #organizePositions(bool) for large atlases (thousands of glyphs)
+            /// and usually fills a smaller texture. The spacing between the sprites is the same.
+            ///
+            /// The texture is the smallest power of two (from 128 up to 32768) found by a binary search
+            /// over the sizes ordered by area. The order of the elements is kept.
+            ///
+            /// \code
+            ///
+            /// atlas.organizePositions(PackingAlgorithm::MaxRectsBSSF);
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param algorithm Skyline (fastest) or MaxRectsBSSF (tightest)
+            ///
+            void organizePositions(PackingAlgorithm algorithm);
+
             /// \brief Create an image with all sprite elements inside an Atlas
             ///
             /// The RGBA buffers are not modified.
@@ -248,17 +377,27 @@ namespace ITKExtension
 
             /// \brief Write the RGBA PNG image file of the Atlas
             ///
+            /// Large atlases encode several times faster with ITKExtension::Image::PNG::EncodeOptions::Fast().
+            ///
             /// \author Alessandro Ribeiro
             /// \param filename The filename you want to save the image of the Atlas
+            /// \param options PNG encoder settings
+            /// \param[out] stats encode time and output size (optional)
             ///
-            void savePNG(const std::string &filename) const;
+            void savePNG(const std::string &filename,
+                         const ITKExtension::Image::PNG::EncodeOptions &options = ITKExtension::Image::PNG::EncodeOptions(),
+                         ITKExtension::Image::PNG::EncodeStats *stats = nullptr) const;
 
             /// \brief Write the Alpha(GrayScale) PNG image file of the Atlas
             ///
             /// \author Alessandro Ribeiro
             /// \param filename The filename you want to save the image of the Atlas
+            /// \param options PNG encoder settings
+            /// \param[out] stats encode time and output size (optional)
             ///
-            void savePNG_Alpha(const std::string &filename) const;
+            void savePNG_Alpha(const std::string &filename,
+                               const ITKExtension::Image::PNG::EncodeOptions &options = ITKExtension::Image::PNG::EncodeOptions(),
+                               ITKExtension::Image::PNG::EncodeStats *stats = nullptr) const;
 
             /// \brief Write the reference table of this Atlas
             ///
@@ -16,6 +16,10 @@ namespace ITKExtension
         class AdvancedWriter;
         class AdvancedReader;
     }
+    namespace Image
+    {
+        class Image;
+    }
     namespace Atlas
     {
 
@@ -164,6 +168,17 @@ namespace ITKExtension
             void copyFromRGBBuffer(uint8_t *src);
             void copyFromGrayBuffer(uint8_t *src);
 
+            /// \brief Copy an 8 bits image (or view) to the internal RGBA buffer.
+            ///
+            /// Reads through the image stride, so a crop or flipped view of a bigger
+            /// image is copied directly, without an intermediate buffer.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param image Source with the same width and height of this element, 1 to 4 channels
+            /// \return false on size or format mismatch
+            ///
+            bool copyFromImage(const Image::Image &image);
+
 
             /// \brief Copy the RGBA from internal buffer to the parameter.
             ///
@@ -196,8 +211,8 @@ namespace ITKExtension
             /// \param yspacing The spacing between the sprites (vertical)
             ///
             void copyToRGBABuffer(uint8_t *dst, int strideX, int xspacing, int yspacing);
-            void copyToRGBBuffer(uint8_t *dst, int xspacing, int yspacing);
-            void copyToGrayBuffer(uint8_t *dst, int xspacing, int yspacing);
+            void copyToRGBBuffer(uint8_t *dst, int strideX, int xspacing, int yspacing);
+            void copyToGrayBuffer(uint8_t *dst, int strideX, int xspacing, int yspacing);
 
             /// \brief Copy the Alpha from internal buffer to the parameter.
             ///
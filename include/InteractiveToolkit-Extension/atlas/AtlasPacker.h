@@ -0,0 +1,159 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "AtlasRect.h"
+
+namespace ITKExtension
+{
+    namespace Atlas
+    {
+
+        /// \brief Rectangle packing algorithm used by #Atlas::organizePositions
+        enum class PackingAlgorithm : int
+        {
+            /// Skyline bottom-left: keeps the top contour of the packed rectangles.
+            /// The fastest, good occupancy for rectangles of similar height (glyphs).
+            Skyline,
+            /// MaxRects with the best short side fit rule: keeps every maximal free rectangle.
+            /// Slower than Skyline, the best occupancy for mixed sizes (sprites).
+            MaxRectsBSSF
+        };
+
+        /// \brief Skyline bottom-left rectangle packer
+        ///
+        /// Places each rectangle at the lowest position of the skyline (top contour of
+        /// what was already placed), the leftmost one on ties.
+        ///
+        /// \code
+        ///
+        /// SkylinePacker packer(1024, 1024);
+        /// int x, y;
+        /// if (packer.insert(w, h, &x, &y)) {
+        ///     ...
+        /// }
+        ///
+        /// \endcode
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class SkylinePacker
+        {
+            /// \private
+            struct Node
+            {
+                int x;
+                int y;
+                int w;
+            };
+
+            std::vector<Node> skyline;
+            int width;
+            int height;
+            int64_t usedArea;
+
+        public:
+            SkylinePacker(int w = 0, int h = 0);
+
+            /// \brief Clear all placements and set the bin size
+            void reset(int w, int h);
+
+            /// \brief Find a place for a w x h rectangle
+            ///
+            /// \param[out] x left of the placed rectangle
+            /// \param[out] y top of the placed rectangle
+            /// \return false when the rectangle does not fit
+            ///
+            bool insert(int w, int h, int *x, int *y);
+
+            /// \brief Placed area over the bin area
+            float occupancy() const;
+        };
+
+        /// \brief MaxRects rectangle packer with the best short side fit rule
+        ///
+        /// Keeps the list of maximal free rectangles. A rectangle goes to the free rectangle
+        /// whose shorter leftover side is the smallest.
+        ///
+        /// The free rectangles are registered in a uniform grid, so splitting and pruning
+        /// after a placement only visit the free rectangles near it. The few large free
+        /// rectangles (the empty area not reached yet) are kept out of the grid.
+        ///
+        /// Released rectangles (#release) go back to the free list, so the packer can be used
+        /// for online insertion and removal.
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class MaxRectsPacker
+        {
+            /// \private
+            struct FreeRect
+            {
+                AtlasRect rect;
+                bool alive;
+                int largePos; // position in largeIds, -1 when it is in the grid
+            };
+
+            std::vector<FreeRect> freeRects;
+            std::vector<int> freeSlots; // dead entries of freeRects to reuse
+            std::vector<int> aliveIds;  // alive entries, unordered
+            std::vector<int> alivePos;  // position of each entry in aliveIds
+
+            // spatial index: free rectangle ids per grid cell
+            int cellSize;
+            int gridW;
+            int gridH;
+            std::vector<std::vector<int>> grid;
+            std::vector<int> largeIds; // entries over too many cells, checked one by one
+            std::vector<uint32_t> visited; // query stamp per entry
+            uint32_t stamp;
+
+            int width;
+            int height;
+            int64_t usedArea;
+
+            std::vector<AtlasRect> usedRects;
+            bool fragmented; // released areas since the last rebuild of the free rectangles
+
+            int addFreeRect(const AtlasRect &rect);
+            void removeFreeRect(int id);
+            void query(const AtlasRect &rect, std::vector<int> *result);
+            void splitFreeRects(const AtlasRect &used);
+            void addMaximalRects(std::vector<AtlasRect> *created);
+            void rebuildFreeRects();
+
+        public:
+            MaxRectsPacker(int w = 0, int h = 0);
+
+            /// \brief Clear all placements and set the bin size
+            void reset(int w, int h);
+
+            /// \brief Find a place for a w x h rectangle
+            ///
+            /// \param[out] x left of the placed rectangle
+            /// \param[out] y top of the placed rectangle
+            /// \return false when the rectangle does not fit
+            ///
+            bool insert(int w, int h, int *x, int *y);
+
+            /// \brief Mark an area as used, for rectangles placed before this packer existed
+            void reserve(const AtlasRect &rect);
+
+            /// \brief Give back the area of a rectangle placed by #insert or #reserve
+            ///
+            /// The area is merged with the free rectangles that share a whole side with it.
+            /// When an insertion does not fit after releases, the free rectangles are computed
+            /// again from the used ones, so no free space is lost.
+            ///
+            void release(const AtlasRect &rect);
+
+            /// \brief Placed area over the bin area
+            float occupancy() const;
+
+            /// \brief Number of free rectangles currently tracked
+            int freeRectCount() const;
+        };
+
+    }
+}
@@ -262,8 +262,12 @@ namespace ITKExtension
             ///
             /// \author Alessandro Ribeiro
             /// \param writer The #ITKExtension::IO::AdvancedWriter instance
+            /// \param options PNG encoder settings
+            /// \param[out] stats encode time and output size (optional)
             ///
-            void writeBitmap(ITKExtension::IO::AdvancedWriter *writer);
+            void writeBitmap(ITKExtension::IO::AdvancedWriter *writer,
+                             const ITKExtension::Image::PNG::EncodeOptions &options = ITKExtension::Image::PNG::EncodeOptions(),
+                             ITKExtension::Image::PNG::EncodeStats *stats = nullptr);
         };
 
     }
@@ -20,6 +20,23 @@ namespace ITKExtension
             std::string hash(const std::string &password, int cost = 10, uint8_t salt_from_parameter[16] = nullptr, char format = 'y');
             // Verify password against bcrypt hash
             bool verify(const std::string &password, const std::string &hash);
+
+            // Verify password against bcrypt hash (constant time hash comparison).
+            // If it matches and the stored cost is below targetCost, rehash_output receives
+            // a targetCost hash with the same salt, continuing the work done by the verification.
+            bool verifyAndMaybeRehash(const std::string &password, const std::string &hash, int targetCost, std::string *rehash_output);
+
+            struct CostBenchmark
+            {
+                int cost;
+                double ms_per_hash;       // worst latency with all threads hashing at once (median of the samples)
+                double hashes_per_second; // aggregated throughput of all threads
+            };
+
+            // Benchmark cost factors from 4 to maxCost hashing on threadCount threads at once
+            // (0 = all cores), and return the highest cost whose latency fits in latencyBudgetMs,
+            // or -1 when not even cost 4 fits. Each cost is measured 3 times and the median is used.
+            int recommendCost(double latencyBudgetMs, std::vector<CostBenchmark> *report = nullptr, int threadCount = 0, int maxCost = 16);
         }
     }
 }
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "SHA1.h"
+#include "SHA256.h"
+
+#include <string.h>
+
+namespace ITKExtension
+{
+    namespace Hashing
+    {
+        // HMAC (RFC 2104) over SHA1, SHA256 or MD5.
+        //
+        // The key schedule runs once: the hash states after absorbing the inner
+        // and outer pads are kept, so each message costs only its own compressions
+        // plus one for the outer hash.
+        //
+        // HMAC<SHA256> hmac(key, key_len);
+        // hmac.update(msg, msg_len);
+        // hmac.finalize(digest);   // ready for the next message with the same key
+        template <typename HashT>
+        class HMAC
+        {
+        private:
+            HashT inner_keyed;
+            HashT outer_keyed;
+            HashT current;
+
+        public:
+            static const size_t DigestSize = HashT::DigestSize;
+            static const size_t BlockSize = HashT::BlockSize;
+
+            HMAC()
+            {
+                setKey(nullptr, 0);
+            }
+
+            HMAC(const uint8_t *key, size_t key_len)
+            {
+                setKey(key, key_len);
+            }
+
+            ~HMAC()
+            {
+                volatile uint8_t *p = reinterpret_cast<volatile uint8_t *>(this);
+                for (size_t i = 0; i < sizeof(*this); i++)
+                    p[i] = 0;
+            }
+
+            void setKey(const uint8_t *key, size_t key_len)
+            {
+                uint8_t block[BlockSize];
+                memset(block, 0, BlockSize);
+
+                // keys longer than the block size are hashed first
+                if (key_len > BlockSize)
+                    HashT::hash(key, key_len, block);
+                else if (key_len > 0)
+                    memcpy(block, key, key_len);
+
+                for (size_t i = 0; i < BlockSize; i++)
+                    block[i] ^= 0x36;
+                inner_keyed.reset();
+                inner_keyed.update(block, BlockSize);
+
+                // 0x36 ^ 0x5c turns the inner pad into the outer pad
+                for (size_t i = 0; i < BlockSize; i++)
+                    block[i] ^= 0x36 ^ 0x5c;
+                outer_keyed.reset();
+                outer_keyed.update(block, BlockSize);
+
+                memset(block, 0, BlockSize);
+                current = inner_keyed;
+            }
+
+            // Hash states right after the (key ^ ipad) and (key ^ opad) blocks
+            const HashT &innerKeyedState() const { return inner_keyed; }
+            const HashT &outerKeyedState() const { return outer_keyed; }
+
+            // Restart the message, keeping the key
+            void reset()
+            {
+                current = inner_keyed;
+            }
+
+            void update(const uint8_t *data, size_t len)
+            {
+                current.update(data, len);
+            }
+
+            // Write the MAC and reset for the next message
+            void finalize(uint8_t digest[DigestSize])
+            {
+                uint8_t inner_digest[DigestSize];
+                current.finalize(inner_digest);
+
+                current = outer_keyed;
+                current.update(inner_digest, DigestSize);
+                current.finalize(digest);
+
+                memset(inner_digest, 0, DigestSize);
+                current = inner_keyed;
+            }
+
+            // Keyed one shot, does not disturb a message in progress
+            void mac(const uint8_t *data, size_t len, uint8_t digest[DigestSize]) const
+            {
+                HashT h = inner_keyed;
+                h.update(data, len);
+                uint8_t inner_digest[DigestSize];
+                h.finalize(inner_digest);
+
+                h = outer_keyed;
+                h.update(inner_digest, DigestSize);
+                h.finalize(digest);
+            }
+
+            // Compare against an expected MAC in constant time
+            bool verify(const uint8_t *data, size_t len, const uint8_t *expected, size_t expected_len = DigestSize) const
+            {
+                if (expected_len == 0 || expected_len > DigestSize)
+                    return false;
+                uint8_t digest[DigestSize];
+                mac(data, len, digest);
+                volatile uint8_t diff = 0;
+                for (size_t i = 0; i < expected_len; i++)
+                    diff |= digest[i] ^ expected[i];
+                return diff == 0;
+            }
+
+            // for convenience
+            static void hash(const uint8_t *key, size_t key_len, const uint8_t *data, size_t len, uint8_t *digest_output)
+            {
+                HMAC<HashT> hmac(key, key_len);
+                hmac.mac(data, len, digest_output);
+            }
+        };
+
+        // HKDF (RFC 5869) on top of HMAC
+        template <typename HashT>
+        class HKDF
+        {
+        public:
+            static const size_t DigestSize = HashT::DigestSize;
+
+            // PRK = HMAC(salt, ikm). An empty salt means DigestSize zeros.
+            static void extract(const uint8_t *salt, size_t salt_len, const uint8_t *ikm, size_t ikm_len, uint8_t prk[DigestSize])
+            {
+                uint8_t zeros[DigestSize];
+                if (salt == nullptr || salt_len == 0)
+                {
+                    memset(zeros, 0, DigestSize);
+                    salt = zeros;
+                    salt_len = DigestSize;
+                }
+                HMAC<HashT>::hash(salt, salt_len, ikm, ikm_len, prk);
+            }
+
+            // T(i) = HMAC(PRK, T(i-1) | info | i), output_len up to 255 * DigestSize
+            static bool expand(const uint8_t *prk, size_t prk_len, const uint8_t *info, size_t info_len, uint8_t *output, size_t output_len)
+            {
+                if (output_len > 255 * DigestSize)
+                    return false;
+
+                HMAC<HashT> hmac(prk, prk_len);
+                uint8_t t[DigestSize];
+                size_t t_len = 0;
+                uint8_t counter = 1;
+
+                while (output_len > 0)
+                {
+                    hmac.update(t, t_len);
+                    if (info_len > 0)
+                        hmac.update(info, info_len);
+                    hmac.update(&counter, 1);
+                    hmac.finalize(t);
+                    t_len = DigestSize;
+                    counter++;
+
+                    size_t to_copy = output_len;
+                    if (to_copy > DigestSize)
+                        to_copy = DigestSize;
+                    memcpy(output, t, to_copy);
+                    output += to_copy;
+                    output_len -= to_copy;
+                }
+
+                memset(t, 0, DigestSize);
+                return true;
+            }
+
+            static bool derive(const uint8_t *salt, size_t salt_len, const uint8_t *ikm, size_t ikm_len, const uint8_t *info, size_t info_len, uint8_t *output, size_t output_len)
+            {
+                uint8_t prk[DigestSize];
+                extract(salt, salt_len, ikm, ikm_len, prk);
+                bool result = expand(prk, DigestSize, info, info_len, output, output_len);
+                memset(prk, 0, DigestSize);
+                return result;
+            }
+        };
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace ITKExtension
+{
+    namespace Hashing
+    {
+        // PBKDF2-HMAC-SHA256 (RFC 8018)
+        //
+        // The HMAC pad states are computed once per password, so every iteration
+        // costs exactly two SHA-256 compressions. Independent output blocks and
+        // batched candidate passwords run interleaved in up to 8 lanes.
+        //
+        // An iteration count of 0 is invalid and aborts.
+        namespace PBKDF2
+        {
+            void sha256(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, uint32_t iterations, uint8_t *output, size_t output_len);
+            std::vector<uint8_t> sha256(const std::string &password, const std::vector<uint8_t> &salt, uint32_t iterations, size_t output_len = 32);
+
+            // Derive the keys of several passwords sharing the same salt and iteration count
+            void sha256Batch(const std::vector<std::string> &passwords, const uint8_t *salt, size_t salt_len, uint32_t iterations, size_t output_len, std::vector<std::vector<uint8_t>> *outputs);
+
+            // Compare the derived key against the expected one in constant time
+            bool verifySHA256(const std::string &password, const uint8_t *salt, size_t salt_len, uint32_t iterations, const uint8_t *expected, size_t expected_len);
+        }
+    }
+}
@@ -20,6 +20,9 @@ namespace ITKExtension
             void transform(const uint8_t block[64]);
 
         public:
+            static const size_t DigestSize = 20;
+            static const size_t BlockSize = 64;
+
             SHA1();
             void reset();
             void update(const uint8_t *data, size_t len);
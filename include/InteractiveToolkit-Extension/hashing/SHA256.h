@@ -20,11 +20,21 @@ namespace ITKExtension
             void transform(const uint8_t block[64]);
 
         public:
+            static const size_t DigestSize = 32;
+            static const size_t BlockSize = 64;
+
+            // Round constants (FIPS 180-4, 4.2.2), also used by the PBKDF2 lanes
+            static const uint32_t K[64];
+
             SHA256();
             void reset();
             void update(const uint8_t *data, size_t len);
             void finalize(uint8_t digest[32]);
 
+            // Intermediate chaining value, valid when a multiple of 64 bytes was hashed
+            // (used by PBKDF2 to keep the HMAC pad states)
+            void copyState(uint32_t output[8]) const;
+
             // for convenience
             static void hash(const uint8_t *data, size_t len, uint8_t *digest_output);
             static void hash(const uint8_t *data, size_t len, uint8_t **digest_output);
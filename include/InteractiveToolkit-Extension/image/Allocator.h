@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <mutex>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        /// \brief Memory source for the image module
+        ///
+        /// Used for the buffers returned by the PNG/JPG functions and for the
+        /// libpng internal allocations.
+        ///
+        /// The allocator is selected per thread: Allocator::Current() returns the one
+        /// installed with ScopedAllocator, or the global one (SetGlobal), or Default().
+        ///
+        /// \code
+        ///
+        /// static Image::PoolAllocator pool;
+        ///
+        /// {
+        ///     Image::ScopedAllocator use_pool(&pool);
+        ///     char *pixels = PNG::readPNG("file.png", &w, &h, &chn, &depth);
+        ///     ...
+        ///     PNG::closePNG(pixels); // the buffer goes back to the pool
+        /// }
+        ///
+        /// \endcode
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class Allocator
+        {
+        public:
+            virtual ~Allocator() = default;
+
+            virtual void *allocate(size_t size) = 0;
+            /// \brief ptr must come from allocate() of this same instance
+            virtual void release(void *ptr) = 0;
+
+            /// \brief ITKCommon::Memory::malloc / free
+            static Allocator *Default();
+
+            /// \brief Allocator used by the current thread
+            static Allocator *Current();
+
+            /// \brief Process wide allocator (nullptr restores Default)
+            ///
+            /// Must outlive every buffer allocated with it.
+            ///
+            static void SetGlobal(Allocator *allocator);
+        };
+
+        /// \brief Install an allocator for the current thread while in scope
+        class ScopedAllocator
+        {
+            Allocator *previous;
+
+        public:
+            ScopedAllocator(Allocator *allocator);
+            ~ScopedAllocator();
+
+            ScopedAllocator(const ScopedAllocator &) = delete;
+            ScopedAllocator &operator=(const ScopedAllocator &) = delete;
+        };
+
+        /// \brief Thread safe size-class pool
+        ///
+        /// Requests are rounded up to a power of two and released blocks are kept in a
+        /// free list per class, so decoding images of similar sizes reuses the same memory.
+        /// Requests above maxPooledSize go straight to ITKCommon::Memory.
+        /// At most maxCachedBytes are kept in the free lists, the rest is returned to the system.
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class PoolAllocator : public Allocator
+        {
+        public:
+            struct Stats
+            {
+                size_t hits;         ///< allocations served from a free list
+                size_t misses;       ///< allocations that went to the system
+                size_t cached_bytes; ///< bytes currently kept in the free lists
+            };
+
+        private:
+            static const int MIN_CLASS_BITS = 6; // 64 bytes
+            static const int CLASS_COUNT = 40;
+
+            mutable std::mutex mutex;
+            std::vector<void *> free_lists[CLASS_COUNT];
+            size_t maxCachedBytes;
+            size_t maxPooledSize;
+            Stats stats;
+
+        public:
+            PoolAllocator(size_t maxCachedBytes = 256 * 1024 * 1024, size_t maxPooledSize = 64 * 1024 * 1024);
+            ~PoolAllocator() override;
+
+            void *allocate(size_t size) override;
+            void release(void *ptr) override;
+
+            /// \brief Return every cached block to the system
+            void trim();
+
+            Stats getStats() const;
+
+            PoolAllocator(const PoolAllocator &) = delete;
+            PoolAllocator &operator=(const PoolAllocator &) = delete;
+        };
+
+        /// \brief Allocate a buffer handed to the user from Allocator::Current()
+        ///
+        /// The allocator is recorded with the buffer, so freeBuffer returns it to the
+        /// right place even if the current allocator changed in between.
+        /// closePNG and closeJPG call freeBuffer.
+        ///
+        void *allocBuffer(size_t size);
+        void freeBuffer(void *ptr);
+
+    }
+}
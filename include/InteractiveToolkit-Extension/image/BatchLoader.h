@@ -0,0 +1,116 @@
+#pragma once
+
+#include <InteractiveToolkit/common.h>
+#include <InteractiveToolkit/EventCore/Callback.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        /// \brief One decoded image delivered by the BatchLoader
+        ///
+        /// buffer is allocated the same as PNG::readPNG / JPG::readJPG, from the Image::Allocator
+        /// current on the thread that called run(). To keep it after the callback returns, take the
+        /// pointer and set buffer to nullptr (release it later with Image::freeBuffer or closePNG),
+        /// otherwise the loader releases it.
+        ///
+        struct BatchImage
+        {
+            size_t index;         ///< position of the input in the order it was added
+            std::string filename; ///< empty for memory inputs
+            char *buffer;
+            int w;
+            int h;
+            int chann;
+            int pixel_depth;
+            std::string error; ///< set when buffer is nullptr
+
+            bool ok() const { return buffer != nullptr; }
+        };
+
+        /// \brief Decode many PNG/JPG images on a worker pool
+        ///
+        /// One thread reads the files ahead while the workers decode from memory.
+        /// Results are delivered on the thread that calls run(), in completion order.
+        ///
+        /// The memory budget limits the bytes held by the loader: compressed data read ahead plus
+        /// decoded images not yet delivered. Reading stops while the budget is full, so a slow
+        /// consumer throttles the pipeline. An image bigger than the budget is still loaded, alone.
+        ///
+        /// \code
+        ///
+        /// Image::BatchLoader loader(0, 256 * 1024 * 1024);
+        /// for (const auto &file : files)
+        ///     loader.addFile(file);
+        ///
+        /// loader.run([&](Image::BatchImage &image)
+        /// {
+        ///     if (!image.ok()) {
+        ///         printf("%s: %s", image.filename.c_str(), image.error.c_str());
+        ///         return;
+        ///     }
+        ///     textures[image.index].upload(image.buffer, image.w, image.h, image.chann);
+        /// });
+        ///
+        /// \endcode
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class BatchLoader
+        {
+        public:
+            /// \brief Values measured by the last run()
+            struct Stats
+            {
+                size_t images;
+                size_t failed;
+                double seconds;
+                double images_per_second;
+                size_t peak_memory; ///< maximum bytes held by the loader
+            };
+
+        private:
+            struct Input
+            {
+                std::string filename;
+                const char *memory;
+                int memory_size;
+                bool invertY;
+            };
+
+            std::vector<Input> inputs;
+            int threadCount;
+            size_t memoryBudget;
+
+        public:
+            /// \param threadCount decode threads (0 = hardware concurrency)
+            /// \param memoryBudget maximum bytes held by the loader (0 = unlimited)
+            BatchLoader(int threadCount = 0, size_t memoryBudget = 0);
+
+            void addFile(const std::string &filename, bool invertY = false);
+
+            /// \brief Add a compressed image already in memory
+            ///
+            /// The buffer is not copied and must stay valid until run() returns.
+            ///
+            void addMemory(const char *input_buffer, int input_buffer_size, bool invertY = false);
+
+            size_t size() const;
+            void clear();
+
+            /// \brief Decode every input added so far
+            ///
+            /// Blocks until all images were delivered to onImageReady.
+            /// The inputs are kept, so run() can be called again.
+            ///
+            Stats run(const EventCore::Callback<void(BatchImage &image)> &onImageReady);
+        };
+
+    }
+}
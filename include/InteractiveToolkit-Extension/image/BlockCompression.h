@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace ITKExtension
+{
+    namespace IO
+    {
+        class AdvancedWriter;
+        class AdvancedReader;
+    }
+
+    namespace Image
+    {
+        namespace Resample
+        {
+            struct MipLevel;
+        }
+
+        /// \brief CPU encoder/decoder for the GPU block compression formats
+        ///
+        /// The input is always RGBA8. BC4 reads R, BC5 reads R and G
+        /// (use PixelFormat::convert to build RGBA from other layouts).
+        ///
+        /// Each 4x4 block is encoded independently, the image is split in rows of blocks
+        /// between threads. Images with a size not multiple of 4 are padded repeating the border.
+        ///
+        namespace BlockCompression
+        {
+
+            enum class Format : int
+            {
+                BC1 = 1, ///< RGB (1 bit alpha), 8 bytes per block
+                BC3 = 3, ///< RGBA, BC1 color + BC4 alpha, 16 bytes per block
+                BC4 = 4, ///< single channel (R), 8 bytes per block
+                BC5 = 5, ///< two channels (RG, normal maps), 16 bytes per block
+                BC7 = 7  ///< RGBA high quality, 16 bytes per block (mode 6)
+            };
+
+            enum class Quality : int
+            {
+                Fast,   ///< bounding box endpoints
+                Normal, ///< principal axis endpoints with one least squares refinement
+                High    ///< iterative refinement and wider endpoint searches
+            };
+
+            /// \brief Bytes of one 4x4 block
+            size_t blockSize(Format format);
+
+            /// \brief Bytes of a w x h image
+            size_t compressedSize(Format format, int w, int h);
+
+            /// \brief Encode an RGBA image
+            ///
+            /// Example:
+            ///
+            /// \code
+            ///
+            /// std::shared_ptr<uint8_t[]> rgba = atlas.createRGBA();
+            ///
+            /// std::vector<uint8_t> blocks(BlockCompression::compressedSize(BlockCompression::Format::BC3, w, h));
+            /// BlockCompression::encode(rgba.get(), w, h, w * 4,
+            ///                          BlockCompression::Format::BC3, blocks.data());
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param rgba source pixels
+            /// \param w width
+            /// \param h height
+            /// \param stride bytes between two source rows
+            /// \param format target format
+            /// \param output compressedSize(format, w, h) bytes
+            /// \param quality speed/quality trade off
+            /// \param threadCount worker threads (0 = hardware concurrency)
+            /// \return false on invalid parameters
+            ///
+            bool encode(const uint8_t *rgba, int w, int h, size_t stride, Format format, uint8_t *output,
+                        Quality quality = Quality::Normal, int threadCount = 0);
+
+            /// \brief Decode to RGBA
+            ///
+            /// BC4 decodes to (r, 0, 0, 255) and BC5 to (r, g, 0, 255).
+            /// For BC7 only the mode written by the encoder (mode 6) is supported.
+            ///
+            /// \return false on invalid parameters or an unsupported BC7 block
+            ///
+            bool decode(const uint8_t *blocks, int w, int h, Format format, uint8_t *rgba, size_t stride);
+
+            /// \brief PSNR in dB between two RGBA images, on the channels stored by the format
+            ///
+            /// Returns a large value (999) for identical images.
+            ///
+            double psnr(Format format,
+                        const uint8_t *a, size_t a_stride,
+                        const uint8_t *b, size_t b_stride,
+                        int w, int h);
+
+        }
+
+        /// \brief Block compressed texture with mip levels
+        ///
+        /// Can be saved with IO::AdvancedWriter next to the other assets.
+        ///
+        /// \code
+        ///
+        /// auto chain = Image::Resample::generateMipChain(pixels, w, h, w * 4, 4);
+        ///
+        /// Image::CompressedTexture texture;
+        /// texture.encode(chain, 4, Image::BlockCompression::Format::BC7);
+        ///
+        /// ITKExtension::IO::AdvancedWriter writer;
+        /// texture.write(&writer);
+        /// writer.writeToFile("texture.bin");
+        ///
+        /// \endcode
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class CompressedTexture
+        {
+        public:
+            struct Level
+            {
+                int w;
+                int h;
+                std::vector<uint8_t> blocks;
+            };
+
+            BlockCompression::Format format;
+            bool srgb; ///< color data is sRGB (upload as an _SRGB format)
+            std::vector<Level> levels;
+
+            CompressedTexture();
+
+            /// \brief Encode every level of a mip chain
+            ///
+            /// \param chain levels from Resample::generateMipChain (or a single level)
+            /// \param chann channels of the chain pixels (1..4)
+            ///
+            bool encode(const std::vector<Resample::MipLevel> &chain, int chann, BlockCompression::Format format,
+                        BlockCompression::Quality quality = BlockCompression::Quality::Normal, int threadCount = 0,
+                        bool srgb = true);
+
+            void write(ITKExtension::IO::AdvancedWriter *writer) const;
+            void read(ITKExtension::IO::AdvancedReader *reader);
+        };
+
+    }
+}
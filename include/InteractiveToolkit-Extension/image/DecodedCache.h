@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        /// \brief Decoded PNG/JPG image shared by the DecodedCache
+        ///
+        /// The buffer is released with Image::freeBuffer when the last reference goes away.
+        ///
+        class DecodedImage
+        {
+        public:
+            char *buffer;
+            int w;
+            int h;
+            int chann;
+            int pixel_depth;
+
+            DecodedImage();
+            ~DecodedImage();
+
+            /// \brief Bytes of the pixel buffer
+            size_t size() const;
+
+            DecodedImage(const DecodedImage &) = delete;
+            DecodedImage &operator=(const DecodedImage &) = delete;
+        };
+
+        /// \brief Cache of decoded PNG/JPG images keyed by the content of the compressed data
+        ///
+        /// The key is a 64 bits hash of the encoded bytes, their size and the decode
+        /// parameters (invertY and the JPG target size), so the same blob loaded from different
+        /// places hits the same entry.
+        ///
+        /// The cache keeps the most recently used images while their pixel bytes fit in the
+        /// memory budget. Evicting only drops the cache reference: a shared_ptr returned by get()
+        /// stays valid. An image bigger than the whole budget is returned but not kept.
+        ///
+        /// get() is thread safe. Decoding runs outside the lock, so two threads missing the
+        /// same key at the same time both decode it, and the first one inserted is kept.
+        ///
+        /// \code
+        ///
+        /// static Image::DecodedCache cache(64 * 1024 * 1024);
+        ///
+        /// std::shared_ptr<const Image::DecodedImage> image = cache.get(blob.data, (int)blob.size);
+        /// if (image != nullptr)
+        ///     texture.upload(image->buffer, image->w, image->h, image->chann);
+        ///
+        /// \endcode
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class DecodedCache
+        {
+        public:
+            struct Stats
+            {
+                size_t hits;
+                size_t misses;
+                size_t evictions;
+                size_t entries; ///< images currently cached
+                size_t bytes;   ///< pixel bytes currently cached
+            };
+
+        private:
+            /// \private
+            struct Key
+            {
+                uint64_t hash;
+                uint64_t size;
+                int target_width;
+                int target_height;
+                bool invertY;
+
+                bool operator==(const Key &other) const;
+            };
+
+            /// \private
+            struct KeyHasher
+            {
+                size_t operator()(const Key &key) const;
+            };
+
+            /// \private
+            struct Entry
+            {
+                Key key;
+                std::shared_ptr<const DecodedImage> image;
+            };
+
+            mutable std::mutex mutex;
+            std::list<Entry> lru; // most recently used first
+            std::unordered_map<Key, std::list<Entry>::iterator, KeyHasher> entries;
+            size_t memoryBudget;
+            Stats stats;
+
+            void evict_to_budget();
+
+        public:
+            /// \param memoryBudget maximum pixel bytes kept by the cache
+            DecodedCache(size_t memoryBudget = 64 * 1024 * 1024);
+
+            /// \brief Decode a compressed PNG/JPG buffer, or return the cached result
+            ///
+            /// The format is detected from the first bytes.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param input_buffer compressed data
+            /// \param input_buffer_size compressed data size
+            /// \param invertY should invert the loaded image vertically
+            /// \param target_width JPG: minimum width decoded with DCT scaling (0 = full size), ignored by PNG
+            /// \param target_height JPG: minimum height decoded with DCT scaling (0 = full size), ignored by PNG
+            /// \param[out] errorStr reason of a failed decode
+            /// \return the image, nullptr when it cannot be decoded (failures are not cached)
+            ///
+            std::shared_ptr<const DecodedImage> get(const char *input_buffer, int input_buffer_size,
+                                                    bool invertY = false,
+                                                    int target_width = 0, int target_height = 0,
+                                                    std::string *errorStr = nullptr);
+
+            void setMemoryBudget(size_t memoryBudget);
+            size_t getMemoryBudget() const;
+
+            /// \brief Drop every cached image
+            void clear();
+
+            Stats getStats() const;
+
+            /// \brief Zero the hit, miss and eviction counters
+            void resetStats();
+
+            /// \brief 64 bits content hash used for the keys (xxHash64)
+            static uint64_t Hash(const void *data, size_t size, uint64_t seed = 0);
+
+            DecodedCache(const DecodedCache &) = delete;
+            DecodedCache &operator=(const DecodedCache &) = delete;
+        };
+
+    }
+}
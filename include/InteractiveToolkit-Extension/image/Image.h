@@ -0,0 +1,145 @@
+#pragma once
+
+#include <InteractiveToolkit/Platform/Core/ObjectBuffer.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <memory>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        enum class FileFormat : int
+        {
+            Unknown,
+            PNG,
+            JPG
+        };
+
+        /// \brief Detect the compressed format from the first bytes (magic numbers)
+        FileFormat detectFormat(const uint8_t *data, size_t size);
+
+        /// \brief Pixel buffer with shared ownership and row stride
+        ///
+        /// Copying an Image copies the reference, not the pixels. crop() and flipY() return
+        /// views of the same memory, the pixels are released when the last Image using them is gone.
+        ///
+        /// stride is the signed byte distance between two rows, flipY() negates it.
+        ///
+        /// \code
+        ///
+        /// std::string error;
+        /// Image::Image image = Image::load("sprites.png", false, &error);
+        /// if (image.empty()) {
+        ///     printf("%s", error.c_str());
+        ///     return;
+        /// }
+        ///
+        /// // no copies
+        /// Image::Image icon = image.crop(32, 0, 32, 32).flipY();
+        ///
+        /// atlas.addElement("icon", icon);
+        ///
+        /// \endcode
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class Image
+        {
+            std::shared_ptr<void> storage;
+
+        public:
+            uint8_t *data;    ///< first byte of row 0
+            int w;
+            int h;
+            int chann;        ///< 1 = gray, 2 = gray+alpha, 3 = RGB, 4 = RGBA
+            int pixel_depth;  ///< bits per channel (8 or 16)
+            ptrdiff_t stride; ///< bytes from one row to the next
+
+            /// \brief Empty image
+            Image();
+
+            /// \brief Allocate an image with Image::allocBuffer (content not initialized)
+            static Image Create(int w, int h, int chann, int pixel_depth = 8);
+
+            /// \brief Take the ownership of a buffer returned by the PNG/JPG read functions
+            ///
+            /// Only 8 and 16 bits buffers are accepted, others are released and an empty image is returned.
+            ///
+            static Image FromBuffer(char *buffer, int w, int h, int chann, int pixel_depth);
+
+            /// \brief View of external memory
+            ///
+            /// owner is kept alive while the image (or any view of it) exists,
+            /// with nullptr the memory must outlive the image.
+            ///
+            /// \code
+            ///
+            /// std::shared_ptr<uint8_t[]> rgba = atlas.createRGBA();
+            /// Image::Image image = Image::Image::Wrap(rgba.get(), w, h, 4, w * 4, 8, rgba);
+            ///
+            /// \endcode
+            ///
+            static Image Wrap(uint8_t *data, int w, int h, int chann, ptrdiff_t stride, int pixel_depth = 8,
+                              std::shared_ptr<void> owner = nullptr);
+
+            bool empty() const;
+
+            /// \brief Bytes of one pixel
+            int pixelBytes() const;
+
+            /// \brief Bytes of the pixels of one row (without padding)
+            size_t rowBytes() const;
+
+            /// \brief Rows are adjacent in memory, top to bottom
+            bool isContiguous() const;
+
+            uint8_t *row(int y) const;
+            uint8_t *pixel(int x, int y) const;
+
+            /// \brief View of a rectangle, clipped to the image bounds
+            Image crop(int x, int y, int w, int h) const;
+
+            /// \brief View with the rows in reverse order
+            Image flipY() const;
+
+            /// \brief Contiguous copy of the pixels
+            Image clone() const;
+
+            /// \brief Contiguous copy with another channel count (8 bits images only)
+            Image convert(int chann) const;
+
+            /// \brief Copy the pixels to an image (or view) of the same size
+            ///
+            /// 8 bits images can have different channel counts (see PixelFormat::convert),
+            /// 16 bits images must match.
+            ///
+            /// \return false on size, channel or depth mismatch
+            ///
+            bool copyTo(const Image &dst) const;
+        };
+
+        /// \brief Decode a compressed PNG/JPG buffer, detecting the format from its first bytes
+        ///
+        /// 1, 2 and 4 bits PNG files are unpacked to 8 bits: gray levels are scaled to 0..255,
+        /// palette images keep their indices as readPNG does for 8 bits files.
+        ///
+        /// \author Alessandro Ribeiro
+        /// \param buffer compressed data
+        /// \param invertY should invert the loaded image vertically
+        /// \param[out] errorStr reason of a failure
+        /// \return the image, empty on failure
+        ///
+        Image decode(const Platform::ObjectBuffer &buffer, bool invertY = false, std::string *errorStr = nullptr);
+
+        /// \brief Decode a compressed PNG/JPG buffer, detecting the format from its first bytes
+        Image decode(const uint8_t *data, size_t size, bool invertY = false, std::string *errorStr = nullptr);
+
+        /// \brief Read and decode a PNG/JPG file, detecting the format from its content
+        Image load(const std::string &filename, bool invertY = false, std::string *errorStr = nullptr);
+
+    }
+}
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <InteractiveToolkit/common.h>
+#include <InteractiveToolkit/EventCore/Callback.h>
+
 #include <stdlib.h> // nullptr
+#include <stddef.h>
 #include <string>
 
 namespace ITKExtension
@@ -38,8 +42,47 @@ namespace ITKExtension
             ///
             char *readJPG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false, float *gamma = nullptr, std::string *errorStr = nullptr);
 
+            /// \brief Write JPG format to a file
+            ///
+            /// chann can be 1 to 4. JPEG has no alpha: gray+alpha is written as gray and RGBA as RGB.
+            ///
             bool writeJPG(const char *file_name, int w, int h, int chann, char *buffer, int quality = 90, bool invertY = false, std::string *errorStr = nullptr);
 
+            /// \brief Read JPG format from file, downscaled during decoding
+            ///
+            /// libjpeg can scale the image by 1/2, 1/4 or 1/8 inside the IDCT.
+            /// The smallest of these scales with an output at or above target_width x target_height
+            /// is used, so the result can be larger than the target but never smaller
+            /// (unless the source itself is smaller). A target of 0 ignores that axis.
+            ///
+            /// \code
+            ///
+            /// int w, h, chn, depth;
+            /// char*bufferChar;
+            ///
+            /// // thumbnail with at least 256 pixels of width
+            /// bufferChar = JPG::readJPGScaled( "file.jpg", 256, 0, &w, &h, &chn, &depth);
+            /// if (bufferChar != nullptr) {
+            ///     ...
+            ///     JPG::closeJPG(bufferChar);
+            /// }
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to load
+            /// \param target_width minimum width of the decoded image (0 = any)
+            /// \param target_height minimum height of the decoded image (0 = any)
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \param invertY should invert the loaded image vertically
+            /// \param[out] gamma the gamma value stored in JPG file
+            /// \return The raw image buffer or nullptr if cannot open file.
+            ///
+            char *readJPGScaled(const char *file_name, int target_width, int target_height, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false, float *gamma = nullptr, std::string *errorStr = nullptr);
+
+
 
             /// \brief Read JPG format from memory stream
             ///
@@ -73,13 +116,159 @@ namespace ITKExtension
             ///
             char *readJPGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false, float *gamma = nullptr);
 
-            char *writeJPGToMemory(int *output_size, int w, int h, int chann, char *buffer, int quality = 90, bool invertY = false);
+            /// \brief Read JPG format from memory stream, downscaled during decoding
+            ///
+            /// Same as readJPGScaled, reading the compressed data from memory.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param input_buffer Input raw JPG compressed buffer
+            /// \param input_buffer_size Buffer size
+            /// \param target_width minimum width of the decoded image (0 = any)
+            /// \param target_height minimum height of the decoded image (0 = any)
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \param invertY should invert the loaded image vertically
+            /// \param[out] gamma the gamma value stored in JPG file
+            /// \return The raw image buffer or nullptr if cannot open file.
+            ///
+            char *readJPGFromMemoryScaled(const char *input_buffer, int input_buffer_size, int target_width, int target_height, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false, float *gamma = nullptr);
+
+            /// \brief Write JPG format to a memory stream
+            ///
+            /// Same as writeJPG. The result must be released with closeJPG.
+            ///
+            /// \return The compressed JPG buffer or nullptr if the channel count is not supported.
+            ///
+            char *writeJPGToMemory(int *output_size, int w, int h, int chann, char *buffer, int quality = 90, bool invertY = false, std::string *errorStr = nullptr);
+
+
+            /// \brief Receives the image information before the first band of rows
+            ///
+            /// Return false to stop decoding.
+            ///
+            typedef EventCore::Callback<bool(int w, int h, int chann, int pixel_depth)> HeaderCallback;
+
+            /// \brief Receives row_count decoded rows, starting at first_row, row_stride bytes apart
+            ///
+            /// The rows are only valid during the call. Return false to stop decoding.
+            ///
+            typedef EventCore::Callback<bool(const char *rows, int first_row, int row_count, size_t row_stride)> RowCallback;
+
+            /// \brief Decode a JPG file band by band
+            ///
+            /// Rows are decoded with jpeg_read_scanlines into a band buffer and handed to onRows
+            /// top-down, so memory use does not depend on the image height.
+            /// The band is never smaller than libjpeg's rec_outbuf_height.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to load
+            /// \param onHeader called once with width, height, channels and pixel depth (optional)
+            /// \param onRows called for every band of rows
+            /// \param band_rows number of rows per band
+            /// \return true when every row was delivered
+            ///
+            bool readJPGRows(const char *file_name, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows = 16, std::string *errorStr = nullptr);
+
+            /// \brief Decode a JPG from memory band by band
+            ///
+            /// Same as readJPGRows, reading the compressed data from memory.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param input_buffer Input raw JPG compressed buffer
+            /// \param input_buffer_size Buffer size
+            /// \param onHeader called once with width, height, channels and pixel depth (optional)
+            /// \param onRows called for every band of rows
+            /// \param band_rows number of rows per band
+            /// \return true when every row was delivered
+            ///
+            bool readJPGRowsFromMemory(const char *input_buffer, int input_buffer_size, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows = 16, std::string *errorStr = nullptr);
+
+            /// \brief Read only the JPG header from file
+            ///
+            /// Walks the marker segments up to the frame header (SOFn) without
+            /// decoding any pixel data. The values match what readJPG would return.
+            ///
+            /// \code
+            ///
+            /// int w, h, chn, depth;
+            /// if (JPG::probeJPG( "file.jpg", &w, &h, &chn, &depth)) {
+            ///     ...
+            /// }
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to probe
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \return true if a valid frame header was found.
+            ///
+            bool probeJPG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, std::string *errorStr = nullptr);
+
+            /// \brief Read only the JPG header from memory stream
+            ///
+            /// Same as probeJPG, reading from a memory buffer.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param input_buffer Input raw JPG compressed buffer
+            /// \param input_buffer_size Buffer size
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \return true if a valid frame header was found.
+            ///
+            bool probeJPGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth);
 
+            /// \brief Fills row_count rows, starting at first_row, row_stride bytes apart
+            ///
+            /// Return false to stop encoding.
+            ///
+            typedef EventCore::Callback<bool(char *rows, int first_row, int row_count, size_t row_stride)> RowSourceCallback;
+
+            /// \brief Write JPG format to file pulling the rows band by band
+            ///
+            /// getRows is called top-down to fill a band buffer of band_rows rows, that is
+            /// compressed with jpeg_write_scanlines before the next band is requested.
+            /// The full image is never in memory.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to save
+            /// \param w width
+            /// \param h height
+            /// \param chann channels (1..4, the alpha of 2 and 4 channels is dropped)
+            /// \param getRows fills each band of rows
+            /// \param band_rows number of rows per band
+            /// \param quality JPG quality (0..100)
+            /// \return true on success
+            ///
+            bool writeJPGRows(const char *file_name, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows = 16, int quality = 90, std::string *errorStr = nullptr);
+
+            /// \brief Write JPG format to a memory stream pulling the rows band by band
+            ///
+            /// Same as writeJPGRows. The result must be released with closeJPG.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param[out] output_size the writen buffer size
+            /// \param w width
+            /// \param h height
+            /// \param chann channels (1..4, the alpha of 2 and 4 channels is dropped)
+            /// \param getRows fills each band of rows
+            /// \param band_rows number of rows per band
+            /// \param quality JPG quality (0..100)
+            /// \return The compressed JPG buffer
+            ///
+            char *writeJPGRowsToMemory(int *output_size, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows = 16, int quality = 90);
 
             /// \brief Closes the image buffer after a read or memory write.
             ///
             /// Should be called after any success read or memory write JPG image.
             ///
+            /// The buffer goes back to the Image::Allocator it was allocated from.
+            ///
             /// \code
                     ///
             /// int w, h, chn, depth;
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <InteractiveToolkit/common.h>
+#include <InteractiveToolkit/EventCore/Callback.h>
+
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 
 namespace ITKExtension
@@ -14,6 +19,10 @@ namespace ITKExtension
             ///
             /// It returns the raw imagem buffer and: width, height, number of channels, pixel_depth.
             ///
+            /// The samples are returned as stored: 16 bits files give pixel_depth 16 with
+            /// little endian samples (2 bytes per channel). Palette images return their indices,
+            /// use readPNGIndexed to get the palette too.
+            ///
             /// \code
                     ///
             /// int w, h, chn, depth;
@@ -37,6 +46,136 @@ namespace ITKExtension
             ///
             char *readPNG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false, std::string *errorStr = nullptr);
 
+            /// \brief Read a palette PNG keeping 1 byte per pixel
+            ///
+            /// Returns one palette index per pixel (1, 2 and 4 bits files are unpacked)
+            /// and the palette as RGBA (the alpha comes from the tRNS chunk, 255 when absent).
+            ///
+            /// \code
+            ///
+            /// uint8_t palette[256 * 4];
+            /// int w, h, palette_size;
+            /// char *indices = PNG::readPNGIndexed("glyphs.png", &w, &h, palette, &palette_size);
+            /// if (indices != nullptr) {
+            ///     ...
+            ///     PNG::closePNG(indices);
+            /// }
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to load
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] palette_rgba 256 RGBA entries
+            /// \param[out] palette_size entries used
+            /// \param invertY should invert the loaded image vertically
+            /// \return The index buffer, nullptr on error or when the file is not a palette image.
+            ///
+            char *readPNGIndexed(const char *file_name, int *w, int *h, uint8_t *palette_rgba, int *palette_size, bool invertY = false, std::string *errorStr = nullptr);
+
+            /// \brief Same as readPNGIndexed, reading the compressed data from memory
+            char *readPNGIndexedFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, uint8_t *palette_rgba, int *palette_size, bool invertY = false, std::string *errorStr = nullptr);
+
+            /// \brief Read PNG format from file into a caller supplied buffer
+            ///
+            /// The rows are decoded directly into the output buffer, no intermediate copy is made.
+            ///
+            /// \code
+            ///
+            /// std::vector<char> pixels(max_w * max_h * 4);
+            /// int w, h, chn, depth;
+            ///
+            /// if (PNG::readPNGToBuffer( "file.png", pixels.data(), max_w * 4, pixels.size(), &w, &h, &chn, &depth)) {
+            ///     ...
+            /// }
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to load
+            /// \param output destination buffer
+            /// \param output_stride bytes between the start of two rows in output (0 = packed rows)
+            /// \param output_capacity output buffer size in bytes
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \param invertY should invert the loaded image vertically
+            /// \return true on success. On a too small buffer it returns false with w, h, chann and pixel_depth set.
+            ///
+            bool readPNGToBuffer(const char *file_name, char *output, size_t output_stride, size_t output_capacity, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false, std::string *errorStr = nullptr);
+
+            /// \brief zlib strategy used to deflate the filtered rows
+            enum class EncodeStrategy : int
+            {
+                LibraryDefault = -1, // let libpng choose
+                Default,             // Z_DEFAULT_STRATEGY
+                Filtered,            // Z_FILTERED
+                HuffmanOnly,         // Z_HUFFMAN_ONLY
+                RLE,                 // Z_RLE, fast and good on flat images
+                Fixed                // Z_FIXED
+            };
+
+            /// \brief Scanline filter applied before deflate
+            enum class EncodeFilter : int
+            {
+                Adaptive = -1, // libpng tries every filter on each row
+                None,
+                Sub,
+                Up,
+                Average,
+                Paeth
+            };
+
+            /// \brief Indexed color output of the 8 bits writers
+            enum class PaletteMode : int
+            {
+                Off, ///< write gray/RGB/RGBA as given
+                /// images with at most 256 distinct colors are also encoded as a palette image
+                /// (1, 2, 4 or 8 bits per index, lossless) and the smaller output is kept.
+                /// writePNG, writePNGToMemory and the parallel writers apply it (the palette image
+                /// is encoded on a single thread), the rows writers do not see the whole image and ignore it.
+                Auto
+            };
+
+            /// \brief PNG encoder settings
+            ///
+            /// The default constructed value keeps the libpng defaults (zlib level 6, adaptive filter).
+            ///
+            /// \code
+            ///
+            /// PNG::EncodeStats stats;
+            /// PNG::writePNG("atlas.png", w, h, 4, (char*)buffer_rgba, PNG::EncodeOptions::Fast(), false, &stats);
+            /// printf("%f ms, %zu bytes\n", stats.encode_ms, stats.output_size);
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            ///
+            struct EncodeOptions
+            {
+                int compression_level; ///< zlib level 0..9, -1 = libpng default
+                EncodeStrategy strategy;
+                EncodeFilter filter;
+                PaletteMode palette;
+
+                EncodeOptions();
+
+                /// \brief libpng defaults
+                static EncodeOptions Default();
+                /// \brief zlib level 1 with the Up filter on every row. About 5x faster than Default, larger output.
+                static EncodeOptions Fast();
+                /// \brief zlib level 9 with adaptive filtering, automatic palette
+                static EncodeOptions Smallest();
+            };
+
+            /// \brief Measures reported by the encoder
+            struct EncodeStats
+            {
+                double encode_ms;   ///< wall time spent encoding (and writing the file)
+                size_t output_size; ///< PNG size in bytes
+            };
+
             /// \brief Write PNG format to file
             ///
             /// \code
@@ -67,10 +206,77 @@ namespace ITKExtension
             ///
             bool writePNG(const char *file_name, int w, int h, int chann, char *buffer, bool invertY = false, std::string *errorStr = nullptr);
 
+            /// \brief Write PNG format to file with custom encoder settings
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to save
+            /// \param w width
+            /// \param h height
+            /// \param chann channels
+            /// \param buffer input image buffer
+            /// \param options compression level, strategy and filter
+            /// \param invertY should invert the loaded image vertically
+            /// \param[out] stats encode time and output size (optional)
+            /// \return true on success
+            ///
+            bool writePNG(const char *file_name, int w, int h, int chann, char *buffer, const EncodeOptions &options, bool invertY = false, EncodeStats *stats = nullptr, std::string *errorStr = nullptr);
+
+            /// \brief Write a palette PNG from 1 byte per pixel indices
+            ///
+            /// The bit depth is the smallest that holds palette_size entries (1, 2, 4 or 8 bits).
+            /// Entries with alpha below 255 are stored in a tRNS chunk, place them first
+            /// in the palette to keep it short.
+            ///
+            /// \code
+            ///
+            /// uint8_t palette[2 * 4] = {0, 0, 0, 0, 255, 255, 255, 255};
+            /// PNG::writePNGIndexed("mask.png", w, h, indices, palette, 2);
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to save
+            /// \param w width
+            /// \param h height
+            /// \param indices w * h palette indices, all below palette_size
+            /// \param palette_rgba palette_size RGBA entries
+            /// \param palette_size 1..256
+            /// \param options compression level, strategy and filter
+            /// \param invertY should invert the image vertically
+            /// \param[out] stats encode time and output size (optional)
+            /// \return true on success, false when an index is not below palette_size
+            ///
+            bool writePNGIndexed(const char *file_name, int w, int h, const uint8_t *indices, const uint8_t *palette_rgba, int palette_size, const EncodeOptions &options = EncodeOptions(), bool invertY = false, EncodeStats *stats = nullptr, std::string *errorStr = nullptr);
+
+            /// \brief Same as writePNGIndexed, to a buffer released with closePNG
+            char *writePNGIndexedToMemory(int *output_size, int w, int h, const uint8_t *indices, const uint8_t *palette_rgba, int palette_size, const EncodeOptions &options = EncodeOptions(), bool invertY = false, EncodeStats *stats = nullptr);
+
+            /// \brief Write a 16 bits per channel PNG
+            ///
+            /// The samples are little endian, the layout readPNG returns for 16 bits files.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to save
+            /// \param w width
+            /// \param h height
+            /// \param chann channels (1..4)
+            /// \param buffer w * h * chann samples
+            /// \param options compression level, strategy and filter (the palette mode does not apply)
+            /// \param invertY should invert the image vertically
+            /// \param[out] stats encode time and output size (optional)
+            /// \return true on success
+            ///
+            bool writePNG16(const char *file_name, int w, int h, int chann, const uint16_t *buffer, const EncodeOptions &options = EncodeOptions(), bool invertY = false, EncodeStats *stats = nullptr, std::string *errorStr = nullptr);
+
+            /// \brief Same as writePNG16, to a buffer released with closePNG
+            char *writePNG16ToMemory(int *output_size, int w, int h, int chann, const uint16_t *buffer, const EncodeOptions &options = EncodeOptions(), bool invertY = false, EncodeStats *stats = nullptr);
+
             /// \brief Closes the image buffer after a read or memory write.
             ///
             /// Should be called after any success read or memory write PNG image.
             ///
+            /// The buffer goes back to the Image::Allocator it was allocated from.
+            ///
             /// \code
                     ///
             /// int w, h, chn, depth;
@@ -119,6 +325,171 @@ namespace ITKExtension
             ///
             char *readPNGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false);
 
+            /// \brief Read PNG format from memory stream into a caller supplied buffer
+            ///
+            /// Same as readPNGToBuffer, reading the compressed data from memory.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param input_buffer Input raw PNG compressed buffer
+            /// \param input_buffer_size Buffer size
+            /// \param output destination buffer
+            /// \param output_stride bytes between the start of two rows in output (0 = packed rows)
+            /// \param output_capacity output buffer size in bytes
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \param invertY should invert the loaded image vertically
+            /// \return true on success. On a too small buffer it returns false with w, h, chann and pixel_depth set.
+            ///
+            bool readPNGFromMemoryToBuffer(const char *input_buffer, int input_buffer_size, char *output, size_t output_stride, size_t output_capacity, int *w, int *h, int *chann, int *pixel_depth, bool invertY = false, std::string *errorStr = nullptr);
+
+            /// \brief Receives the image information before the first band of rows
+            ///
+            /// Return false to stop decoding.
+            ///
+            typedef EventCore::Callback<bool(int w, int h, int chann, int pixel_depth)> HeaderCallback;
+
+            /// \brief Receives row_count decoded rows, starting at first_row, row_stride bytes apart
+            ///
+            /// The rows are only valid during the call. Return false to stop decoding.
+            ///
+            typedef EventCore::Callback<bool(const char *rows, int first_row, int row_count, size_t row_stride)> RowCallback;
+
+            /// \brief Decode a PNG file band by band
+            ///
+            /// Rows are decoded with png_read_row into a band buffer of band_rows rows and handed
+            /// to onRows top-down, so memory use does not depend on the image height.
+            /// Interlaced (Adam7) images are the exception: their rows are only complete after the
+            /// last pass, so the whole frame is decoded first and then delivered in bands.
+            ///
+            /// \code
+            ///
+            /// SHA256 sha;
+            /// bool ok = PNG::readPNGRows("huge.png",
+            ///     [](int w, int h, int chann, int depth) { return true; },
+            ///     [&](const char *rows, int first_row, int row_count, size_t row_stride)
+            ///     {
+            ///         sha.update((const uint8_t *)rows, row_stride * row_count);
+            ///         return true;
+            ///     });
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to load
+            /// \param onHeader called once with width, height, channels and pixel depth (optional)
+            /// \param onRows called for every band of rows
+            /// \param band_rows number of rows per band
+            /// \return true when every row was delivered
+            ///
+            bool readPNGRows(const char *file_name, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows = 16, std::string *errorStr = nullptr);
+
+            /// \brief Decode a PNG from memory band by band
+            ///
+            /// Same as readPNGRows, reading the compressed data from memory.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param input_buffer Input raw PNG compressed buffer
+            /// \param input_buffer_size Buffer size
+            /// \param onHeader called once with width, height, channels and pixel depth (optional)
+            /// \param onRows called for every band of rows
+            /// \param band_rows number of rows per band
+            /// \return true when every row was delivered
+            ///
+            bool readPNGRowsFromMemory(const char *input_buffer, int input_buffer_size, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows = 16, std::string *errorStr = nullptr);
+
+            /// \brief Read only the PNG header from file
+            ///
+            /// Parses the signature and the IHDR chunk (the first 33 bytes of the file)
+            /// without decompressing any pixel data. The values match what readPNG would return.
+            ///
+            /// \code
+            ///
+            /// int w, h, chn, depth;
+            /// if (PNG::probePNG( "file.png", &w, &h, &chn, &depth)) {
+            ///     // allocate w * h * chn * (depth / 8) bytes and call readPNGToBuffer
+            /// }
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to probe
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \return true if the file starts with a valid PNG header.
+            ///
+            bool probePNG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, std::string *errorStr = nullptr);
+
+            /// \brief Read only the PNG header from memory stream
+            ///
+            /// Same as probePNG, reading from a memory buffer.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param input_buffer Input raw PNG compressed buffer
+            /// \param input_buffer_size Buffer size
+            /// \param[out] w width
+            /// \param[out] h height
+            /// \param[out] chann channels
+            /// \param[out] pixel_depth pixel depth
+            /// \return true if the buffer starts with a valid PNG header.
+            ///
+            bool probePNGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth);
+
+            /// \brief Fills row_count rows, starting at first_row, row_stride bytes apart
+            ///
+            /// Return false to stop encoding.
+            ///
+            typedef EventCore::Callback<bool(char *rows, int first_row, int row_count, size_t row_stride)> RowSourceCallback;
+
+            /// \brief Write PNG format to file pulling the rows band by band
+            ///
+            /// getRows is called top-down to fill a band buffer of band_rows rows, that is
+            /// compressed before the next band is requested. The full image is never in memory.
+            ///
+            /// \code
+            ///
+            /// PNG::writePNGRows("render.png", w, h, 4,
+            ///     [&](char *rows, int first_row, int row_count, size_t row_stride)
+            ///     {
+            ///         for (int i = 0; i < row_count; i++)
+            ///             renderer.renderRow(first_row + i, rows + i * row_stride);
+            ///         return true;
+            ///     }, 64);
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to save
+            /// \param w width
+            /// \param h height
+            /// \param chann channels
+            /// \param getRows fills each band of rows
+            /// \param band_rows number of rows per band
+            /// \param options compression level, strategy and filter
+            /// \param[out] stats encode time and output size (optional)
+            /// \return true on success
+            ///
+            bool writePNGRows(const char *file_name, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows = 16, const EncodeOptions &options = EncodeOptions(), EncodeStats *stats = nullptr, std::string *errorStr = nullptr);
+
+            /// \brief Write PNG format to a memory stream pulling the rows band by band
+            ///
+            /// Same as writePNGRows. The result must be released with closePNG.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param[out] output_size the writen buffer size
+            /// \param w width
+            /// \param h height
+            /// \param chann channels
+            /// \param getRows fills each band of rows
+            /// \param band_rows number of rows per band
+            /// \param options compression level, strategy and filter
+            /// \param[out] stats encode time and output size (optional)
+            /// \return The compressed PNG buffer
+            ///
+            char *writePNGRowsToMemory(int *output_size, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows = 16, const EncodeOptions &options = EncodeOptions(), EncodeStats *stats = nullptr);
+
             /// \brief Write PNG format to a memory stream
             ///
             /// \code
@@ -164,6 +535,71 @@ namespace ITKExtension
             ///
             char *writePNGToMemory(int *output_size, int w, int h, int chann, char *buffer, bool invertY = false);
 
+            /// \brief Write PNG format to a memory stream with custom encoder settings
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param[out] output_size the writen buffer size
+            /// \param w width
+            /// \param h height
+            /// \param chann channels
+            /// \param buffer input image buffer
+            /// \param options compression level, strategy and filter
+            /// \param invertY should invert the loaded image vertically
+            /// \param[out] stats encode time and output size (optional)
+            /// \return The compressed PNG buffer
+            ///
+            char *writePNGToMemory(int *output_size, int w, int h, int chann, char *buffer, const EncodeOptions &options, bool invertY = false, EncodeStats *stats = nullptr);
+
+            /// \brief Write PNG format to file using several threads
+            ///
+            /// The rows are split in strips that are filtered and deflated in parallel.
+            /// The strips are joined with sync flushes into a single zlib stream, so the result
+            /// is a standard PNG with one IDAT chunk per strip.
+            ///
+            /// EncodeFilter::Adaptive uses the same minimum sum of absolute differences heuristic as libpng.
+            ///
+            /// With PaletteMode::Auto the image is also encoded as a palette image when it has at most
+            /// 256 colors, on a single thread, and the smaller output is kept.
+            ///
+            /// \code
+            ///
+            /// PNG::EncodeStats stats;
+            /// PNG::writePNGParallel("atlas.png", w, h, 4, (char*)buffer_rgba, PNG::EncodeOptions::Fast(), false, 0, &stats);
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param file_name Filename to save
+            /// \param w width
+            /// \param h height
+            /// \param chann channels
+            /// \param buffer input image buffer
+            /// \param options compression level, strategy and filter
+            /// \param invertY should invert the loaded image vertically
+            /// \param threadCount number of threads (0 = hardware concurrency)
+            /// \param[out] stats encode time and output size (optional)
+            /// \return true on success
+            ///
+            bool writePNGParallel(const char *file_name, int w, int h, int chann, const char *buffer, const EncodeOptions &options = EncodeOptions(), bool invertY = false, int threadCount = 0, EncodeStats *stats = nullptr, std::string *errorStr = nullptr);
+
+            /// \brief Write PNG format to a memory stream using several threads
+            ///
+            /// Same as writePNGParallel. The result must be released with closePNG.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param[out] output_size the writen buffer size
+            /// \param w width
+            /// \param h height
+            /// \param chann channels
+            /// \param buffer input image buffer
+            /// \param options compression level, strategy and filter
+            /// \param invertY should invert the loaded image vertically
+            /// \param threadCount number of threads (0 = hardware concurrency)
+            /// \param[out] stats encode time and output size (optional)
+            /// \return The compressed PNG buffer
+            ///
+            char *writePNGToMemoryParallel(int *output_size, int w, int h, int chann, const char *buffer, const EncodeOptions &options = EncodeOptions(), bool invertY = false, int threadCount = 0, EncodeStats *stats = nullptr);
+
             bool isPNGFilename(const char *filename);
         }
     }
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+        /// \brief 8 bits per channel pixel conversions
+        ///
+        /// The channel count follows the PNG/JPG functions: 1 = gray, 2 = gray+alpha, 3 = RGB, 4 = RGBA.
+        ///
+        /// Every function works on a w x h region with independent source and target strides (in bytes),
+        /// so it can read from or write to a rectangle inside a bigger image.
+        ///
+        /// The row loops use SSE2/SSSE3 or NEON when the compiler targets them, with a scalar fallback.
+        ///
+        namespace PixelFormat
+        {
+
+            /// \brief Convert between channel counts
+            ///
+            /// - Expanding gray replicates it to RGB.
+            /// - A missing alpha is set to 255.
+            /// - Packing to gray takes the first channel (the atlas stores gray as R = G = B).
+            /// - Same channel count is a row copy.
+            ///
+            /// Example:
+            ///
+            /// \code
+            ///
+            /// // RGBA rectangle at (x, y) of an atlas to a tight RGB buffer
+            /// PixelFormat::convert(&atlas[y * atlas_w * 4 + x * 4], 4, atlas_w * 4,
+            ///                      rgb, 3, w * 3,
+            ///                      w, h);
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param src source pixels
+            /// \param src_chann source channel count (1..4)
+            /// \param src_stride bytes between two source rows
+            /// \param dst target pixels
+            /// \param dst_chann target channel count (1..4)
+            /// \param dst_stride bytes between two target rows
+            /// \param w width in pixels
+            /// \param h height in pixels
+            /// \return false when a channel count is out of range
+            ///
+            bool convert(const uint8_t *src, int src_chann, size_t src_stride,
+                         uint8_t *dst, int dst_chann, size_t dst_stride,
+                         int w, int h);
+
+            /// \brief Copy one channel to a single channel buffer
+            ///
+            /// extractChannel(rgba, 4, 3, ...) extracts the alpha.
+            ///
+            void extractChannel(const uint8_t *src, int src_chann, int channel, size_t src_stride,
+                                uint8_t *dst, size_t dst_stride,
+                                int w, int h);
+
+            /// \brief Reorder the channels of a 4 channel image
+            ///
+            /// Each target channel i receives the source channel order_i.
+            /// swizzle(..., 2, 1, 0, 3) converts RGBA to BGRA.
+            ///
+            /// src and dst can be the same buffer when the strides are the same.
+            ///
+            void swizzle(const uint8_t *src, size_t src_stride,
+                         uint8_t *dst, size_t dst_stride,
+                         int w, int h,
+                         int order_0, int order_1, int order_2, int order_3);
+
+            /// \brief RGBA to premultiplied RGBA (color = round(color * alpha / 255))
+            ///
+            /// src and dst can be the same buffer when the strides are the same.
+            ///
+            void premultiplyAlpha(const uint8_t *src, size_t src_stride,
+                                  uint8_t *dst, size_t dst_stride,
+                                  int w, int h);
+
+            /// \brief Premultiplied RGBA to RGBA (color = round(color * 255 / alpha))
+            ///
+            /// Pixels with alpha 0 get color 0.
+            /// src and dst can be the same buffer when the strides are the same.
+            ///
+            void unpremultiplyAlpha(const uint8_t *src, size_t src_stride,
+                                    uint8_t *dst, size_t dst_stride,
+                                    int w, int h);
+
+        }
+    }
+}
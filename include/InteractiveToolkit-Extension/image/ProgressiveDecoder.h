@@ -0,0 +1,99 @@
+#pragma once
+
+#include <InteractiveToolkit-Extension/image/Image.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        /// \brief Incremental PNG/JPG decoder that shows the image while the data arrives
+        ///
+        /// The compressed bytes are given in any number of append() calls. The format is
+        /// detected from the first bytes, and image() has the size of the final image as soon
+        /// as the header is decoded. Its pixels are the best result so far:
+        ///
+        /// - JPG uses the libjpeg buffered-image mode: each progressive scan refines the whole
+        ///   image, and a baseline image is filled top to bottom.
+        /// - PNG uses the libpng progressive reader: an Adam7 interlaced image shows every pass
+        ///   scaled up to blocks (8x8 after the first pass), a non interlaced image is filled
+        ///   top to bottom.
+        ///
+        /// Pixels not decoded yet are zero. PNG palettes, gray below 8 bits and tRNS are
+        /// expanded (gray/gray+alpha/RGB/RGBA), 16 bits samples are little endian. JPG gives gray or RGB.
+        ///
+        /// The pixels are updated in place by the next append(), clone() the image to keep a frame.
+        /// The object is not thread safe.
+        ///
+        /// \code
+        ///
+        /// Image::ProgressiveDecoder decoder;
+        ///
+        /// void onMessage(const uint8_t *data, size_t size) {
+        ///     uint32_t before = decoder.getUpdateCount();
+        ///     if (!decoder.append(data, size)) {
+        ///         printf("%s", decoder.getError().c_str());
+        ///         return;
+        ///     }
+        ///     if (decoder.getUpdateCount() != before)
+        ///         preview.upload(decoder.image());
+        /// }
+        ///
+        /// \endcode
+        ///
+        /// \author Alessandro Ribeiro
+        ///
+        class ProgressiveDecoder
+        {
+        public:
+            /// \private
+            struct State;
+
+        private:
+            State *state;
+            bool invertY;
+
+        public:
+            /// \param invertY should invert the image vertically
+            ProgressiveDecoder(bool invertY = false);
+            ~ProgressiveDecoder();
+
+            /// \brief Decode the next compressed bytes
+            ///
+            /// Decodes as much as the data received so far allows, the bytes are not needed after the call.
+            ///
+            /// \return false on a decode error (see getError), every later call also returns false
+            ///
+            bool append(const void *data, size_t size);
+
+            /// \brief Forget the current image and start a new stream
+            void reset();
+
+            /// \brief Detected format, Unknown until the first bytes arrive
+            FileFormat getFormat() const;
+
+            /// \brief The header is decoded and image() has the final size
+            bool hasHeader() const;
+
+            /// \brief The whole image is decoded
+            bool isComplete() const;
+
+            bool hasError() const;
+            const std::string &getError() const;
+
+            /// \brief Best image so far, empty before the header
+            const Image &image() const;
+
+            /// \brief Incremented by append() every time the pixels of image() change
+            uint32_t getUpdateCount() const;
+
+            ProgressiveDecoder(const ProgressiveDecoder &) = delete;
+            ProgressiveDecoder &operator=(const ProgressiveDecoder &) = delete;
+        };
+
+    }
+}
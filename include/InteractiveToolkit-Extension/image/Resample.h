@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+        /// \brief Separable image resampling and mipmap generation
+        ///
+        /// Works on 8 bits per channel images with 1 to 4 channels (gray, gray+alpha, RGB, RGBA).
+        ///
+        /// Filtering is done in float, in linear light when the color space is sRGB,
+        /// and weighted by alpha for images with alpha, so transparent pixels do not darken the edges.
+        ///
+        namespace Resample
+        {
+
+            enum class Filter : int
+            {
+                Box,      ///< average of the covered pixels, nearest when enlarging
+                Bilinear, ///< triangle filter
+                Lanczos3, ///< sharpest, can ring on hard edges
+                Mitchell  ///< Mitchell-Netravali (B = C = 1/3), good default
+            };
+
+            enum class ColorSpace : int
+            {
+                Linear, ///< filter the stored values (normal maps, masks, data)
+                sRGB    ///< decode the color channels to linear light before filtering (alpha is always linear)
+            };
+
+            enum class Edge : int
+            {
+                Clamp, ///< repeat the border pixels
+                Wrap   ///< tiled texture
+            };
+
+            struct Options
+            {
+                Filter filter;
+                ColorSpace color_space;
+                Edge edge;
+
+                /// \brief Mitchell, sRGB, clamp
+                Options();
+            };
+
+            /// \brief Resize an image
+            ///
+            /// Example:
+            ///
+            /// \code
+            ///
+            /// Image::Resample::Options options;
+            /// options.filter = Image::Resample::Filter::Lanczos3;
+            ///
+            /// std::vector<uint8_t> thumb(128 * 128 * 4);
+            /// Image::Resample::resize(pixels, w, h, w * 4, 4,
+            ///                         thumb.data(), 128, 128, 128 * 4,
+            ///                         options);
+            ///
+            /// \endcode
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param src source pixels
+            /// \param src_w source width
+            /// \param src_h source height
+            /// \param src_stride bytes between two source rows
+            /// \param chann channels of both images (1..4)
+            /// \param dst target pixels
+            /// \param dst_w target width
+            /// \param dst_h target height
+            /// \param dst_stride bytes between two target rows
+            /// \param options filter, color space and edge mode
+            /// \return false on invalid sizes or channel count
+            ///
+            bool resize(const uint8_t *src, int src_w, int src_h, size_t src_stride, int chann,
+                        uint8_t *dst, int dst_w, int dst_h, size_t dst_stride,
+                        const Options &options = Options());
+
+            /// \brief One level of a mipmap chain (rows are tightly packed)
+            struct MipLevel
+            {
+                int w;
+                int h;
+                std::vector<uint8_t> pixels;
+            };
+
+            /// \brief Build the mipmap chain of an image
+            ///
+            /// Level 0 is a copy of the source. Each next level halves the size (rounding down,
+            /// minimum 1) until 1x1, or until max_levels levels were generated.
+            ///
+            /// Each level is filtered from the previous one kept in linear float,
+            /// so the 8 bits quantization of a level does not accumulate down the chain.
+            ///
+            /// \author Alessandro Ribeiro
+            /// \param src source pixels
+            /// \param w source width
+            /// \param h source height
+            /// \param src_stride bytes between two source rows
+            /// \param chann channels (1..4)
+            /// \param options filter, color space and edge mode
+            /// \param max_levels maximum number of levels, including level 0 (0 = full chain)
+            /// \return the levels, empty on invalid input
+            ///
+            std::vector<MipLevel> generateMipChain(const uint8_t *src, int w, int h, size_t src_stride, int chann,
+                                                   const Options &options = Options(), int max_levels = 0);
+
+        }
+    }
+}
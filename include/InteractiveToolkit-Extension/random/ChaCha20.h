@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace ITKExtension
+{
+    namespace Random
+    {
+        // ChaCha20 keystream generator (RFC 7539)
+        class ChaCha20
+        {
+        private:
+            uint32_t state[16];
+
+        public:
+            ChaCha20();
+            ~ChaCha20();
+
+            void setKey(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter = 0);
+
+            // Write one 64 bytes keystream block and advance the block counter
+            void block(uint8_t output[64]);
+            // Write len keystream bytes (a partial last block is discarded)
+            void keystream(uint8_t *output, size_t len);
+        };
+    }
+}
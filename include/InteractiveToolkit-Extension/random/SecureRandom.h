@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace ITKExtension
+{
+    namespace Random
+    {
+        // Cryptographically secure random bytes.
+        //
+        // Each thread owns a buffered ChaCha20 generator seeded from the OS entropy source
+        // (getrandom/getentropy, arc4random on Apple/BSD, BCryptGenRandom on Windows).
+        // The key is replaced from its own output after each refill and reseeded from the OS
+        // periodically and after fork().
+        namespace SecureRandom
+        {
+            void fill(uint8_t *output, size_t len);
+            uint32_t next32();
+        }
+    }
+}
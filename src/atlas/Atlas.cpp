@@ -8,6 +8,9 @@
 
 #include <InteractiveToolkit-Extension/image/PNG.h>
 #include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit-Extension/image/Image.h>
+
+#include <algorithm>
 
 namespace ITKExtension
 {
@@ -154,6 +157,8 @@ namespace ITKExtension
                 xspacing++;
             if (yspacing % 2 == 1)
                 yspacing++;
+
+            onlineMode = false;
         }
 
         Atlas::~Atlas()
@@ -163,20 +168,152 @@ namespace ITKExtension
 
         std::shared_ptr<AtlasElement> Atlas::addElement(const std::string &name, int w, int h)
         {
+            ITK_ABORT(onlineMode, "Use insertElement to add elements to an atlas in online mode.\n");
             std::shared_ptr<AtlasElement> result = AtlasElement::CreateShared(w, h);
             result->name = name;
             elements.push_back(result);
             return result;
         }
 
+        std::shared_ptr<AtlasElement> Atlas::addElement(const std::string &name, const Image::Image &image)
+        {
+            if (image.empty() || image.pixel_depth != 8)
+                return nullptr;
+            std::shared_ptr<AtlasElement> result = addElement(name, image.w, image.h);
+            result->copyFromImage(image);
+            return result;
+        }
+
         void Atlas::removeLastInsertedElement()
         {
             if (!elements.empty())
-                elements.pop_back();
+            {
+                if (onlineMode)
+                    removeElement(elements.back());
+                else
+                    elements.pop_back();
+            }
+        }
+
+        bool Atlas::removeElement(const std::shared_ptr<AtlasElement> &element)
+        {
+            auto it = std::find(elements.begin(), elements.end(), element);
+            if (it == elements.end())
+                return false;
+            elements.erase(it);
+
+            if (onlineMode && element->rect.w != 0 && element->rect.h != 0)
+            {
+                AtlasRect area = spacedRect(element.get());
+                onlinePacker.release(area);
+                clearRects.push_back(area);
+                auto pending = std::find(pendingElements.begin(), pendingElements.end(), element);
+                if (pending != pendingElements.end())
+                    pendingElements.erase(pending);
+            }
+            return true;
+        }
+
+        AtlasRect Atlas::spacedRect(const AtlasElement *element) const
+        {
+            return AtlasRect(element->rect.x - xspacing / 2, element->rect.y - yspacing / 2,
+                             element->rect.w + xspacing, element->rect.h + yspacing);
+        }
+
+        void Atlas::endOnlineMode()
+        {
+            onlineMode = false;
+            onlinePacker.reset(0, 0);
+            clearRects.clear();
+            pendingElements.clear();
+        }
+
+        void Atlas::beginOnlineMode(const AtlasRect &resolution)
+        {
+            textureResolution = AtlasRect(resolution.w, resolution.h);
+            onlinePacker.reset(textureResolution.w, textureResolution.h);
+            for (size_t i = 0; i < elements.size(); i++)
+            {
+                AtlasElement *element = elements[i].get();
+                if (element->rect.w == 0 || element->rect.h == 0)
+                    continue;
+                ITK_ABORT(!element->rect.inside(textureResolution, xspacing / 2, yspacing / 2),
+                          "Atlas element outside the online mode texture, call organizePositions first.\n");
+                onlinePacker.reserve(spacedRect(element));
+            }
+            clearRects.clear();
+            pendingElements.clear();
+            onlineMode = true;
+        }
+
+        bool Atlas::isOnlineMode() const
+        {
+            return onlineMode;
+        }
+
+        std::shared_ptr<AtlasElement> Atlas::insertElement(const std::string &name, int w, int h)
+        {
+            ITK_ABORT(!onlineMode, "Atlas not in online mode, call beginOnlineMode first.\n");
+
+            std::shared_ptr<AtlasElement> result = AtlasElement::CreateShared(w, h);
+            result->name = name;
+            if (w != 0 && h != 0)
+            {
+                int x, y;
+                if (!onlinePacker.insert(w + xspacing, h + yspacing, &x, &y))
+                    return nullptr;
+                result->rect.setXY(x + xspacing / 2, y + yspacing / 2);
+                pendingElements.push_back(result);
+            }
+            elements.push_back(result);
+            return result;
+        }
+
+        std::shared_ptr<AtlasElement> Atlas::insertElement(const std::string &name, const Image::Image &image)
+        {
+            if (image.empty() || image.pixel_depth != 8)
+                return nullptr;
+            std::shared_ptr<AtlasElement> result = insertElement(name, image.w, image.h);
+            if (result != nullptr)
+                result->copyFromImage(image);
+            return result;
+        }
+
+        bool Atlas::hasPendingUpdates() const
+        {
+            return clearRects.size() > 0 || pendingElements.size() > 0;
+        }
+
+        void Atlas::updateRGBA(uint8_t *rgba, std::vector<AtlasRect> *dirtyRects)
+        {
+            ITK_ABORT((textureResolution.w == 0 || textureResolution.h == 0), "Error to update texture from atlas.\n");
+            int strideX = textureResolution.w * 4;
+
+            // clear before drawing: a new element can reuse a removed area
+            for (size_t i = 0; i < clearRects.size(); i++)
+            {
+                const AtlasRect &rect = clearRects[i];
+                for (int y = rect.y; y < rect.y + rect.h; y++)
+                    memset(&rgba[(size_t)strideX * y + rect.x * 4], 0, sizeof(uint8_t) * rect.w * 4);
+                if (dirtyRects != nullptr)
+                    dirtyRects->push_back(rect);
+            }
+
+            for (size_t i = 0; i < pendingElements.size(); i++)
+            {
+                AtlasElement *element = pendingElements[i].get();
+                element->copyToRGBABuffer(rgba, strideX, xspacing / 2, yspacing / 2);
+                if (dirtyRects != nullptr)
+                    dirtyRects->push_back(spacedRect(element));
+            }
+
+            clearRects.clear();
+            pendingElements.clear();
         }
 
         void Atlas::organizePositions(bool fastMode)
         {
+            endOnlineMode();
 
             AtlasRect res(128, 128);
 
@@ -213,6 +350,130 @@ namespace ITKExtension
             repositionAllElements(textureResolution, fastMode);
         }
 
+        bool Atlas::packElements(const AtlasRect &screen, PackingAlgorithm algorithm, const std::vector<int> &order)
+        {
+            // each element takes its spacing around it: half spacing to the texture border
+            // and the full spacing to the next element
+            SkylinePacker skyline;
+            MaxRectsPacker maxRects;
+            if (algorithm == PackingAlgorithm::Skyline)
+                skyline.reset(screen.w, screen.h);
+            else
+                maxRects.reset(screen.w, screen.h);
+
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                AtlasElement *element = elements[order[i]].get();
+                int x, y;
+                bool placed;
+                if (algorithm == PackingAlgorithm::Skyline)
+                    placed = skyline.insert(element->rect.w + xspacing, element->rect.h + yspacing, &x, &y);
+                else
+                    placed = maxRects.insert(element->rect.w + xspacing, element->rect.h + yspacing, &x, &y);
+                if (!placed)
+                    return false;
+                element->rect.setXY(x + xspacing / 2, y + yspacing / 2);
+            }
+            return true;
+        }
+
+        void Atlas::organizePositions(PackingAlgorithm algorithm)
+        {
+            endOnlineMode();
+            std::vector<int> order;
+            int maxW = 0, maxH = 0;
+            int64_t area = 0;
+            for (size_t i = 0; i < elements.size(); i++)
+            {
+                const AtlasRect &rect = elements[i]->rect;
+                if (rect.w == 0 || rect.h == 0)
+                    continue;
+                order.push_back((int)i);
+                maxW = (std::max)(maxW, rect.w + xspacing);
+                maxH = (std::max)(maxH, rect.h + yspacing);
+                area += (int64_t)(rect.w + xspacing) * (int64_t)(rect.h + yspacing);
+            }
+
+            // skyline: tallest first, maxrects: largest side first
+            const std::vector<std::shared_ptr<AtlasElement>> &el = elements;
+            if (algorithm == PackingAlgorithm::Skyline)
+                std::stable_sort(order.begin(), order.end(), [&el](int a, int b)
+                                 {
+                                     const AtlasRect &ra = el[a]->rect;
+                                     const AtlasRect &rb = el[b]->rect;
+                                     if (ra.h != rb.h)
+                                         return ra.h > rb.h;
+                                     return ra.w > rb.w; });
+            else
+                std::stable_sort(order.begin(), order.end(), [&el](int a, int b)
+                                 {
+                                     const AtlasRect &ra = el[a]->rect;
+                                     const AtlasRect &rb = el[b]->rect;
+                                     int maxA = (std::max)(ra.w, ra.h), maxB = (std::max)(rb.w, rb.h);
+                                     if (maxA != maxB)
+                                         return maxA > maxB;
+                                     return (std::min)(ra.w, ra.h) > (std::min)(rb.w, rb.h); });
+
+            // power of two sizes that can hold the elements, grouped by area.
+            // Inside a level the squarest sizes come first (wider first on ties).
+            std::vector<std::vector<AtlasRect>> levels;
+            for (int sum = 14; sum <= 30; sum++)
+            {
+                std::vector<AtlasRect> level;
+                for (int a = 15; a >= 7; a--)
+                {
+                    int b = sum - a;
+                    if (b < 7 || b > 15)
+                        continue;
+                    AtlasRect res(1 << a, 1 << b);
+                    if (res.w < maxW || res.h < maxH || (int64_t)res.w * (int64_t)res.h < area)
+                        continue;
+                    level.push_back(res);
+                }
+                if (level.size() == 0)
+                    continue;
+                std::stable_sort(level.begin(), level.end(), [](const AtlasRect &a, const AtlasRect &b)
+                                 { return (std::max)(a.w, a.h) / (std::min)(a.w, a.h) <
+                                          (std::max)(b.w, b.h) / (std::min)(b.w, b.h); });
+                levels.push_back(level);
+            }
+
+            // The packers do not fit monotonically over the aspect ratio: a 2048x1024 can fit
+            // where a 4096x512 of the same area does not. So every size of a level is tried,
+            // and the binary search runs over the area levels.
+            std::vector<AtlasRect> levelFit(levels.size(), AtlasRect(0, 0));
+            int packedLevel = -1; // level whose fit is the current placement
+            auto packLevel = [&](int l)
+            {
+                for (const AtlasRect &res : levels[l])
+                    if (packElements(res, algorithm, order))
+                    {
+                        levelFit[l] = res;
+                        packedLevel = l;
+                        return true;
+                    }
+                packedLevel = -1;
+                return false;
+            };
+
+            // smallest level that fits, hi is the first level known to fit
+            int lo = 0, hi = (int)levels.size();
+            while (lo < hi)
+            {
+                int mid = (lo + hi) / 2;
+                if (packLevel(mid))
+                    hi = mid;
+                else
+                    lo = mid + 1;
+            }
+
+            ITK_ABORT(hi == (int)levels.size(), "Atlas elements do not fit in a 32768x32768 texture.\n");
+
+            textureResolution = levelFit[hi];
+            if (packedLevel != hi)
+                packElements(textureResolution, algorithm, order);
+        }
+
         std::shared_ptr<uint8_t[]> Atlas::createRGBA() const
         {
             ITK_ABORT((textureResolution.w == 0 || textureResolution.h == 0), "Error to create texture from atlas.\n");
@@ -239,7 +500,7 @@ namespace ITKExtension
                 AtlasElement *element = elements[i].get();
                 if (element->rect.w == 0 || element->rect.h == 0)
                     continue;
-                element->copyToRGBBuffer(result.get(), xspacing / 2, yspacing / 2);
+                element->copyToRGBBuffer(result.get(), textureResolution.w * 3, xspacing / 2, yspacing / 2);
             }
             return result;
         }
@@ -255,7 +516,7 @@ namespace ITKExtension
                 AtlasElement *element = elements[i].get();
                 if (element->rect.w == 0 || element->rect.h == 0)
                     continue;
-                element->copyToGrayBuffer(result.get(), xspacing / 2, yspacing / 2);
+                element->copyToGrayBuffer(result.get(), textureResolution.w, xspacing / 2, yspacing / 2);
             }
             return result;
         }
@@ -306,6 +567,7 @@ namespace ITKExtension
 
         void Atlas::read(ITKExtension::IO::AdvancedReader *reader)
         {
+            endOnlineMode();
             clearElements();
             elements.resize(reader->readUInt32());
             for (size_t i = 0; i < elements.size(); i++)
@@ -316,17 +578,17 @@ namespace ITKExtension
             }
         }
 
-        void Atlas::savePNG(const std::string &filename) const
+        void Atlas::savePNG(const std::string &filename, const ITKExtension::Image::PNG::EncodeOptions &options, ITKExtension::Image::PNG::EncodeStats *stats) const
         {
             auto image = createRGBA();
-            ITKExtension::Image::PNG::writePNG(filename.c_str(), textureResolution.w, textureResolution.h, 4, (char *)image.get());
+            ITKExtension::Image::PNG::writePNG(filename.c_str(), textureResolution.w, textureResolution.h, 4, (char *)image.get(), options, false, stats);
             // releaseRGBA(&image);
         }
 
-        void Atlas::savePNG_Alpha(const std::string &filename) const
+        void Atlas::savePNG_Alpha(const std::string &filename, const ITKExtension::Image::PNG::EncodeOptions &options, ITKExtension::Image::PNG::EncodeStats *stats) const
         {
             auto image = createA();
-            ITKExtension::Image::PNG::writePNG(filename.c_str(), textureResolution.w, textureResolution.h, 1, (char *)image.get());
+            ITKExtension::Image::PNG::writePNG(filename.c_str(), textureResolution.w, textureResolution.h, 1, (char *)image.get(), options, false, stats);
             // releaseA(&image);
         }
 
@@ -8,6 +8,8 @@
 
 #include <InteractiveToolkit-Extension/image/PNG.h>
 #include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit-Extension/image/PixelFormat.h>
+#include <InteractiveToolkit-Extension/image/Image.h>
 
 namespace ITKExtension
 {
@@ -56,175 +58,86 @@ namespace ITKExtension
             rect.write(writer);
         }
 
-        void AtlasElement::copyFromRGBABuffer(uint8_t *src, int strideX)
+        // Replicates the edge pixels of the element into the spacing around it.
+        // The element pixels must already be in dst.
+        static void fill_borders(uint8_t *dst, int strideX, int chann, const AtlasRect &rect, int xspacing, int yspacing)
         {
             for (int y = 0; y < rect.h; y++)
             {
-                memcpy(&buffer[y * rect.w * 4], &src[y * strideX], sizeof(uint8_t) * 4 * rect.w);
+                uint8_t *row = &dst[strideX * (y + rect.y) + rect.x * chann];
+                for (int x = -xspacing; x < 0; x++)
+                    memcpy(&row[x * chann], &row[0], chann);
+                for (int x = rect.w; x < rect.w + xspacing; x++)
+                    memcpy(&row[x * chann], &row[(rect.w - 1) * chann], chann);
             }
-        }
 
-        void AtlasElement::copyFromRGBBuffer(uint8_t *src)
-        {
-            for (int y = 0; y < rect.h; y++)
+            size_t span = (size_t)(rect.w + xspacing * 2) * chann;
+            ptrdiff_t left = (ptrdiff_t)(rect.x - xspacing) * chann;
+            uint8_t *first = &dst[(ptrdiff_t)strideX * rect.y + left];
+            uint8_t *last = &dst[(ptrdiff_t)strideX * (rect.y + rect.h - 1) + left];
+            for (int y = 1; y <= yspacing; y++)
             {
-                for (int x = 0; x < rect.w; x++)
-                {
-                    int target_idx = (y * rect.w + x) * 4;
-                    int source_idx = (y * rect.w + x) * 3;
-                    buffer[target_idx] = src[source_idx];
-                    buffer[target_idx + 1] = src[source_idx + 1];
-                    buffer[target_idx + 2] = src[source_idx + 2];
-                    buffer[target_idx + 3] = 0xff;
-                }
+                memcpy(first - strideX * y, first, span);
+                memcpy(last + strideX * y, last, span);
             }
         }
 
-        void AtlasElement::copyFromGrayBuffer(uint8_t *src)
+        void AtlasElement::copyFromRGBABuffer(uint8_t *src, int strideX)
         {
-            for (int y = 0; y < rect.h; y++)
-            {
-                for (int x = 0; x < rect.w; x++)
-                {
-                    int target_idx = (y * rect.w + x) * 4;
-                    int source_idx = (y * rect.w + x);
-                    buffer[target_idx] = src[source_idx];
-                    buffer[target_idx + 1] = src[source_idx];
-                    buffer[target_idx + 2] = src[source_idx];
-                    buffer[target_idx + 3] = 0xff;
-                }
-            }
+            Image::PixelFormat::convert(src, 4, strideX, buffer.get(), 4, rect.w * 4, rect.w, rect.h);
         }
 
-        void AtlasElement::copyToRGBABuffer(uint8_t *dst, int strideX, int xspacing, int yspacing)
+        void AtlasElement::copyFromRGBBuffer(uint8_t *src)
         {
-            for (int y = 0; y < rect.h; y++)
-            {
-                memcpy(&dst[rect.x * 4 + strideX * (y + rect.y)], &buffer[y * rect.w * 4], sizeof(uint8_t) * 4 * rect.w);
-            }
-
-            // borders
-            for (int y = -yspacing; y < rect.h + yspacing; y++)
-            {
-                int srcY = y;
-                if (y < 0)
-                    srcY = 0;
-                else if (y >= rect.h)
-                    srcY = rect.h - 1;
-
-                for (int x = -xspacing; x < rect.w + xspacing; x++)
-                {
-
-                    if (x >= 0 && x < rect.w && y >= 0 && y < rect.h)
-                        continue;
+            Image::PixelFormat::convert(src, 3, rect.w * 3, buffer.get(), 4, rect.w * 4, rect.w, rect.h);
+        }
 
-                    int srcX = x;
-                    if (x < 0)
-                        srcX = 0;
-                    else if (x >= rect.w)
-                        srcX = rect.w - 1;
+        void AtlasElement::copyFromGrayBuffer(uint8_t *src)
+        {
+            Image::PixelFormat::convert(src, 1, rect.w, buffer.get(), 4, rect.w * 4, rect.w, rect.h);
+        }
 
-                    dst[(rect.x + x) * 4 + strideX * (y + rect.y) + 0] = buffer[(srcX + srcY * rect.w) * 4 + 0];
-                    dst[(rect.x + x) * 4 + strideX * (y + rect.y) + 1] = buffer[(srcX + srcY * rect.w) * 4 + 1];
-                    dst[(rect.x + x) * 4 + strideX * (y + rect.y) + 2] = buffer[(srcX + srcY * rect.w) * 4 + 2];
-                    dst[(rect.x + x) * 4 + strideX * (y + rect.y) + 3] = 0; // alpha 0
-                }
-            }
+        bool AtlasElement::copyFromImage(const Image::Image &image)
+        {
+            if (image.w != rect.w || image.h != rect.h || image.pixel_depth != 8)
+                return false;
+            return image.copyTo(Image::Image::Wrap(buffer.get(), rect.w, rect.h, 4, rect.w * 4));
         }
 
-        void AtlasElement::copyToRGBBuffer(uint8_t *dst, int xspacing, int yspacing)
+        void AtlasElement::copyToRGBABuffer(uint8_t *dst, int strideX, int xspacing, int yspacing)
         {
-            for (int y = 0; y < rect.h; y++)
-                for (int x = 0; x < rect.w; x++)
-                {
-                    int dst_idx = (y * rect.w + x) * 3;
-                    int source_idx = (y * rect.w + x) * 4;
+            Image::PixelFormat::convert(buffer.get(), 4, rect.w * 4, &dst[rect.x * 4 + strideX * rect.y], 4, strideX, rect.w, rect.h);
 
-                    dst[dst_idx] = buffer[source_idx];
-                    dst[dst_idx + 1] = buffer[source_idx + 1];
-                    dst[dst_idx + 2] = buffer[source_idx + 2];
-                }
+            fill_borders(dst, strideX, 4, rect, xspacing, yspacing);
 
-            // borders
+            // borders are transparent
             for (int y = -yspacing; y < rect.h + yspacing; y++)
             {
-                int srcY = y;
-                if (y < 0)
-                    srcY = 0;
-                else if (y >= rect.h)
-                    srcY = rect.h - 1;
-
+                uint8_t *row = &dst[strideX * (y + rect.y) + rect.x * 4];
                 for (int x = -xspacing; x < rect.w + xspacing; x++)
                 {
-
                     if (x >= 0 && x < rect.w && y >= 0 && y < rect.h)
                         continue;
-
-                    int srcX = x;
-                    if (x < 0)
-                        srcX = 0;
-                    else if (x >= rect.w)
-                        srcX = rect.w - 1;
-
-                    int dst_idx = (y * rect.w + x) * 3;
-                    int source_idx = (srcY * rect.w + srcX) * 4;
-
-                    dst[dst_idx] = buffer[source_idx];
-                    dst[dst_idx + 1] = buffer[source_idx + 1];
-                    dst[dst_idx + 2] = buffer[source_idx + 2];
+                    row[x * 4 + 3] = 0; // alpha 0
                 }
             }
         }
 
-        void AtlasElement::copyToGrayBuffer(uint8_t *dst, int xspacing, int yspacing)
+        void AtlasElement::copyToRGBBuffer(uint8_t *dst, int strideX, int xspacing, int yspacing)
         {
-            for (int y = 0; y < rect.h; y++)
-                for (int x = 0; x < rect.w; x++)
-                {
-                    int dst_idx = (y * rect.w + x);
-                    int source_idx = (y * rect.w + x) * 4;
-
-                    dst[dst_idx] = buffer[source_idx];
-                }
-
-            // borders
-            for (int y = -yspacing; y < rect.h + yspacing; y++)
-            {
-                int srcY = y;
-                if (y < 0)
-                    srcY = 0;
-                else if (y >= rect.h)
-                    srcY = rect.h - 1;
-
-                for (int x = -xspacing; x < rect.w + xspacing; x++)
-                {
-
-                    if (x >= 0 && x < rect.w && y >= 0 && y < rect.h)
-                        continue;
-
-                    int srcX = x;
-                    if (x < 0)
-                        srcX = 0;
-                    else if (x >= rect.w)
-                        srcX = rect.w - 1;
-
-                    int dst_idx = (y * rect.w + x);
-                    int source_idx = (srcY * rect.w + srcX) * 4;
+            Image::PixelFormat::convert(buffer.get(), 4, rect.w * 4, &dst[rect.x * 3 + strideX * rect.y], 3, strideX, rect.w, rect.h);
+            fill_borders(dst, strideX, 3, rect, xspacing, yspacing);
+        }
 
-                    dst[dst_idx] = buffer[source_idx];
-                }
-            }
+        void AtlasElement::copyToGrayBuffer(uint8_t *dst, int strideX, int xspacing, int yspacing)
+        {
+            Image::PixelFormat::convert(buffer.get(), 4, rect.w * 4, &dst[rect.x + strideX * rect.y], 1, strideX, rect.w, rect.h);
+            fill_borders(dst, strideX, 1, rect, xspacing, yspacing);
         }
 
         void AtlasElement::copyToABuffer(uint8_t *dst, int strideX, int xspacing, int yspacing)
         {
-            for (int y = 0; y < rect.h; y++)
-            {
-                for (int x = 0; x < rect.w; x++)
-                {
-                    dst[x + rect.x + strideX * (y + rect.y)] = buffer[(x + y * rect.w) * 4 + 3];
-                }
-            }
+            Image::PixelFormat::extractChannel(buffer.get(), 4, 3, rect.w * 4, &dst[rect.x + strideX * rect.y], strideX, rect.w, rect.h);
 
             // borders
             /*
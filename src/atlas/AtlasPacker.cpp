@@ -0,0 +1,482 @@
+#include <InteractiveToolkit-Extension/atlas/AtlasPacker.h>
+
+#include <limits.h>
+#include <algorithm>
+
+namespace ITKExtension
+{
+    namespace Atlas
+    {
+
+        static inline bool rect_intersects(const AtlasRect &a, const AtlasRect &b)
+        {
+            return a.x < b.x + b.w && b.x < a.x + a.w &&
+                   a.y < b.y + b.h && b.y < a.y + a.h;
+        }
+
+        static inline bool rect_contains(const AtlasRect &outer, const AtlasRect &inner)
+        {
+            return inner.x >= outer.x && inner.y >= outer.y &&
+                   inner.x + inner.w <= outer.x + outer.w &&
+                   inner.y + inner.h <= outer.y + outer.h;
+        }
+
+        //----------------------------------------------------------------------------------
+        // SkylinePacker
+        //----------------------------------------------------------------------------------
+
+        SkylinePacker::SkylinePacker(int w, int h)
+        {
+            reset(w, h);
+        }
+
+        void SkylinePacker::reset(int w, int h)
+        {
+            width = w;
+            height = h;
+            usedArea = 0;
+            skyline.clear();
+            if (w > 0 && h > 0)
+                skyline.push_back(Node{0, 0, w});
+        }
+
+        bool SkylinePacker::insert(int w, int h, int *x, int *y)
+        {
+            if (w <= 0 || h <= 0 || w > width || h > height)
+                return false;
+
+            int bestIndex = -1;
+            int bestBottom = INT_MAX;
+            int bestWidth = INT_MAX;
+            int bestY = 0;
+
+            for (int i = 0; i < (int)skyline.size(); i++)
+            {
+                if (skyline[i].x + w > width)
+                    break;
+
+                // the rectangle rests on the highest node under its span
+                int top = skyline[i].y;
+                int widthLeft = w;
+                int j = i;
+                while (widthLeft > 0)
+                {
+                    top = (std::max)(top, skyline[j].y);
+                    widthLeft -= skyline[j].w;
+                    j++;
+                }
+                if (top + h > height)
+                    continue;
+
+                if (top + h < bestBottom || (top + h == bestBottom && skyline[i].w < bestWidth))
+                {
+                    bestIndex = i;
+                    bestBottom = top + h;
+                    bestWidth = skyline[i].w;
+                    bestY = top;
+                }
+            }
+
+            if (bestIndex < 0)
+                return false;
+
+            Node node{skyline[bestIndex].x, bestY + h, w};
+            skyline.insert(skyline.begin() + bestIndex, node);
+
+            // cut the nodes now under the new one
+            for (size_t i = bestIndex + 1; i < skyline.size();)
+            {
+                const Node &prev = skyline[i - 1];
+                Node &curr = skyline[i];
+                int overlap = prev.x + prev.w - curr.x;
+                if (overlap <= 0)
+                    break;
+                if (overlap >= curr.w)
+                {
+                    skyline.erase(skyline.begin() + i);
+                    continue;
+                }
+                curr.x += overlap;
+                curr.w -= overlap;
+                break;
+            }
+
+            // merge neighbours at the same level
+            for (size_t i = 1; i < skyline.size();)
+            {
+                if (skyline[i - 1].y == skyline[i].y)
+                {
+                    skyline[i - 1].w += skyline[i].w;
+                    skyline.erase(skyline.begin() + i);
+                }
+                else
+                    i++;
+            }
+
+            *x = node.x;
+            *y = bestY;
+            usedArea += (int64_t)w * (int64_t)h;
+            return true;
+        }
+
+        float SkylinePacker::occupancy() const
+        {
+            if (width <= 0 || height <= 0)
+                return 0.0f;
+            return (float)((double)usedArea / ((double)width * (double)height));
+        }
+
+        //----------------------------------------------------------------------------------
+        // MaxRectsPacker
+        //----------------------------------------------------------------------------------
+
+        // free rectangles over more grid cells than this are not registered in the grid
+        static const int LARGE_RECT_CELLS = 8;
+
+        MaxRectsPacker::MaxRectsPacker(int w, int h)
+        {
+            reset(w, h);
+        }
+
+        void MaxRectsPacker::reset(int w, int h)
+        {
+            width = w;
+            height = h;
+            usedArea = 0;
+
+            freeRects.clear();
+            freeSlots.clear();
+            aliveIds.clear();
+            alivePos.clear();
+            visited.clear();
+            largeIds.clear();
+            usedRects.clear();
+            fragmented = false;
+            stamp = 0;
+
+            // about 64 cells on the larger side
+            cellSize = (std::max)((std::max)(w, h) / 64, 16);
+            gridW = (std::max)((w + cellSize - 1) / cellSize, 1);
+            gridH = (std::max)((h + cellSize - 1) / cellSize, 1);
+            grid.resize(gridW * gridH);
+            for (size_t i = 0; i < grid.size(); i++)
+                grid[i].clear();
+
+            if (w > 0 && h > 0)
+                addFreeRect(AtlasRect(0, 0, w, h));
+        }
+
+        int MaxRectsPacker::addFreeRect(const AtlasRect &rect)
+        {
+            int id;
+            if (freeSlots.size() > 0)
+            {
+                id = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            else
+            {
+                id = (int)freeRects.size();
+                freeRects.push_back(FreeRect());
+                alivePos.push_back(0);
+                visited.push_back(0);
+            }
+            freeRects[id].rect = rect;
+            freeRects[id].alive = true;
+            alivePos[id] = (int)aliveIds.size();
+            aliveIds.push_back(id);
+
+            int cx0 = rect.x / cellSize;
+            int cy0 = rect.y / cellSize;
+            int cx1 = (rect.x + rect.w - 1) / cellSize;
+            int cy1 = (rect.y + rect.h - 1) / cellSize;
+            if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > LARGE_RECT_CELLS)
+            {
+                freeRects[id].largePos = (int)largeIds.size();
+                largeIds.push_back(id);
+                return id;
+            }
+
+            freeRects[id].largePos = -1;
+            for (int cy = cy0; cy <= cy1; cy++)
+                for (int cx = cx0; cx <= cx1; cx++)
+                    grid[cy * gridW + cx].push_back(id);
+
+            return id;
+        }
+
+        void MaxRectsPacker::removeFreeRect(int id)
+        {
+            FreeRect &freeRect = freeRects[id];
+            freeRect.alive = false;
+
+            int pos = alivePos[id];
+            int last = aliveIds.back();
+            aliveIds[pos] = last;
+            alivePos[last] = pos;
+            aliveIds.pop_back();
+
+            freeSlots.push_back(id);
+
+            if (freeRect.largePos >= 0)
+            {
+                int lastLarge = largeIds.back();
+                largeIds[freeRect.largePos] = lastLarge;
+                freeRects[lastLarge].largePos = freeRect.largePos;
+                largeIds.pop_back();
+                return;
+            }
+
+            const AtlasRect &rect = freeRect.rect;
+            int cx0 = rect.x / cellSize;
+            int cy0 = rect.y / cellSize;
+            int cx1 = (rect.x + rect.w - 1) / cellSize;
+            int cy1 = (rect.y + rect.h - 1) / cellSize;
+            for (int cy = cy0; cy <= cy1; cy++)
+                for (int cx = cx0; cx <= cx1; cx++)
+                {
+                    std::vector<int> &cell = grid[cy * gridW + cx];
+                    for (size_t i = 0; i < cell.size(); i++)
+                    {
+                        if (cell[i] == id)
+                        {
+                            cell[i] = cell.back();
+                            cell.pop_back();
+                            break;
+                        }
+                    }
+                }
+        }
+
+        void MaxRectsPacker::query(const AtlasRect &rect, std::vector<int> *result)
+        {
+            result->clear();
+
+            stamp++;
+            if (stamp == 0)
+            {
+                std::fill(visited.begin(), visited.end(), 0);
+                stamp = 1;
+            }
+
+            int cx0 = (std::max)(rect.x / cellSize, 0);
+            int cy0 = (std::max)(rect.y / cellSize, 0);
+            int cx1 = (std::min)((rect.x + rect.w - 1) / cellSize, gridW - 1);
+            int cy1 = (std::min)((rect.y + rect.h - 1) / cellSize, gridH - 1);
+            for (int cy = cy0; cy <= cy1; cy++)
+                for (int cx = cx0; cx <= cx1; cx++)
+                {
+                    const std::vector<int> &cell = grid[cy * gridW + cx];
+                    for (size_t i = 0; i < cell.size(); i++)
+                    {
+                        int id = cell[i];
+                        if (visited[id] == stamp)
+                            continue;
+                        visited[id] = stamp;
+                        if (rect_intersects(freeRects[id].rect, rect))
+                            result->push_back(id);
+                    }
+                }
+
+            for (size_t i = 0; i < largeIds.size(); i++)
+            {
+                if (rect_intersects(freeRects[largeIds[i]].rect, rect))
+                    result->push_back(largeIds[i]);
+            }
+        }
+
+        void MaxRectsPacker::splitFreeRects(const AtlasRect &used)
+        {
+            std::vector<int> hits;
+            query(used, &hits);
+
+            std::vector<AtlasRect> created;
+            for (size_t i = 0; i < hits.size(); i++)
+            {
+                AtlasRect free = freeRects[hits[i]].rect;
+                removeFreeRect(hits[i]);
+
+                // the maximal rectangles left around the used area
+                if (used.x > free.x)
+                    created.push_back(AtlasRect(free.x, free.y, used.x - free.x, free.h));
+                if (used.x + used.w < free.x + free.w)
+                    created.push_back(AtlasRect(used.x + used.w, free.y, free.x + free.w - (used.x + used.w), free.h));
+                if (used.y > free.y)
+                    created.push_back(AtlasRect(free.x, free.y, free.w, used.y - free.y));
+                if (used.y + used.h < free.y + free.h)
+                    created.push_back(AtlasRect(free.x, used.y + used.h, free.w, free.y + free.h - (used.y + used.h)));
+            }
+
+            addMaximalRects(&created);
+        }
+
+        void MaxRectsPacker::addMaximalRects(std::vector<AtlasRect> *created)
+        {
+            // The free rectangles not split were maximal before the placement and the new
+            // ones are inside the split ones, so a new rectangle can only be contained by
+            // another new rectangle or by a free rectangle that covers its top left pixel.
+            // Adding the largest first, the grid cell of that pixel has all candidates.
+            std::vector<AtlasRect> &rects = *created;
+            std::sort(rects.begin(), rects.end(), [](const AtlasRect &a, const AtlasRect &b)
+                      { return (int64_t)a.w * (int64_t)a.h > (int64_t)b.w * (int64_t)b.h; });
+
+            std::vector<int> hits;
+            for (size_t i = 0; i < rects.size(); i++)
+            {
+                query(AtlasRect(rects[i].x, rects[i].y, 1, 1), &hits);
+                bool contained = false;
+                for (size_t j = 0; j < hits.size(); j++)
+                {
+                    if (rect_contains(freeRects[hits[j]].rect, rects[i]))
+                    {
+                        contained = true;
+                        break;
+                    }
+                }
+                if (!contained)
+                    addFreeRect(rects[i]);
+            }
+        }
+
+        bool MaxRectsPacker::insert(int w, int h, int *x, int *y)
+        {
+            if (w <= 0 || h <= 0 || w > width || h > height)
+                return false;
+
+            int bestId = -1;
+            int bestShortSide = INT_MAX;
+            int bestLongSide = INT_MAX;
+
+            for (size_t i = 0; i < aliveIds.size(); i++)
+            {
+                const AtlasRect &free = freeRects[aliveIds[i]].rect;
+                if (free.w < w || free.h < h)
+                    continue;
+
+                int leftoverX = free.w - w;
+                int leftoverY = free.h - h;
+                int shortSide = (std::min)(leftoverX, leftoverY);
+                int longSide = (std::max)(leftoverX, leftoverY);
+
+                if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+                {
+                    bestId = aliveIds[i];
+                    bestShortSide = shortSide;
+                    bestLongSide = longSide;
+                    if (longSide == 0)
+                        break;
+                }
+            }
+
+            if (bestId < 0)
+            {
+                if (!fragmented)
+                    return false;
+                rebuildFreeRects();
+                return insert(w, h, x, y);
+            }
+
+            AtlasRect used(freeRects[bestId].rect.x, freeRects[bestId].rect.y, w, h);
+            splitFreeRects(used);
+            usedRects.push_back(used);
+
+            *x = used.x;
+            *y = used.y;
+            usedArea += (int64_t)w * (int64_t)h;
+            return true;
+        }
+
+        void MaxRectsPacker::reserve(const AtlasRect &rect)
+        {
+            if (rect.w <= 0 || rect.h <= 0)
+                return;
+            splitFreeRects(rect);
+            usedRects.push_back(rect);
+            usedArea += (int64_t)rect.w * (int64_t)rect.h;
+        }
+
+        void MaxRectsPacker::rebuildFreeRects()
+        {
+            // the maximal free rectangles around a set of used ones are unique,
+            // splitting the whole bin by each used rectangle gives all of them
+            std::vector<AtlasRect> used;
+            used.swap(usedRects);
+            reset(width, height);
+            for (size_t i = 0; i < used.size(); i++)
+                reserve(used[i]);
+        }
+
+        void MaxRectsPacker::release(const AtlasRect &rect)
+        {
+            if (rect.w <= 0 || rect.h <= 0)
+                return;
+            usedArea -= (int64_t)rect.w * (int64_t)rect.h;
+
+            for (size_t i = 0; i < usedRects.size(); i++)
+            {
+                const AtlasRect &used = usedRects[i];
+                if (used.x == rect.x && used.y == rect.y && used.w == rect.w && used.h == rect.h)
+                {
+                    usedRects[i] = usedRects.back();
+                    usedRects.pop_back();
+                    break;
+                }
+            }
+            fragmented = true;
+
+            AtlasRect merged = rect;
+            std::vector<int> hits;
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                // the free rectangles touching the area
+                query(AtlasRect(merged.x - 1, merged.y - 1, merged.w + 2, merged.h + 2), &hits);
+                for (size_t i = 0; i < hits.size(); i++)
+                {
+                    const AtlasRect &free = freeRects[hits[i]].rect;
+                    if (rect_contains(merged, free))
+                    {
+                        removeFreeRect(hits[i]);
+                        continue;
+                    }
+
+                    // same span on one axis, touching or overlapping on the other: the union is free
+                    if (free.x == merged.x && free.w == merged.w)
+                    {
+                        int y0 = (std::min)(merged.y, free.y);
+                        int y1 = (std::max)(merged.y + merged.h, free.y + free.h);
+                        merged = AtlasRect(merged.x, y0, merged.w, y1 - y0);
+                    }
+                    else if (free.y == merged.y && free.h == merged.h)
+                    {
+                        int x0 = (std::min)(merged.x, free.x);
+                        int x1 = (std::max)(merged.x + merged.w, free.x + free.w);
+                        merged = AtlasRect(x0, merged.y, x1 - x0, merged.h);
+                    }
+                    else
+                        continue;
+
+                    removeFreeRect(hits[i]);
+                    changed = true;
+                    break;
+                }
+            }
+
+            addFreeRect(merged);
+        }
+
+        float MaxRectsPacker::occupancy() const
+        {
+            if (width <= 0 || height <= 0)
+                return 0.0f;
+            return (float)((double)usedArea / ((double)width * (double)height));
+        }
+
+        int MaxRectsPacker::freeRectCount() const
+        {
+            return (int)aliveIds.size();
+        }
+
+    }
+}
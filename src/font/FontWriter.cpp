@@ -96,11 +96,11 @@ namespace ITKExtension
                 it->second->write(writer);      // all glyph information
             }
         }
-        void FontWriter::writeBitmap(ITKExtension::IO::AdvancedWriter *writer)
+        void FontWriter::writeBitmap(ITKExtension::IO::AdvancedWriter *writer, const ITKExtension::Image::PNG::EncodeOptions &options, ITKExtension::Image::PNG::EncodeStats *stats)
         {
             auto rgbaBuffer = atlas->createRGBA();
             int size;
-            char *result = ITKExtension::Image::PNG::writePNGToMemory(&size, atlas->textureResolution.w, atlas->textureResolution.h, 4, (char *)rgbaBuffer.get());
+            char *result = ITKExtension::Image::PNG::writePNGToMemory(&size, atlas->textureResolution.w, atlas->textureResolution.h, 4, (char *)rgbaBuffer.get(), options, false, stats);
 
             ITK_ABORT(result == nullptr, "Error to write PNG to memory.\n");
 
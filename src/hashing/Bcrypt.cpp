@@ -1,10 +1,14 @@
 #include <InteractiveToolkit-Extension/hashing/Bcrypt.h>
 #include <InteractiveToolkit-Extension/encoding/Base64.h>
+#include <InteractiveToolkit-Extension/random/SecureRandom.h>
 #include <InteractiveToolkit/ITKCommon/FileSystem/File.h>
-#include <InteractiveToolkit/ITKCommon/Random.h>
 #include <string.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 namespace ITKExtension
 {
     namespace Hashing
@@ -289,96 +293,134 @@ namespace ITKExtension
                 {
                 }
 
-                inline uint32_t F(uint32_t x)
+                inline uint32_t F(uint32_t x) const
                 {
-                    uint16_t a = (x >> 24) & 0xff;
-                    uint16_t b = (x >> 16) & 0xff;
-                    uint16_t c = (x >> 8) & 0xff;
-                    uint16_t d = x & 0xff;
-
-                    return ((S[0][a] + S[1][b]) ^ S[2][c]) + S[3][d];
+                    return ((S[0][x >> 24] + S[1][(x >> 16) & 0xff]) ^ S[2][(x >> 8) & 0xff]) + S[3][x & 0xff];
                 }
 
-                void encrypt(uint32_t *xl, uint32_t *xr)
+// one Feistel round pair, operands stay in registers
+#define BF_ROUND2(Xl, Xr, p, n) \
+    Xl ^= p[n];                 \
+    Xr ^= F(Xl);                \
+    Xr ^= p[n + 1];             \
+    Xl ^= F(Xr);
+
+                // Fully unrolled 16 rounds over a caller provided P-array.
+                // The expand loops pass a local copy of P so the stores into S
+                // cannot alias it and force a reload on every round.
+                inline void encryptBlock(const uint32_t p[18], uint32_t &l, uint32_t &r) const
                 {
-                    uint32_t Xl = *xl;
-                    uint32_t Xr = *xr;
-
-                    for (int i = 0; i < 16; i += 2)
-                    {
-                        Xl ^= P[i];
-                        Xr ^= F(Xl);
-                        Xr ^= P[i + 1];
-                        Xl ^= F(Xr);
-                    }
+                    uint32_t Xl = l;
+                    uint32_t Xr = r;
+
+                    BF_ROUND2(Xl, Xr, p, 0)
+                    BF_ROUND2(Xl, Xr, p, 2)
+                    BF_ROUND2(Xl, Xr, p, 4)
+                    BF_ROUND2(Xl, Xr, p, 6)
+                    BF_ROUND2(Xl, Xr, p, 8)
+                    BF_ROUND2(Xl, Xr, p, 10)
+                    BF_ROUND2(Xl, Xr, p, 12)
+                    BF_ROUND2(Xl, Xr, p, 14)
+
+                    l = Xr ^ p[17];
+                    r = Xl ^ p[16];
+                }
 
-                    Xl ^= P[16];
-                    Xr ^= P[17];
+#undef BF_ROUND2
 
-                    *xl = Xr;
-                    *xr = Xl;
+                inline void encryptBlock(uint32_t &l, uint32_t &r) const
+                {
+                    encryptBlock(P, l, r);
                 }
 
-                void expandKey(const uint8_t *key, size_t keyLen, const uint8_t *salt)
+                // Cycle the key bytes into the 18 big-endian words XORed against P.
+                // Done once per hash, so the cost loop does not redo the byte arithmetic.
+                static void keyToStream(const uint8_t *key, size_t keyLen, uint32_t stream[18])
                 {
-                    // XOR P boxes with key (key is cycled if shorter than 72 bytes)
+                    size_t k = 0;
                     for (int i = 0; i < 18; ++i)
                     {
                         uint32_t data = 0;
                         for (int j = 0; j < 4; ++j)
-                            data = (data << 8) | key[(i * 4 + j) % keyLen];
-                        P[i] ^= data;
+                        {
+                            data = (data << 8) | key[k];
+                            if (++k == keyLen)
+                                k = 0;
+                        }
+                        stream[i] = data;
                     }
+                }
 
-                    uint32_t l = 0, r = 0;
-                    int saltIndex = 0;
+                // ExpandKey(state, 0, key): plain Blowfish rekeying
+                void expandKeyNoSalt(const uint32_t keyStream[18])
+                {
+                    uint32_t p[18];
+                    for (int i = 0; i < 18; ++i)
+                        p[i] = P[i] ^ keyStream[i];
 
-                    // Encrypt P boxes with salt XOR
+                    uint32_t l = 0, r = 0;
                     for (int i = 0; i < 18; i += 2)
                     {
-                        if (salt)
-                        {
-                            // Alternate between first 8 bytes and second 8 bytes of salt
-                            int saltOffset = (saltIndex & 1) ? 8 : 0;
-                            saltIndex++;
-                            l ^= ((uint32_t)salt[saltOffset + 0] << 24) |
-                                 ((uint32_t)salt[saltOffset + 1] << 16) |
-                                 ((uint32_t)salt[saltOffset + 2] << 8) |
-                                 ((uint32_t)salt[saltOffset + 3]);
-                            r ^= ((uint32_t)salt[saltOffset + 4] << 24) |
-                                 ((uint32_t)salt[saltOffset + 5] << 16) |
-                                 ((uint32_t)salt[saltOffset + 6] << 8) |
-                                 ((uint32_t)salt[saltOffset + 7]);
-                        }
-                        encrypt(&l, &r);
-                        P[i] = l;
-                        P[i + 1] = r;
+                        encryptBlock(p, l, r);
+                        p[i] = l;
+                        p[i + 1] = r;
                     }
 
-                    // Encrypt S boxes with salt XOR (continue alternating)
-                    for (int i = 0; i < 4; ++i)
+                    uint32_t *s = &S[0][0];
+                    for (int i = 0; i < 4 * 256; i += 2)
                     {
-                        for (int j = 0; j < 256; j += 2)
-                        {
-                            if (salt)
-                            {
-                                // Continue alternating salt halves
-                                int saltOffset = (saltIndex & 1) ? 8 : 0;
-                                saltIndex++;
-                                l ^= ((uint32_t)salt[saltOffset + 0] << 24) |
-                                     ((uint32_t)salt[saltOffset + 1] << 16) |
-                                     ((uint32_t)salt[saltOffset + 2] << 8) |
-                                     ((uint32_t)salt[saltOffset + 3]);
-                                r ^= ((uint32_t)salt[saltOffset + 4] << 24) |
-                                     ((uint32_t)salt[saltOffset + 5] << 16) |
-                                     ((uint32_t)salt[saltOffset + 6] << 8) |
-                                     ((uint32_t)salt[saltOffset + 7]);
-                            }
-                            encrypt(&l, &r);
-                            S[i][j] = l;
-                            S[i][j + 1] = r;
-                        }
+                        encryptBlock(p, l, r);
+                        s[i] = l;
+                        s[i + 1] = r;
+                    }
+
+                    memcpy(P, p, sizeof(P));
+                }
+
+                // ExpandKey(state, salt, key): the 128 bit salt is XORed in alternating 64 bit halves
+                void expandKeyWithSalt(const uint32_t keyStream[18], const uint32_t saltWords[4])
+                {
+                    uint32_t p[18];
+                    for (int i = 0; i < 18; ++i)
+                        p[i] = P[i] ^ keyStream[i];
+
+                    uint32_t l = 0, r = 0;
+                    for (int i = 0; i < 18; i += 4)
+                    {
+                        l ^= saltWords[0];
+                        r ^= saltWords[1];
+                        encryptBlock(p, l, r);
+                        p[i] = l;
+                        p[i + 1] = r;
+
+                        if (i + 2 == 18)
+                            break;
+
+                        l ^= saltWords[2];
+                        r ^= saltWords[3];
+                        encryptBlock(p, l, r);
+                        p[i + 2] = l;
+                        p[i + 3] = r;
+                    }
+
+                    // P consumed 9 salt halves, so the S boxes start on the second half
+                    uint32_t *s = &S[0][0];
+                    for (int i = 0; i < 4 * 256; i += 4)
+                    {
+                        l ^= saltWords[2];
+                        r ^= saltWords[3];
+                        encryptBlock(p, l, r);
+                        s[i] = l;
+                        s[i + 1] = r;
+
+                        l ^= saltWords[0];
+                        r ^= saltWords[1];
+                        encryptBlock(p, l, r);
+                        s[i + 2] = l;
+                        s[i + 3] = r;
                     }
+
+                    memcpy(P, p, sizeof(P));
                 }
             };
         }
@@ -445,9 +487,7 @@ namespace ITKExtension
 
             void random_salt(uint8_t salt[16])
             {
-                ITKCommon::Random64 rng(ITKCommon::Random64::TypeDefinition::randomSeed());
-                for (int i = 0; i < 16; ++i)
-                    salt[i] = (uint8_t)rng.getRange<uint8_t>(0, 255); // (i * 17 + 42); // Simple deterministic salt for demo
+                Random::SecureRandom::fill(salt, 16);
             }
 
             std::string salt_to_string(int cost, uint8_t salt[16], char format)
@@ -479,6 +519,108 @@ namespace ITKExtension
                 bcrypt_decode_base64(saltStr.c_str() + 7, 22, salt, 16);
             }
 
+            // Expensive key schedule state, kept between the verify and rehash steps
+            struct EksState
+            {
+                uint32_t passwordStream[18];
+                uint32_t saltStream[18];
+                Blowfish::BlowfishContext ctx;
+
+                EksState(const std::string &password, const uint8_t salt[16])
+                {
+                    // Bcrypt includes the null terminator in the password
+                    size_t passwordLen = password.length() + 1; // +1 for null terminator
+                    const uint8_t *passwordData = reinterpret_cast<const uint8_t *>(password.c_str());
+
+                    // Key and salt words are computed once, the cost loop only XORs them into P
+                    Blowfish::BlowfishContext::keyToStream(passwordData, passwordLen, passwordStream);
+                    Blowfish::BlowfishContext::keyToStream(salt, 16, saltStream);
+
+                    ctx.expandKeyWithSalt(passwordStream, saltStream);
+                }
+
+                // Run the cost loop from round 'from' up to (not including) round 'to'.
+                // Every round is identical, so a cost N state is a prefix of any cost M > N state.
+                void rounds(uint64_t from, uint64_t to)
+                {
+                    for (uint64_t i = from; i < to; ++i)
+                    {
+                        ctx.expandKeyNoSalt(passwordStream);
+                        ctx.expandKeyNoSalt(saltStream);
+                    }
+                }
+
+                // Encrypt "OrpheanBeholderScryDoubt" (bcrypt magic) and encode the 31 char hash
+                void finish(char hashStr[32]) const
+                {
+                    uint32_t ciphertext[BCRYPT_WORDS] = {
+                        0x4f727068, 0x65616e42, 0x65686f6c,
+                        0x64657253, 0x63727944, 0x6f756274};
+
+                    for (uint32_t i = 0; i < 64; ++i)
+                    {
+                        for (uint32_t j = 0; j < BCRYPT_WORDS; j += 2)
+                            ctx.encryptBlock(ciphertext[j], ciphertext[j + 1]);
+                    }
+
+                    // Convert ciphertext to bytes in BIG-ENDIAN order (Bcrypt standard)
+                    uint8_t hashBytes[24];
+                    for (uint32_t i = 0; i < BCRYPT_WORDS; ++i)
+                    {
+                        hashBytes[i * 4 + 0] = (ciphertext[i] >> 24) & 0xff;
+                        hashBytes[i * 4 + 1] = (ciphertext[i] >> 16) & 0xff;
+                        hashBytes[i * 4 + 2] = (ciphertext[i] >> 8) & 0xff;
+                        hashBytes[i * 4 + 3] = ciphertext[i] & 0xff;
+                    }
+
+                    // Encode hash using Bcrypt Base64 (31 chars from 23 bytes)
+                    memset(hashStr, 0, 32);
+                    bcrypt_encode_base64(hashBytes, BCRYPT_HASHSIZE, hashStr, 31);
+                }
+            };
+
+            // Format output: $2a$[cost]$[22 char salt][31 char hash]
+            static std::string format_hash(char format, int cost, const uint8_t salt[16], const char hashStr[32])
+            {
+                // Encode salt using Bcrypt Base64 (22 chars from 16 bytes)
+                char saltStr[32] = {0};
+                bcrypt_encode_base64(salt, 16, saltStr, 22);
+
+                char result[128];
+                snprintf(result, sizeof(result), "$2%c$%02d$%s%s", format, cost, saltStr, hashStr);
+                return std::string(result);
+            }
+
+            // Compare without early exit, so the timing does not leak the matching prefix length
+            static bool constant_time_equals(const char *a, const char *b, size_t len)
+            {
+                volatile uint8_t diff = 0;
+                for (size_t i = 0; i < len; ++i)
+                    diff |= (uint8_t)a[i] ^ (uint8_t)b[i];
+                return diff == 0;
+            }
+
+            // Parse '$2[a/b/y]$NN$[22 char salt][31 char hash]'
+            static bool parse_hash(const std::string &hash, char *variant, int *cost, uint8_t salt[16])
+            {
+                // Accept $2a$, $2b$, $2y$ (all compatible with our corrected implementation)
+                if (hash.length() != (7 + 22 + 31) || hash[0] != '$' || hash[1] != '2' || hash[3] != '$' || hash[6] != '$')
+                    return false;
+
+                *variant = hash[2];
+                if (*variant != 'a' && *variant != 'b' && *variant != 'y')
+                    return false;
+
+                if (hash[4] < '0' || hash[4] > '9' || hash[5] < '0' || hash[5] > '9')
+                    return false;
+                *cost = (hash[4] - '0') * 10 + (hash[5] - '0');
+                if (*cost < 4 || *cost > 31)
+                    return false;
+
+                // Decode salt using Bcrypt Base64 (22 chars starting at position 7)
+                return bcrypt_decode_base64(hash.data() + 7, 22, salt, 16);
+            }
+
             // Generate bcrypt hash with cost factor (4-31, default 10)
             // format can be 'a', 'b', or 'y' (default 'y' for compatibility)
             std::string hash(const std::string &password, int cost, uint8_t salt_from_parameter[16], char format)
@@ -490,112 +632,134 @@ namespace ITKExtension
                 if (format != 'a' && format != 'b' && format != 'y')
                     format = 'y'; // Default to $2y$ for broader compatibility
 
-                // Generate a simple salt (in production, use a cryptographically secure random)
                 uint8_t salt[16];
                 if (salt_from_parameter)
                     memcpy(salt, salt_from_parameter, 16);
                 else
                     random_salt(salt);
 
-                // Bcrypt includes the null terminator in the password
-                size_t passwordLen = password.length() + 1; // +1 for null terminator
-                const uint8_t *passwordData = reinterpret_cast<const uint8_t *>(password.c_str());
+                EksState state(password, salt);
+                state.rounds(0, (uint64_t)1 << cost);
 
-                Blowfish::BlowfishContext ctx;
-                ctx.expandKey(passwordData, passwordLen, salt);
+                char hashStr[32];
+                state.finish(hashStr);
 
-                // Apply cost factor
-                for (uint32_t i = 0; i < (1u << cost); ++i)
-                {
-                    ctx.expandKey(passwordData, passwordLen, nullptr);
-                    ctx.expandKey(salt, 16, nullptr);
-                }
+                return format_hash(format, cost, salt, hashStr);
+            }
 
-                // Encrypt "OrpheanBeholderScryDoubt" (bcrypt magic)
-                uint32_t ciphertext[BCRYPT_WORDS] = {
-                    0x4f727068, 0x65616e42, 0x65686f6c,
-                    0x64657253, 0x63727944, 0x6f756274};
+            // Verify password against bcrypt hash
+            bool verify(const std::string &password, const std::string &hash)
+            {
+                return verifyAndMaybeRehash(password, hash, 0, nullptr);
+            }
 
-                for (uint32_t i = 0; i < 64; ++i)
-                {
-                    for (int j = 0; j < BCRYPT_WORDS; j += 2)
-                        ctx.encrypt(&ciphertext[j], &ciphertext[j + 1]);
-                }
+            bool verifyAndMaybeRehash(const std::string &password, const std::string &hash, int targetCost, std::string *rehash_output)
+            {
+                if (rehash_output)
+                    rehash_output->clear();
 
-                // Format output: $2a$[cost]$[22 char salt][31 char hash]
-                char saltStr[32] = {0};
-                char hashStr[32] = {0};
+                char variant;
+                int cost;
+                uint8_t salt[16];
+                if (!parse_hash(hash, &variant, &cost, salt))
+                    return false;
 
-                // Encode salt using Bcrypt Base64 (22 chars from 16 bytes)
-                bcrypt_encode_base64(salt, 16, saltStr, 22);
-                // saltStr[22] = '\0'; // Bcrypt uses only 22 chars for salt
+                EksState state(password, salt);
+                state.rounds(0, (uint64_t)1 << cost);
 
-                // Convert ciphertext to bytes in BIG-ENDIAN order (Bcrypt standard)
-                uint8_t hashBytes[24];
-                for (int i = 0; i < BCRYPT_WORDS; ++i)
-                {
-                    hashBytes[i * 4 + 0] = (ciphertext[i] >> 24) & 0xff;
-                    hashBytes[i * 4 + 1] = (ciphertext[i] >> 16) & 0xff;
-                    hashBytes[i * 4 + 2] = (ciphertext[i] >> 8) & 0xff;
-                    hashBytes[i * 4 + 3] = ciphertext[i] & 0xff;
-                }
+                char hashStr[32];
+                state.finish(hashStr);
 
-                // Encode hash using Bcrypt Base64 (31 chars from 23 bytes)
-                bcrypt_encode_base64(hashBytes, BCRYPT_HASHSIZE, hashStr, 31);
-                // hashStr[31] = '\0'; // Bcrypt uses only 31 chars for hash
+                // Compare only the hash portion, the format identifier, cost and salt
+                // were already parsed from the stored value
+                if (!constant_time_equals(hashStr, hash.data() + 7 + 22, 31))
+                    return false;
 
-                char result[128];
-                snprintf(result, sizeof(result), "$2%c$%02d$%s%s", format, cost, saltStr, hashStr);
+                if (rehash_output && targetCost > cost && targetCost <= 31)
+                {
+                    // Keep the salt and continue the cost loop where verification stopped
+                    state.rounds((uint64_t)1 << cost, (uint64_t)1 << targetCost);
+                    state.finish(hashStr);
+                    *rehash_output = format_hash(variant, targetCost, salt, hashStr);
+                }
 
-                return std::string(result);
+                return true;
             }
 
-            // Verify password against bcrypt hash
-            bool verify(const std::string &password, const std::string &hash)
+            int recommendCost(double latencyBudgetMs, std::vector<CostBenchmark> *report, int threadCount, int maxCost)
             {
-                // extract cost and salt from hash
-                // Accept $2a$, $2b$, $2y$ (all compatible with our corrected implementation)
-                if (hash.length() < (7 + 22 + 31) || hash.substr(0, 2) != "$2" || hash[2] < 'a' || hash[2] > 'z' || hash[3] != '$')
-                    return false;
-
-                // Verify it's a known bcrypt variant ($2a$, $2b$, $2y$)
-                char variant = hash[2];
-                if (variant != 'a' && variant != 'b' && variant != 'y')
-                    return false;
-
-                // Extract cost
-                int cost = 10;
-                if (hash.length() > 6)
-                    cost = (hash[4] - '0') * 10 + (hash[5] - '0');
+                if (threadCount <= 0)
+                    threadCount = (int)std::thread::hardware_concurrency();
+                if (threadCount <= 0)
+                    threadCount = 1;
+                if (maxCost > 31)
+                    maxCost = 31;
+
+                if (report)
+                    report->clear();
+
+                // each cost is measured several times, the median ignores a scheduler hiccup
+                const int samples = 3;
+                const std::string password = "bcrypt-cost-benchmark";
+                int recommended = -1;
+
+                for (int cost = 4; cost <= maxCost; cost++)
+                {
+                    std::vector<double> latencies(samples, 0.0);
+                    double wall_ms = 0.0;
 
-                if (cost < 4 || cost > 31)
-                    return false;
+                    for (int s = 0; s < samples; s++)
+                    {
+                        // Every thread hashes concurrently, as a loaded server would
+                        std::vector<double> elapsed_ms(threadCount, 0.0);
+                        std::vector<std::thread> threads;
+                        threads.reserve(threadCount);
 
-                // Extract salt (22 chars starting at position 7)
-                if (hash.length() < 29)
-                    return false;
+                        auto wall_begin = std::chrono::steady_clock::now();
+                        for (int t = 0; t < threadCount; t++)
+                        {
+                            threads.emplace_back([&, t]()
+                                                 {
+                                                     uint8_t salt[16];
+                                                     random_salt(salt);
+                                                     auto begin = std::chrono::steady_clock::now();
+                                                     EksState state(password, salt);
+                                                     state.rounds(0, (uint64_t)1 << cost);
+                                                     char hashStr[32];
+                                                     state.finish(hashStr);
+                                                     elapsed_ms[t] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                                                 });
+                        }
+                        for (auto &thread : threads)
+                            thread.join();
+                        wall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_begin).count();
 
-                char saltStr[23] = {0};
-                memcpy(saltStr, hash.data() + 7, 22);
-                saltStr[22] = '\0';
+                        // worst thread latency is what a request would observe under full load
+                        for (double ms : elapsed_ms)
+                            latencies[s] = (std::max)(latencies[s], ms);
+                    }
 
-                // Decode salt using Bcrypt Base64
-                uint8_t saltDecoded[16];
-                if (!bcrypt_decode_base64(saltStr, 22, saltDecoded, sizeof(saltDecoded)))
-                    return false;
+                    std::sort(latencies.begin(), latencies.end());
+                    double latency_ms = latencies[samples / 2];
 
-                // Compute hash using same parameters and same format variant
-                std::string computedHash = Bcrypt::hash(password, cost, saltDecoded, variant);
+                    if (report)
+                    {
+                        CostBenchmark entry;
+                        entry.cost = cost;
+                        entry.ms_per_hash = latency_ms;
+                        entry.hashes_per_second = (wall_ms > 0.0) ? (double)(threadCount * samples) * 1000.0 / wall_ms : 0.0;
+                        report->push_back(entry);
+                    }
 
-                // Compare only salt+hash portions (skip format identifier)
-                // All $2a$, $2b$, $2y$ are algorithmically identical with our corrected implementation
-                if (computedHash.length() >= 7 + 22 + 31 && computedHash.length() == hash.length())
-                    return computedHash.substr(4) == hash.substr(4); // Compare from position 7 (after $2a$NN$)
+                    if (latency_ms > latencyBudgetMs)
+                        break;
+                    recommended = cost;
+                }
 
-                return false;
+                return recommended;
             }
 
         }
 
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,275 @@
+#include <InteractiveToolkit-Extension/hashing/PBKDF2.h>
+#include <InteractiveToolkit-Extension/hashing/HMAC.h>
+#include <InteractiveToolkit/ITKCommon/ITKAbort.h>
+
+#include <string.h>
+
+namespace ITKExtension
+{
+    namespace Hashing
+    {
+        namespace PBKDF2
+        {
+            static inline uint32_t rotr(uint32_t x, uint32_t n) { return (x >> n) | (x << (32 - n)); }
+
+            // One HMAC chain: pad states, running U and accumulated T = U1 ^ ... ^ Uc
+            struct Lane
+            {
+                uint32_t inner[8];
+                uint32_t outer[8];
+                uint32_t u[8];
+                uint32_t t[8];
+            };
+
+            // SHA-256 compression of N independent states over a 32 byte message that is
+            // already padded for a 64+32 byte HMAC input. The lane index is the innermost
+            // loop so the compiler can map lanes onto SIMD registers.
+            template <int N>
+            static inline void compress_hmac_block(uint32_t state[8][N], const uint32_t message[8][N])
+            {
+                uint32_t w[64][N];
+
+                for (int i = 0; i < 8; i++)
+                    for (int l = 0; l < N; l++)
+                        w[i][l] = message[i][l];
+                for (int l = 0; l < N; l++)
+                {
+                    w[8][l] = 0x80000000;
+                    w[9][l] = 0;
+                    w[10][l] = 0;
+                    w[11][l] = 0;
+                    w[12][l] = 0;
+                    w[13][l] = 0;
+                    w[14][l] = 0;
+                    w[15][l] = (64 + 32) * 8;
+                }
+
+                for (int i = 16; i < 64; i++)
+                    for (int l = 0; l < N; l++)
+                    {
+                        uint32_t g0 = rotr(w[i - 15][l], 7) ^ rotr(w[i - 15][l], 18) ^ (w[i - 15][l] >> 3);
+                        uint32_t g1 = rotr(w[i - 2][l], 17) ^ rotr(w[i - 2][l], 19) ^ (w[i - 2][l] >> 10);
+                        w[i][l] = g1 + w[i - 7][l] + g0 + w[i - 16][l];
+                    }
+
+                uint32_t a[N], b[N], c[N], d[N], e[N], f[N], g[N], h[N];
+                for (int l = 0; l < N; l++)
+                {
+                    a[l] = state[0][l];
+                    b[l] = state[1][l];
+                    c[l] = state[2][l];
+                    d[l] = state[3][l];
+                    e[l] = state[4][l];
+                    f[l] = state[5][l];
+                    g[l] = state[6][l];
+                    h[l] = state[7][l];
+                }
+
+                for (int i = 0; i < 64; i++)
+                    for (int l = 0; l < N; l++)
+                    {
+                        uint32_t s1 = rotr(e[l], 6) ^ rotr(e[l], 11) ^ rotr(e[l], 25);
+                        uint32_t ch = (e[l] & f[l]) ^ (~e[l] & g[l]);
+                        uint32_t t1 = h[l] + s1 + ch + SHA256::K[i] + w[i][l];
+                        uint32_t s0 = rotr(a[l], 2) ^ rotr(a[l], 13) ^ rotr(a[l], 22);
+                        uint32_t maj = (a[l] & b[l]) ^ (a[l] & c[l]) ^ (b[l] & c[l]);
+                        uint32_t t2 = s0 + maj;
+                        h[l] = g[l];
+                        g[l] = f[l];
+                        f[l] = e[l];
+                        e[l] = d[l] + t1;
+                        d[l] = c[l];
+                        c[l] = b[l];
+                        b[l] = a[l];
+                        a[l] = t1 + t2;
+                    }
+
+                for (int l = 0; l < N; l++)
+                {
+                    state[0][l] += a[l];
+                    state[1][l] += b[l];
+                    state[2][l] += c[l];
+                    state[3][l] += d[l];
+                    state[4][l] += e[l];
+                    state[5][l] += f[l];
+                    state[6][l] += g[l];
+                    state[7][l] += h[l];
+                }
+            }
+
+            // Iterations 2..c: U_i = HMAC(P, U_i-1), two compressions each
+            template <int N>
+            static void iterate_lanes(Lane *lanes, uint32_t iterations)
+            {
+                uint32_t inner[8][N], outer[8][N], u[8][N], t[8][N], state[8][N];
+                for (int i = 0; i < 8; i++)
+                    for (int l = 0; l < N; l++)
+                    {
+                        inner[i][l] = lanes[l].inner[i];
+                        outer[i][l] = lanes[l].outer[i];
+                        u[i][l] = lanes[l].u[i];
+                        t[i][l] = lanes[l].t[i];
+                    }
+
+                for (uint32_t it = 1; it < iterations; it++)
+                {
+                    memcpy(state, inner, sizeof(state));
+                    compress_hmac_block<N>(state, u);
+                    memcpy(u, state, sizeof(u));
+
+                    memcpy(state, outer, sizeof(state));
+                    compress_hmac_block<N>(state, u);
+                    memcpy(u, state, sizeof(u));
+
+                    for (int i = 0; i < 8; i++)
+                        for (int l = 0; l < N; l++)
+                            t[i][l] ^= u[i][l];
+                }
+
+                for (int i = 0; i < 8; i++)
+                    for (int l = 0; l < N; l++)
+                        lanes[l].t[i] = t[i][l];
+            }
+
+            static void iterate_all(Lane *lanes, size_t count, uint32_t iterations)
+            {
+                while (count >= 8)
+                {
+                    iterate_lanes<8>(lanes, iterations);
+                    lanes += 8;
+                    count -= 8;
+                }
+                if (count >= 4)
+                {
+                    iterate_lanes<4>(lanes, iterations);
+                    lanes += 4;
+                    count -= 4;
+                }
+                while (count > 0)
+                {
+                    iterate_lanes<1>(lanes, iterations);
+                    lanes++;
+                    count--;
+                }
+            }
+
+            static inline uint32_t load32_be(const uint8_t *p)
+            {
+                return ((uint32_t)p[0] << 24) |
+                       ((uint32_t)p[1] << 16) |
+                       ((uint32_t)p[2] << 8) |
+                       ((uint32_t)p[3]);
+            }
+
+            // Pad states and U1 of every output block of one password
+            static void setup_lanes(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, size_t block_count, Lane *lanes)
+            {
+                HMAC<SHA256> hmac(password, password_len);
+
+                // chaining values after the pad blocks, reused by every iteration
+                uint32_t inner[8], outer[8];
+                hmac.innerKeyedState().copyState(inner);
+                hmac.outerKeyedState().copyState(outer);
+
+                for (size_t b = 0; b < block_count; b++)
+                {
+                    Lane &lane = lanes[b];
+                    memcpy(lane.inner, inner, sizeof(inner));
+                    memcpy(lane.outer, outer, sizeof(outer));
+
+                    // U1 = HMAC(P, S || INT(i))
+                    uint32_t index = (uint32_t)(b + 1);
+                    uint8_t index_be[4] = {(uint8_t)(index >> 24), (uint8_t)(index >> 16), (uint8_t)(index >> 8), (uint8_t)index};
+                    uint8_t u1[32];
+                    hmac.update(salt, salt_len);
+                    hmac.update(index_be, 4);
+                    hmac.finalize(u1);
+
+                    for (int i = 0; i < 8; i++)
+                        lane.u[i] = lane.t[i] = load32_be(u1 + i * 4);
+                }
+            }
+
+            static void lane_to_bytes(const Lane &lane, uint8_t *output, size_t len)
+            {
+                for (size_t i = 0; i < len; i++)
+                    output[i] = (uint8_t)(lane.t[i / 4] >> (24 - 8 * (i % 4)));
+            }
+
+            void sha256(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len, uint32_t iterations, uint8_t *output, size_t output_len)
+            {
+                ITK_ABORT(iterations == 0, "PBKDF2 iteration count must be at least 1.\n");
+                if (output_len == 0)
+                    return;
+
+                size_t block_count = (output_len + 31) / 32;
+                std::vector<Lane> lanes(block_count);
+                setup_lanes(password, password_len, salt, salt_len, block_count, lanes.data());
+
+                iterate_all(lanes.data(), block_count, iterations);
+
+                for (size_t b = 0; b < block_count; b++)
+                {
+                    size_t len = output_len - b * 32;
+                    if (len > 32)
+                        len = 32;
+                    lane_to_bytes(lanes[b], output + b * 32, len);
+                }
+
+                memset(lanes.data(), 0, lanes.size() * sizeof(Lane));
+            }
+
+            std::vector<uint8_t> sha256(const std::string &password, const std::vector<uint8_t> &salt, uint32_t iterations, size_t output_len)
+            {
+                std::vector<uint8_t> result(output_len);
+                sha256(reinterpret_cast<const uint8_t *>(password.c_str()), password.length(), salt.data(), salt.size(), iterations, result.data(), output_len);
+                return result;
+            }
+
+            void sha256Batch(const std::vector<std::string> &passwords, const uint8_t *salt, size_t salt_len, uint32_t iterations, size_t output_len, std::vector<std::vector<uint8_t>> *outputs)
+            {
+                ITK_ABORT(iterations == 0, "PBKDF2 iteration count must be at least 1.\n");
+                outputs->resize(passwords.size());
+                if (passwords.empty() || output_len == 0)
+                    return;
+
+                // every block of every password is an independent lane
+                size_t block_count = (output_len + 31) / 32;
+                std::vector<Lane> lanes(passwords.size() * block_count);
+                for (size_t p = 0; p < passwords.size(); p++)
+                    setup_lanes(reinterpret_cast<const uint8_t *>(passwords[p].c_str()), passwords[p].length(),
+                                salt, salt_len, block_count, &lanes[p * block_count]);
+
+                iterate_all(lanes.data(), lanes.size(), iterations);
+
+                for (size_t p = 0; p < passwords.size(); p++)
+                {
+                    std::vector<uint8_t> &output = (*outputs)[p];
+                    output.resize(output_len);
+                    for (size_t b = 0; b < block_count; b++)
+                    {
+                        size_t len = output_len - b * 32;
+                        if (len > 32)
+                            len = 32;
+                        lane_to_bytes(lanes[p * block_count + b], output.data() + b * 32, len);
+                    }
+                }
+
+                memset(lanes.data(), 0, lanes.size() * sizeof(Lane));
+            }
+
+            bool verifySHA256(const std::string &password, const uint8_t *salt, size_t salt_len, uint32_t iterations, const uint8_t *expected, size_t expected_len)
+            {
+                if (expected_len == 0)
+                    return false;
+                std::vector<uint8_t> derived(expected_len);
+                sha256(reinterpret_cast<const uint8_t *>(password.c_str()), password.length(), salt, salt_len, iterations, derived.data(), expected_len);
+
+                volatile uint8_t diff = 0;
+                for (size_t i = 0; i < expected_len; i++)
+                    diff |= derived[i] ^ expected[i];
+                return diff == 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,194 @@
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+#include <InteractiveToolkit/ITKCommon/Memory.h>
+
+#include <atomic>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        // Blocks carry a 16 byte prefix, this keeps the user pointer aligned
+        // like malloc on every platform we build for.
+        static const size_t BLOCK_HEADER_SIZE = 16;
+
+        /// \private
+        class DefaultAllocator : public Allocator
+        {
+        public:
+            void *allocate(size_t size) override
+            {
+                return ITKCommon::Memory::malloc(size);
+            }
+            void release(void *ptr) override
+            {
+                ITKCommon::Memory::free(ptr);
+            }
+        };
+
+        static std::atomic<Allocator *> global_allocator(nullptr);
+        static thread_local Allocator *thread_allocator = nullptr;
+
+        Allocator *Allocator::Default()
+        {
+            static DefaultAllocator instance;
+            return &instance;
+        }
+
+        Allocator *Allocator::Current()
+        {
+            if (thread_allocator != nullptr)
+                return thread_allocator;
+            Allocator *global = global_allocator.load(std::memory_order_acquire);
+            if (global != nullptr)
+                return global;
+            return Default();
+        }
+
+        void Allocator::SetGlobal(Allocator *allocator)
+        {
+            global_allocator.store(allocator, std::memory_order_release);
+        }
+
+        ScopedAllocator::ScopedAllocator(Allocator *allocator)
+        {
+            previous = thread_allocator;
+            thread_allocator = allocator;
+        }
+
+        ScopedAllocator::~ScopedAllocator()
+        {
+            thread_allocator = previous;
+        }
+
+        //----------------------------------------------------------------------------------
+        // PoolAllocator
+        //----------------------------------------------------------------------------------
+
+        // the prefix stores the size class, or -1 for blocks bigger than maxPooledSize
+        static inline int &block_class(void *ptr)
+        {
+            return *(int *)((uint8_t *)ptr - BLOCK_HEADER_SIZE);
+        }
+
+        static inline int size_class(size_t size, int min_bits)
+        {
+            int bits = min_bits;
+            while (((size_t)1 << bits) < size)
+                bits++;
+            return bits - min_bits;
+        }
+
+        PoolAllocator::PoolAllocator(size_t maxCachedBytes, size_t maxPooledSize)
+        {
+            this->maxCachedBytes = maxCachedBytes;
+            this->maxPooledSize = maxPooledSize;
+            stats.hits = 0;
+            stats.misses = 0;
+            stats.cached_bytes = 0;
+        }
+
+        PoolAllocator::~PoolAllocator()
+        {
+            trim();
+        }
+
+        void *PoolAllocator::allocate(size_t size)
+        {
+            if (size == 0)
+                size = 1;
+
+            int cls = -1;
+            size_t block_size = size;
+            if (size <= maxPooledSize)
+            {
+                cls = size_class(size, MIN_CLASS_BITS);
+                if (cls < CLASS_COUNT)
+                {
+                    block_size = (size_t)1 << (cls + MIN_CLASS_BITS);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    std::vector<void *> &list = free_lists[cls];
+                    if (!list.empty())
+                    {
+                        void *ptr = list.back();
+                        list.pop_back();
+                        stats.hits++;
+                        stats.cached_bytes -= block_size;
+                        return ptr;
+                    }
+                    stats.misses++;
+                }
+                else
+                    cls = -1;
+            }
+
+            uint8_t *raw = (uint8_t *)ITKCommon::Memory::malloc(block_size + BLOCK_HEADER_SIZE);
+            if (raw == nullptr)
+                return nullptr;
+            void *ptr = raw + BLOCK_HEADER_SIZE;
+            block_class(ptr) = cls;
+            return ptr;
+        }
+
+        void PoolAllocator::release(void *ptr)
+        {
+            if (ptr == nullptr)
+                return;
+            int cls = block_class(ptr);
+            if (cls >= 0)
+            {
+                size_t block_size = (size_t)1 << (cls + MIN_CLASS_BITS);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stats.cached_bytes + block_size <= maxCachedBytes)
+                {
+                    free_lists[cls].push_back(ptr);
+                    stats.cached_bytes += block_size;
+                    return;
+                }
+            }
+            ITKCommon::Memory::free((uint8_t *)ptr - BLOCK_HEADER_SIZE);
+        }
+
+        void PoolAllocator::trim()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < CLASS_COUNT; i++)
+            {
+                for (void *ptr : free_lists[i])
+                    ITKCommon::Memory::free((uint8_t *)ptr - BLOCK_HEADER_SIZE);
+                free_lists[i].clear();
+            }
+            stats.cached_bytes = 0;
+        }
+
+        PoolAllocator::Stats PoolAllocator::getStats() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+
+        //----------------------------------------------------------------------------------
+        // user buffers
+        //----------------------------------------------------------------------------------
+
+        void *allocBuffer(size_t size)
+        {
+            Allocator *allocator = Allocator::Current();
+            uint8_t *raw = (uint8_t *)allocator->allocate(size + BLOCK_HEADER_SIZE);
+            if (raw == nullptr)
+                return nullptr;
+            *(Allocator **)raw = allocator;
+            return raw + BLOCK_HEADER_SIZE;
+        }
+
+        void freeBuffer(void *ptr)
+        {
+            if (ptr == nullptr)
+                return;
+            uint8_t *raw = (uint8_t *)ptr - BLOCK_HEADER_SIZE;
+            Allocator *allocator = *(Allocator **)raw;
+            allocator->release(raw);
+        }
+
+    }
+}
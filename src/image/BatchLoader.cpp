@@ -0,0 +1,324 @@
+#include <InteractiveToolkit-Extension/image/BatchLoader.h>
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit-Extension/image/Image.h>
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+
+#include <InteractiveToolkit/ITKCommon/StringUtil.h>
+#include <InteractiveToolkit/ITKCommon/FileSystem/File.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        /// \private
+        struct BatchJob
+        {
+            size_t index;
+            std::vector<char> file_data; // owned compressed data for file inputs
+            const char *data;
+            int size;
+            bool invertY;
+            size_t reserved;
+            std::string error;
+        };
+
+        /// \private
+        struct BatchResult
+        {
+            BatchImage image;
+            size_t reserved;
+        };
+
+        /// \private
+        struct BatchRunState
+        {
+            std::mutex mutex;
+            std::condition_variable budget_cv;
+            std::condition_variable job_cv;
+            std::condition_variable result_cv;
+
+            std::deque<BatchJob *> jobs;
+            std::deque<BatchResult> results;
+            bool reading_done;
+
+            size_t budget;
+            size_t used;
+            size_t peak;
+
+            // blocks while the budget is full. When all that is used is held by the caller
+            // (held bytes), any size is accepted.
+            void reserve(size_t bytes, size_t held = 0)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (budget > 0)
+                    budget_cv.wait(lock, [&]
+                                   { return used == held || used + bytes <= budget; });
+                used += bytes;
+                peak = (std::max)(peak, used);
+            }
+
+            void release(size_t bytes)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    used -= bytes;
+                }
+                budget_cv.notify_one();
+            }
+        };
+
+        static size_t decoded_size_estimate(const char *data, int size)
+        {
+            int w = 0, h = 0, chann = 0, depth = 8;
+            bool ok = false;
+            FileFormat format = detectFormat((const uint8_t *)data, (size_t)size);
+            if (format == FileFormat::PNG)
+                ok = PNG::probePNGFromMemory(data, size, &w, &h, &chann, &depth);
+            else if (format == FileFormat::JPG)
+                ok = JPG::probeJPGFromMemory(data, size, &w, &h, &chann, &depth);
+            if (!ok)
+                return 0;
+            return (size_t)w * (size_t)h * (size_t)chann * (size_t)((depth + 7) / 8);
+        }
+
+        // opens the file once: the compressed size is reserved before reading,
+        // so the budget also bounds the read ahead
+        static bool read_whole_file(const std::string &filename, BatchRunState *state, size_t *reserved, std::vector<char> *output, std::string *errorStr)
+        {
+            FILE *fp = ITKCommon::FileSystem::File::fopen(filename.c_str(), "rb", errorStr);
+            if (!fp)
+                return false;
+            bool ok = fseek(fp, 0, SEEK_END) == 0;
+            long size = (ok) ? ftell(fp) : -1;
+            if (size < 0 || size > 0x7fffffff || fseek(fp, 0, SEEK_SET) != 0)
+            {
+                fclose(fp);
+                if (errorStr != nullptr)
+                    *errorStr = ITKCommon::PrintfToStdString("Cannot get the size of %s\n", filename.c_str());
+                return false;
+            }
+            *reserved = (size_t)size;
+            state->reserve(*reserved);
+            output->resize((size_t)size);
+            ok = fread(output->data(), 1, (size_t)size, fp) == (size_t)size;
+            fclose(fp);
+            if (!ok && errorStr != nullptr)
+                *errorStr = ITKCommon::PrintfToStdString("Error reading %s\n", filename.c_str());
+            return ok;
+        }
+
+        static void decode_job(BatchJob *job, BatchImage *image)
+        {
+            image->buffer = nullptr;
+            image->w = image->h = image->chann = image->pixel_depth = 0;
+            if (!job->error.empty())
+            {
+                image->error = job->error;
+                return;
+            }
+
+            FileFormat format = detectFormat((const uint8_t *)job->data, (size_t)job->size);
+            if (format == FileFormat::PNG)
+            {
+                image->buffer = PNG::readPNGFromMemory(job->data, job->size, &image->w, &image->h, &image->chann, &image->pixel_depth, job->invertY);
+                if (image->buffer == nullptr)
+                    image->error = "PNG decode error\n";
+            }
+            else if (format == FileFormat::JPG)
+            {
+                image->buffer = JPG::readJPGFromMemory(job->data, job->size, &image->w, &image->h, &image->chann, &image->pixel_depth, job->invertY);
+                if (image->buffer == nullptr)
+                    image->error = "JPG decode error\n";
+            }
+            else
+                image->error = "Unknown image format\n";
+        }
+
+        BatchLoader::BatchLoader(int threadCount, size_t memoryBudget)
+        {
+            this->threadCount = threadCount;
+            this->memoryBudget = memoryBudget;
+        }
+
+        void BatchLoader::addFile(const std::string &filename, bool invertY)
+        {
+            Input input;
+            input.filename = filename;
+            input.memory = nullptr;
+            input.memory_size = 0;
+            input.invertY = invertY;
+            inputs.push_back(input);
+        }
+
+        void BatchLoader::addMemory(const char *input_buffer, int input_buffer_size, bool invertY)
+        {
+            Input input;
+            input.memory = input_buffer;
+            input.memory_size = input_buffer_size;
+            input.invertY = invertY;
+            inputs.push_back(input);
+        }
+
+        size_t BatchLoader::size() const
+        {
+            return inputs.size();
+        }
+
+        void BatchLoader::clear()
+        {
+            inputs.clear();
+        }
+
+        BatchLoader::Stats BatchLoader::run(const EventCore::Callback<void(BatchImage &image)> &onImageReady)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            BatchRunState state;
+            state.reading_done = false;
+            state.budget = memoryBudget;
+            state.used = 0;
+            state.peak = 0;
+
+            int workers = threadCount;
+            if (workers <= 0)
+                workers = (int)std::thread::hardware_concurrency();
+            workers = (std::max)(1, (std::min)(workers, (int)inputs.size()));
+
+            // reader: loads the inputs in order, reserving memory before each one
+            std::thread reader([this, &state]()
+                               {
+                for (size_t i = 0; i < inputs.size(); i++)
+                {
+                    const Input &input = inputs[i];
+                    BatchJob *job = new BatchJob();
+                    job->index = i;
+                    job->invertY = input.invertY;
+                    job->reserved = 0;
+                    job->data = nullptr;
+                    job->size = 0;
+
+                    if (input.memory != nullptr)
+                    {
+                        job->data = input.memory;
+                        job->size = input.memory_size;
+                        job->reserved = decoded_size_estimate(job->data, job->size);
+                        state.reserve(job->reserved);
+                    }
+                    else
+                    {
+                        if (read_whole_file(input.filename, &state, &job->reserved, &job->file_data, &job->error))
+                        {
+                            job->data = job->file_data.data();
+                            job->size = (int)job->file_data.size();
+                            // the decoded size comes from the header already in memory
+                            size_t decoded = decoded_size_estimate(job->data, job->size);
+                            state.reserve(decoded, job->reserved);
+                            job->reserved += decoded;
+                        }
+                        else if (job->error.empty())
+                            job->error = "Error reading file\n";
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(state.mutex);
+                        state.jobs.push_back(job);
+                    }
+                    state.job_cv.notify_one();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    state.reading_done = true;
+                }
+                state.job_cv.notify_all(); });
+
+            // decoders allocate from the allocator of the calling thread
+            Allocator *allocator = Allocator::Current();
+
+            std::vector<std::thread> decoders;
+            for (int i = 0; i < workers; i++)
+                decoders.push_back(std::thread([this, &state, allocator]()
+                                               {
+                    ScopedAllocator use_allocator(allocator);
+                    while (true)
+                    {
+                        BatchJob *job = nullptr;
+                        {
+                            std::unique_lock<std::mutex> lock(state.mutex);
+                            state.job_cv.wait(lock, [&]
+                                              { return !state.jobs.empty() || state.reading_done; });
+                            if (state.jobs.empty())
+                                break;
+                            job = state.jobs.front();
+                            state.jobs.pop_front();
+                        }
+
+                        BatchResult result;
+                        result.image.index = job->index;
+                        result.image.filename = inputs[job->index].filename;
+                        result.reserved = job->reserved;
+                        decode_job(job, &result.image);
+                        delete job;
+
+                        {
+                            std::lock_guard<std::mutex> lock(state.mutex);
+                            state.results.push_back(std::move(result));
+                        }
+                        state.result_cv.notify_one();
+                    } }));
+
+            // deliver on the calling thread in completion order
+            Stats stats;
+            stats.images = 0;
+            stats.failed = 0;
+            for (size_t delivered = 0; delivered < inputs.size(); delivered++)
+            {
+                BatchResult result;
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.result_cv.wait(lock, [&]
+                                         { return !state.results.empty(); });
+                    result = std::move(state.results.front());
+                    state.results.pop_front();
+                }
+
+                if (result.image.ok())
+                    stats.images++;
+                else
+                    stats.failed++;
+
+                if (onImageReady != nullptr)
+                    onImageReady(result.image);
+
+                if (result.image.buffer != nullptr)
+                    freeBuffer(result.image.buffer);
+
+                state.release(result.reserved);
+            }
+
+            reader.join();
+            for (auto &decoder : decoders)
+                decoder.join();
+
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats.images_per_second = (stats.seconds > 0.0) ? (double)(stats.images + stats.failed) / stats.seconds : 0.0;
+            stats.peak_memory = state.peak;
+            return stats;
+        }
+
+    }
+}
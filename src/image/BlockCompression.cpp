@@ -0,0 +1,1091 @@
+#include <InteractiveToolkit-Extension/image/BlockCompression.h>
+#include <InteractiveToolkit-Extension/image/Resample.h>
+#include <InteractiveToolkit-Extension/image/PixelFormat.h>
+
+#include <InteractiveToolkit/ITKCommon/ITKAbort.h>
+
+#include <InteractiveToolkit-Extension/io/AdvancedReader.h>
+#include <InteractiveToolkit-Extension/io/AdvancedWriter.h>
+
+#include <math.h>
+#include <string.h>
+#include <limits.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSION_SSE
+#include <emmintrin.h>
+#endif
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+        namespace BlockCompression
+        {
+
+            //----------------------------------------------------------------------------------
+            // common
+            //----------------------------------------------------------------------------------
+
+            /// \private
+            /// pixels of one block, only the first count entries are used
+            struct BlockPixels
+            {
+                uint8_t px[16][4];
+                int count;
+            };
+
+            static inline float clamp_255(float v)
+            {
+                return (v < 0.0f) ? 0.0f : ((v > 255.0f) ? 255.0f : v);
+            }
+
+            static void load_block(const uint8_t *rgba, int w, int h, size_t stride, int bx, int by, uint8_t px[16][4])
+            {
+                for (int y = 0; y < 4; y++)
+                {
+                    const uint8_t *row = rgba + (size_t)std::min(by * 4 + y, h - 1) * stride;
+                    for (int x = 0; x < 4; x++)
+                        memcpy(px[y * 4 + x], row + std::min(bx * 4 + x, w - 1) * 4, 4);
+                }
+            }
+
+#if defined(BLOCK_COMPRESSION_SSE)
+            static inline __m128i min_epi32(const __m128i &a, const __m128i &b)
+            {
+                __m128i lt = _mm_cmplt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+            }
+#endif
+
+            // nearest palette entry of each pixel (squared RGBA distance, lowest index on ties)
+            // returns the total squared error
+            static uint32_t select_indices(const uint8_t (*px)[4], int count,
+                                           const uint8_t (*palette)[4], int n,
+                                           uint8_t *indices)
+            {
+                uint32_t total = 0;
+#if defined(BLOCK_COMPRESSION_SSE)
+                // two palette entries per register as 16 bits lanes,
+                // the distance is shifted left by 4 and or'ed with the index so one min finds both
+                __m128i zero = _mm_setzero_si128();
+                __m128i pal[8];
+                __m128i pal_index[8];
+                int pairs = (n + 1) >> 1;
+                for (int p = 0; p < pairs; p++)
+                {
+                    int i0 = p * 2;
+                    int i1 = (i0 + 1 < n) ? i0 + 1 : i0;
+                    uint8_t pair[8];
+                    memcpy(pair, palette[i0], 4);
+                    memcpy(pair + 4, palette[i1], 4);
+                    pal[p] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pair), zero);
+                    pal_index[p] = _mm_set_epi32(i1, i1, i0, i0);
+                }
+                for (int i = 0; i < count; i++)
+                {
+                    int32_t pixel;
+                    memcpy(&pixel, px[i], 4);
+                    __m128i pix = _mm_unpacklo_epi8(_mm_set1_epi32(pixel), zero);
+
+                    __m128i best = _mm_set1_epi32(INT_MAX);
+                    for (int p = 0; p < pairs; p++)
+                    {
+                        __m128i diff = _mm_sub_epi16(pal[p], pix);
+                        __m128i sq = _mm_madd_epi16(diff, diff);
+                        // [rg0 + ba0, .., rg1 + ba1, ..]
+                        __m128i dist = _mm_add_epi32(sq, _mm_shuffle_epi32(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+                        best = min_epi32(best, _mm_or_si128(_mm_slli_epi32(dist, 4), pal_index[p]));
+                    }
+                    best = min_epi32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1, 0, 3, 2)));
+                    uint32_t key = (uint32_t)_mm_cvtsi128_si32(best);
+                    indices[i] = (uint8_t)(key & 15);
+                    total += key >> 4;
+                }
+#else
+                for (int i = 0; i < count; i++)
+                {
+                    uint32_t best = UINT_MAX;
+                    int best_index = 0;
+                    for (int j = 0; j < n; j++)
+                    {
+                        uint32_t dist = 0;
+                        for (int c = 0; c < 4; c++)
+                        {
+                            int d = (int)palette[j][c] - (int)px[i][c];
+                            dist += (uint32_t)(d * d);
+                        }
+                        if (dist < best)
+                        {
+                            best = dist;
+                            best_index = j;
+                        }
+                    }
+                    indices[i] = (uint8_t)best_index;
+                    total += best;
+                }
+#endif
+                return total;
+            }
+
+            //----------------------------------------------------------------------------------
+            // endpoint fitting
+            //----------------------------------------------------------------------------------
+
+            // corners of the bounding box, the diagonal follows the sign of the covariance
+            // against the channel with the largest range, inset by 1/16 of the range
+            static void fit_bounding_box(const uint8_t (*px)[4], int count, int dims, float e0[4], float e1[4])
+            {
+                float mn[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+                float mx[4] = {0, 0, 0, 0};
+                float mean[4] = {0, 0, 0, 0};
+                for (int i = 0; i < count; i++)
+                    for (int c = 0; c < dims; c++)
+                    {
+                        float v = (float)px[i][c];
+                        mn[c] = std::min(mn[c], v);
+                        mx[c] = std::max(mx[c], v);
+                        mean[c] += v;
+                    }
+                int ref = 0;
+                for (int c = 0; c < dims; c++)
+                {
+                    mean[c] /= (float)count;
+                    if (mx[c] - mn[c] > mx[ref] - mn[ref])
+                        ref = c;
+                }
+                for (int c = 0; c < dims; c++)
+                {
+                    float cov = 0;
+                    for (int i = 0; i < count; i++)
+                        cov += ((float)px[i][c] - mean[c]) * ((float)px[i][ref] - mean[ref]);
+                    float inset = (mx[c] - mn[c]) / 16.0f;
+                    float hi = mx[c] - inset;
+                    float lo = mn[c] + inset;
+                    e0[c] = (cov < 0) ? lo : hi;
+                    e1[c] = (cov < 0) ? hi : lo;
+                }
+                for (int c = dims; c < 4; c++)
+                    e0[c] = e1[c] = 0;
+            }
+
+            // extremes of the projection on the principal axis (power iteration on the covariance)
+            static void fit_principal_axis(const uint8_t (*px)[4], int count, int dims, float e0[4], float e1[4])
+            {
+                float mean[4] = {0, 0, 0, 0};
+                float mn[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+                float mx[4] = {0, 0, 0, 0};
+                for (int i = 0; i < count; i++)
+                    for (int c = 0; c < dims; c++)
+                    {
+                        float v = (float)px[i][c];
+                        mean[c] += v;
+                        mn[c] = std::min(mn[c], v);
+                        mx[c] = std::max(mx[c], v);
+                    }
+                for (int c = 0; c < dims; c++)
+                    mean[c] /= (float)count;
+
+                float cov[4][4] = {};
+                for (int i = 0; i < count; i++)
+                {
+                    float d[4];
+                    for (int c = 0; c < dims; c++)
+                        d[c] = (float)px[i][c] - mean[c];
+                    for (int r = 0; r < dims; r++)
+                        for (int c = r; c < dims; c++)
+                            cov[r][c] += d[r] * d[c];
+                }
+                for (int r = 0; r < dims; r++)
+                    for (int c = 0; c < r; c++)
+                        cov[r][c] = cov[c][r];
+
+                float axis[4] = {0, 0, 0, 0};
+                float len = 0;
+                for (int c = 0; c < dims; c++)
+                {
+                    axis[c] = mx[c] - mn[c];
+                    len += axis[c] * axis[c];
+                }
+                for (int c = dims; c < 4; c++)
+                    e0[c] = e1[c] = 0;
+                if (len == 0)
+                {
+                    for (int c = 0; c < dims; c++)
+                        e0[c] = e1[c] = mean[c];
+                    return;
+                }
+
+                for (int it = 0; it < 8; it++)
+                {
+                    float next[4] = {0, 0, 0, 0};
+                    for (int r = 0; r < dims; r++)
+                        for (int c = 0; c < dims; c++)
+                            next[r] += cov[r][c] * axis[c];
+                    len = 0;
+                    for (int c = 0; c < dims; c++)
+                        len += next[c] * next[c];
+                    if (len < 1e-12f)
+                        break;
+                    len = 1.0f / sqrtf(len);
+                    for (int c = 0; c < dims; c++)
+                        axis[c] = next[c] * len;
+                }
+                len = 0;
+                for (int c = 0; c < dims; c++)
+                    len += axis[c] * axis[c];
+                len = 1.0f / sqrtf(len);
+                for (int c = 0; c < dims; c++)
+                    axis[c] *= len;
+
+                float t_min = 0, t_max = 0;
+                for (int i = 0; i < count; i++)
+                {
+                    float t = 0;
+                    for (int c = 0; c < dims; c++)
+                        t += ((float)px[i][c] - mean[c]) * axis[c];
+                    t_min = std::min(t_min, t);
+                    t_max = std::max(t_max, t);
+                }
+                for (int c = 0; c < dims; c++)
+                {
+                    e0[c] = clamp_255(mean[c] + axis[c] * t_max);
+                    e1[c] = clamp_255(mean[c] + axis[c] * t_min);
+                }
+            }
+
+            // endpoints minimizing the squared error for fixed indices,
+            // weight[index] is the contribution of e0 (e1 receives 1 - weight)
+            static bool least_squares_endpoints(const uint8_t (*px)[4], int count, int dims,
+                                                const uint8_t *indices, const float *weight,
+                                                float e0[4], float e1[4])
+            {
+                float aa = 0, ab = 0, bb = 0;
+                float ax[4] = {0, 0, 0, 0};
+                float bx[4] = {0, 0, 0, 0};
+                for (int i = 0; i < count; i++)
+                {
+                    float a = weight[indices[i]];
+                    float b = 1.0f - a;
+                    aa += a * a;
+                    ab += a * b;
+                    bb += b * b;
+                    for (int c = 0; c < dims; c++)
+                    {
+                        ax[c] += a * (float)px[i][c];
+                        bx[c] += b * (float)px[i][c];
+                    }
+                }
+                float det = aa * bb - ab * ab;
+                if (fabsf(det) < 1e-6f)
+                    return false;
+                det = 1.0f / det;
+                for (int c = 0; c < dims; c++)
+                {
+                    e0[c] = clamp_255((ax[c] * bb - bx[c] * ab) * det);
+                    e1[c] = clamp_255((bx[c] * aa - ax[c] * ab) * det);
+                }
+                return true;
+            }
+
+            static int refine_iterations(Quality quality)
+            {
+                switch (quality)
+                {
+                case Quality::Fast:
+                    return 0;
+                case Quality::High:
+                    return 8;
+                case Quality::Normal:
+                default:
+                    return 1;
+                }
+            }
+
+            static void fit_endpoints(const uint8_t (*px)[4], int count, int dims, Quality quality, float e0[4], float e1[4])
+            {
+                if (quality == Quality::Fast)
+                    fit_bounding_box(px, count, dims, e0, e1);
+                else
+                    fit_principal_axis(px, count, dims, e0, e1);
+            }
+
+            //----------------------------------------------------------------------------------
+            // BC1 color block
+            //----------------------------------------------------------------------------------
+
+            static inline uint16_t pack_565(const float c[4])
+            {
+                int r = (int)(clamp_255(c[0]) * (31.0f / 255.0f) + 0.5f);
+                int g = (int)(clamp_255(c[1]) * (63.0f / 255.0f) + 0.5f);
+                int b = (int)(clamp_255(c[2]) * (31.0f / 255.0f) + 0.5f);
+                return (uint16_t)((r << 11) | (g << 5) | b);
+            }
+
+            static inline void unpack_565(uint16_t v, uint8_t out[4])
+            {
+                int r = (v >> 11) & 31;
+                int g = (v >> 5) & 63;
+                int b = v & 31;
+                out[0] = (uint8_t)((r << 3) | (r >> 2));
+                out[1] = (uint8_t)((g << 2) | (g >> 4));
+                out[2] = (uint8_t)((b << 3) | (b >> 2));
+                out[3] = 255;
+            }
+
+            // BC1 decodes c0 > c1 as 4 colors and c0 <= c1 as 3 colors + transparent black,
+            // the color block of BC3 is always 4 colors
+            static void bc1_palette(uint16_t c0, uint16_t c1, bool force_4_colors, uint8_t palette[4][4])
+            {
+                unpack_565(c0, palette[0]);
+                unpack_565(c1, palette[1]);
+                if (c0 > c1 || force_4_colors)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+                        palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+                    }
+                    palette[2][3] = palette[3][3] = 255;
+                }
+                else
+                {
+                    for (int c = 0; c < 3; c++)
+                        palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+                    palette[2][3] = 255;
+                    memset(palette[3], 0, 4);
+                }
+            }
+
+            /// \private
+            struct BC1Candidate
+            {
+                uint16_t c0, c1;
+                uint8_t indices[16];
+                uint32_t error;
+            };
+
+            // orders the endpoints for the requested mode and selects the indices of the opaque pixels,
+            // the alpha of the pixels is ignored (set to 0 by the caller)
+            static void bc1_evaluate(const BlockPixels &opaque, uint16_t c0, uint16_t c1,
+                                     bool three_colors, bool force_4_colors,
+                                     BC1Candidate *result)
+            {
+                if (three_colors ? (c0 > c1) : (c0 < c1))
+                    std::swap(c0, c1);
+                uint8_t palette[4][4];
+                bc1_palette(c0, c1, force_4_colors, palette);
+                for (int i = 0; i < 4; i++)
+                    palette[i][3] = 0;
+                int n = (force_4_colors || c0 > c1) ? 4 : 3;
+                result->c0 = c0;
+                result->c1 = c1;
+                result->error = select_indices(opaque.px, opaque.count, palette, n, result->indices);
+            }
+
+            static void bc1_fit_mode(const BlockPixels &opaque, bool three_colors, bool force_4_colors,
+                                     Quality quality, BC1Candidate *best)
+            {
+                static const float weights_4[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+                static const float weights_3[4] = {1.0f, 0.0f, 0.5f, 0.0f};
+
+                float e0[4], e1[4];
+                fit_endpoints(opaque.px, opaque.count, 3, quality, e0, e1);
+
+                BC1Candidate candidate;
+                bc1_evaluate(opaque, pack_565(e0), pack_565(e1), three_colors, force_4_colors, &candidate);
+                if (candidate.error < best->error)
+                    *best = candidate;
+
+                int iterations = refine_iterations(quality);
+                for (int it = 0; it < iterations && candidate.error > 0; it++)
+                {
+                    const float *weights = (force_4_colors || candidate.c0 > candidate.c1) ? weights_4 : weights_3;
+                    if (!least_squares_endpoints(opaque.px, opaque.count, 3, candidate.indices, weights, e0, e1))
+                        break;
+                    uint32_t last_error = candidate.error;
+                    bc1_evaluate(opaque, pack_565(e0), pack_565(e1), three_colors, force_4_colors, &candidate);
+                    if (candidate.error < best->error)
+                        *best = candidate;
+                    if (candidate.error >= last_error)
+                        break;
+                }
+            }
+
+            // allow_transparent: BC1 with 1 bit alpha (pixels with alpha < 128 become transparent)
+            static void encode_bc1_block(const uint8_t px[16][4], uint8_t *out, Quality quality, bool allow_transparent)
+            {
+                BlockPixels opaque;
+                opaque.count = 0;
+                bool transparent[16];
+                for (int i = 0; i < 16; i++)
+                {
+                    transparent[i] = allow_transparent && px[i][3] < 128;
+                    if (transparent[i])
+                        continue;
+                    memcpy(opaque.px[opaque.count], px[i], 3);
+                    opaque.px[opaque.count][3] = 0;
+                    opaque.count++;
+                }
+
+                BC1Candidate best;
+                best.c0 = best.c1 = 0;
+                best.error = UINT_MAX;
+                memset(best.indices, 0, sizeof(best.indices));
+
+                if (opaque.count > 0)
+                {
+                    if (opaque.count < 16)
+                        bc1_fit_mode(opaque, true, false, quality, &best);
+                    else
+                    {
+                        bc1_fit_mode(opaque, false, !allow_transparent, quality, &best);
+                        if (allow_transparent && quality == Quality::High)
+                            bc1_fit_mode(opaque, true, false, quality, &best);
+                    }
+                }
+
+                uint32_t bits = 0;
+                int j = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    uint32_t index = transparent[i] ? 3 : best.indices[j++];
+                    bits |= index << (i * 2);
+                }
+                out[0] = (uint8_t)(best.c0 & 0xff);
+                out[1] = (uint8_t)(best.c0 >> 8);
+                out[2] = (uint8_t)(best.c1 & 0xff);
+                out[3] = (uint8_t)(best.c1 >> 8);
+                for (int i = 0; i < 4; i++)
+                    out[4 + i] = (uint8_t)(bits >> (i * 8));
+            }
+
+            static void decode_bc1_block(const uint8_t *in, bool force_4_colors, uint8_t px[16][4])
+            {
+                uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8));
+                uint16_t c1 = (uint16_t)(in[2] | (in[3] << 8));
+                uint8_t palette[4][4];
+                bc1_palette(c0, c1, force_4_colors, palette);
+                uint32_t bits = (uint32_t)in[4] | ((uint32_t)in[5] << 8) | ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+                for (int i = 0; i < 16; i++)
+                    memcpy(px[i], palette[(bits >> (i * 2)) & 3], 4);
+            }
+
+            //----------------------------------------------------------------------------------
+            // BC4 single channel block
+            //----------------------------------------------------------------------------------
+
+            // r0 > r1: 8 values, r0 <= r1: 6 values + 0 + 255
+            static void bc4_palette(int r0, int r1, int palette[8])
+            {
+                palette[0] = r0;
+                palette[1] = r1;
+                if (r0 > r1)
+                {
+                    for (int i = 2; i < 8; i++)
+                        palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+                }
+                else
+                {
+                    for (int i = 2; i < 6; i++)
+                        palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+                    palette[6] = 0;
+                    palette[7] = 255;
+                }
+            }
+
+            static uint32_t bc4_evaluate(const uint8_t values[16], int r0, int r1, uint8_t indices[16])
+            {
+                int palette[8];
+                bc4_palette(r0, r1, palette);
+                uint32_t total = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    int best = INT_MAX;
+                    int best_index = 0;
+                    for (int j = 0; j < 8; j++)
+                    {
+                        int d = palette[j] - (int)values[i];
+                        d *= d;
+                        if (d < best)
+                        {
+                            best = d;
+                            best_index = j;
+                        }
+                    }
+                    indices[i] = (uint8_t)best_index;
+                    total += (uint32_t)best;
+                }
+                return total;
+            }
+
+            static void encode_bc4_block(const uint8_t values[16], uint8_t *out, Quality quality)
+            {
+                int mn = 255, mx = 0;
+                int inner_mn = 255, inner_mx = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    int v = values[i];
+                    mn = std::min(mn, v);
+                    mx = std::max(mx, v);
+                    if (v != 0 && v != 255)
+                    {
+                        inner_mn = std::min(inner_mn, v);
+                        inner_mx = std::max(inner_mx, v);
+                    }
+                }
+
+                int best_r0 = mx, best_r1 = mn;
+                uint8_t best_indices[16];
+                uint8_t indices[16];
+                uint32_t best_error = bc4_evaluate(values, best_r0, best_r1, best_indices);
+
+                // move the endpoints around the extremes
+                int radius = (quality == Quality::Fast) ? 0 : ((quality == Quality::High) ? 4 : 1);
+                if (mx > mn && best_error > 0)
+                {
+                    for (int r0 = std::max(mx - radius, 0); r0 <= mx; r0++)
+                        for (int r1 = mn; r1 <= std::min(mn + radius, 255); r1++)
+                        {
+                            if (r0 <= r1 || (r0 == mx && r1 == mn))
+                                continue;
+                            uint32_t error = bc4_evaluate(values, r0, r1, indices);
+                            if (error < best_error)
+                            {
+                                best_error = error;
+                                best_r0 = r0;
+                                best_r1 = r1;
+                                memcpy(best_indices, indices, 16);
+                            }
+                        }
+                }
+
+                // 6 values mode, when the block touches 0 or 255
+                if (quality != Quality::Fast && best_error > 0 && (mn == 0 || mx == 255))
+                {
+                    int r0 = (inner_mn <= inner_mx) ? inner_mn : 0;
+                    int r1 = (inner_mn <= inner_mx) ? inner_mx : 0;
+                    uint32_t error = bc4_evaluate(values, r0, r1, indices);
+                    if (error < best_error)
+                    {
+                        best_error = error;
+                        best_r0 = r0;
+                        best_r1 = r1;
+                        memcpy(best_indices, indices, 16);
+                    }
+                }
+
+                out[0] = (uint8_t)best_r0;
+                out[1] = (uint8_t)best_r1;
+                uint64_t bits = 0;
+                for (int i = 0; i < 16; i++)
+                    bits |= (uint64_t)best_indices[i] << (i * 3);
+                for (int i = 0; i < 6; i++)
+                    out[2 + i] = (uint8_t)(bits >> (i * 8));
+            }
+
+            static void decode_bc4_block(const uint8_t *in, uint8_t values[16])
+            {
+                int palette[8];
+                bc4_palette(in[0], in[1], palette);
+                uint64_t bits = 0;
+                for (int i = 0; i < 6; i++)
+                    bits |= (uint64_t)in[2 + i] << (i * 8);
+                for (int i = 0; i < 16; i++)
+                    values[i] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+            }
+
+            static void encode_bc4_channel(const uint8_t px[16][4], int channel, uint8_t *out, Quality quality)
+            {
+                uint8_t values[16];
+                for (int i = 0; i < 16; i++)
+                    values[i] = px[i][channel];
+                encode_bc4_block(values, out, quality);
+            }
+
+            //----------------------------------------------------------------------------------
+            // BC7 (mode 6: single subset RGBA, 7 bits endpoints + p-bit, 4 bits indices)
+            //----------------------------------------------------------------------------------
+
+            static const int bc7_weights_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+            /// \private
+            struct BC7Candidate
+            {
+                uint8_t e[2][4]; // 7 bits endpoints
+                uint8_t p[2];
+                uint8_t indices[16];
+                uint32_t error;
+            };
+
+            static inline int bc7_quantize(float v, int p)
+            {
+                int q = (int)floorf((clamp_255(v) - (float)p) * 0.5f + 0.5f);
+                return (q < 0) ? 0 : ((q > 127) ? 127 : q);
+            }
+
+            static void bc7_palette(const uint8_t e[2][4], const uint8_t p[2], uint8_t palette[16][4])
+            {
+                int v0[4], v1[4];
+                for (int c = 0; c < 4; c++)
+                {
+                    v0[c] = (e[0][c] << 1) | p[0];
+                    v1[c] = (e[1][c] << 1) | p[1];
+                }
+                for (int i = 0; i < 16; i++)
+                {
+                    int w = bc7_weights_4[i];
+                    for (int c = 0; c < 4; c++)
+                        palette[i][c] = (uint8_t)(((64 - w) * v0[c] + w * v1[c] + 32) >> 6);
+                }
+            }
+
+            static void bc7_evaluate(const uint8_t px[16][4], const float e0[4], const float e1[4], int p0, int p1,
+                                     BC7Candidate *result)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    result->e[0][c] = (uint8_t)bc7_quantize(e0[c], p0);
+                    result->e[1][c] = (uint8_t)bc7_quantize(e1[c], p1);
+                }
+                result->p[0] = (uint8_t)p0;
+                result->p[1] = (uint8_t)p1;
+                uint8_t palette[16][4];
+                bc7_palette(result->e, result->p, palette);
+                result->error = select_indices(px, 16, palette, 16, result->indices);
+            }
+
+            // p-bit of an endpoint with the lowest quantization error
+            static int bc7_best_pbit(const float e[4])
+            {
+                float error[2] = {0, 0};
+                for (int p = 0; p < 2; p++)
+                    for (int c = 0; c < 4; c++)
+                    {
+                        float d = (float)((bc7_quantize(e[c], p) << 1) | p) - e[c];
+                        error[p] += d * d;
+                    }
+                return (error[1] < error[0]) ? 1 : 0;
+            }
+
+            static void bc7_evaluate_pbits(const uint8_t px[16][4], const float e0[4], const float e1[4], Quality quality,
+                                           BC7Candidate *result)
+            {
+                if (quality != Quality::High)
+                {
+                    bc7_evaluate(px, e0, e1, bc7_best_pbit(e0), bc7_best_pbit(e1), result);
+                    return;
+                }
+                result->error = UINT_MAX;
+                for (int p = 0; p < 4; p++)
+                {
+                    BC7Candidate candidate;
+                    bc7_evaluate(px, e0, e1, p & 1, p >> 1, &candidate);
+                    if (candidate.error < result->error)
+                        *result = candidate;
+                }
+            }
+
+            /// \private
+            struct BitWriter
+            {
+                uint8_t *out;
+                int pos;
+
+                void put(uint32_t v, int bits)
+                {
+                    for (int i = 0; i < bits; i++, pos++)
+                        out[pos >> 3] |= (uint8_t)(((v >> i) & 1) << (pos & 7));
+                }
+            };
+
+            /// \private
+            struct BitReader
+            {
+                const uint8_t *in;
+                int pos;
+
+                uint32_t get(int bits)
+                {
+                    uint32_t v = 0;
+                    for (int i = 0; i < bits; i++, pos++)
+                        v |= (uint32_t)((in[pos >> 3] >> (pos & 7)) & 1) << i;
+                    return v;
+                }
+            };
+
+            static void encode_bc7_block(const uint8_t px[16][4], uint8_t *out, Quality quality)
+            {
+                float weights[16];
+                for (int i = 0; i < 16; i++)
+                    weights[i] = (float)(64 - bc7_weights_4[i]) / 64.0f;
+
+                float e0[4], e1[4];
+                fit_endpoints(px, 16, 4, quality, e0, e1);
+
+                BC7Candidate best, candidate;
+                bc7_evaluate_pbits(px, e0, e1, quality, &best);
+                candidate = best;
+
+                int iterations = refine_iterations(quality);
+                for (int it = 0; it < iterations && candidate.error > 0; it++)
+                {
+                    if (!least_squares_endpoints(px, 16, 4, candidate.indices, weights, e0, e1))
+                        break;
+                    uint32_t last_error = candidate.error;
+                    bc7_evaluate_pbits(px, e0, e1, quality, &candidate);
+                    if (candidate.error < best.error)
+                        best = candidate;
+                    if (candidate.error >= last_error)
+                        break;
+                }
+
+                // the anchor index has an implicit 0 msb
+                if (best.indices[0] & 8)
+                {
+                    for (int c = 0; c < 4; c++)
+                        std::swap(best.e[0][c], best.e[1][c]);
+                    std::swap(best.p[0], best.p[1]);
+                    for (int i = 0; i < 16; i++)
+                        best.indices[i] = (uint8_t)(15 - best.indices[i]);
+                }
+
+                memset(out, 0, 16);
+                BitWriter writer = {out, 0};
+                writer.put(1 << 6, 7);
+                for (int c = 0; c < 4; c++)
+                {
+                    writer.put(best.e[0][c], 7);
+                    writer.put(best.e[1][c], 7);
+                }
+                writer.put(best.p[0], 1);
+                writer.put(best.p[1], 1);
+                writer.put(best.indices[0], 3);
+                for (int i = 1; i < 16; i++)
+                    writer.put(best.indices[i], 4);
+            }
+
+            static bool decode_bc7_block(const uint8_t *in, uint8_t px[16][4])
+            {
+                if ((in[0] & 0x7f) != 0x40)
+                    return false;
+                BitReader reader = {in, 7};
+                uint8_t e[2][4], p[2];
+                for (int c = 0; c < 4; c++)
+                {
+                    e[0][c] = (uint8_t)reader.get(7);
+                    e[1][c] = (uint8_t)reader.get(7);
+                }
+                p[0] = (uint8_t)reader.get(1);
+                p[1] = (uint8_t)reader.get(1);
+                uint8_t palette[16][4];
+                bc7_palette(e, p, palette);
+                for (int i = 0; i < 16; i++)
+                    memcpy(px[i], palette[reader.get((i == 0) ? 3 : 4)], 4);
+                return true;
+            }
+
+            //----------------------------------------------------------------------------------
+            // image
+            //----------------------------------------------------------------------------------
+
+            static void encode_block(const uint8_t px[16][4], Format format, Quality quality, uint8_t *out)
+            {
+                switch (format)
+                {
+                case Format::BC1:
+                    encode_bc1_block(px, out, quality, true);
+                    break;
+                case Format::BC3:
+                    encode_bc4_channel(px, 3, out, quality);
+                    encode_bc1_block(px, out + 8, quality, false);
+                    break;
+                case Format::BC4:
+                    encode_bc4_channel(px, 0, out, quality);
+                    break;
+                case Format::BC5:
+                    encode_bc4_channel(px, 0, out, quality);
+                    encode_bc4_channel(px, 1, out + 8, quality);
+                    break;
+                case Format::BC7:
+                    encode_bc7_block(px, out, quality);
+                    break;
+                }
+            }
+
+            static bool decode_block(const uint8_t *in, Format format, uint8_t px[16][4])
+            {
+                uint8_t values[16];
+                switch (format)
+                {
+                case Format::BC1:
+                    decode_bc1_block(in, false, px);
+                    return true;
+                case Format::BC3:
+                    decode_bc1_block(in + 8, true, px);
+                    decode_bc4_block(in, values);
+                    for (int i = 0; i < 16; i++)
+                        px[i][3] = values[i];
+                    return true;
+                case Format::BC4:
+                    decode_bc4_block(in, values);
+                    for (int i = 0; i < 16; i++)
+                    {
+                        px[i][0] = values[i];
+                        px[i][1] = px[i][2] = 0;
+                        px[i][3] = 255;
+                    }
+                    return true;
+                case Format::BC5:
+                    decode_bc4_block(in, values);
+                    for (int i = 0; i < 16; i++)
+                    {
+                        px[i][0] = values[i];
+                        px[i][2] = 0;
+                        px[i][3] = 255;
+                    }
+                    decode_bc4_block(in + 8, values);
+                    for (int i = 0; i < 16; i++)
+                        px[i][1] = values[i];
+                    return true;
+                case Format::BC7:
+                    return decode_bc7_block(in, px);
+                }
+                return false;
+            }
+
+            static bool valid_format(Format format)
+            {
+                return format == Format::BC1 || format == Format::BC3 ||
+                       format == Format::BC4 || format == Format::BC5 ||
+                       format == Format::BC7;
+            }
+
+            size_t blockSize(Format format)
+            {
+                return (format == Format::BC1 || format == Format::BC4) ? 8 : 16;
+            }
+
+            size_t compressedSize(Format format, int w, int h)
+            {
+                if (w <= 0 || h <= 0)
+                    return 0;
+                return (size_t)((w + 3) / 4) * (size_t)((h + 3) / 4) * blockSize(format);
+            }
+
+            /// \private
+            struct EncodeJob
+            {
+                const uint8_t *rgba;
+                int w, h;
+                size_t stride;
+                Format format;
+                Quality quality;
+                uint8_t *output;
+                int blocks_x, blocks_y;
+                size_t block_size;
+                std::atomic<int> next_row;
+            };
+
+            static void encode_worker(EncodeJob *job)
+            {
+                uint8_t px[16][4];
+                int by;
+                while ((by = job->next_row.fetch_add(1)) < job->blocks_y)
+                {
+                    uint8_t *out = job->output + (size_t)by * job->blocks_x * job->block_size;
+                    for (int bx = 0; bx < job->blocks_x; bx++, out += job->block_size)
+                    {
+                        load_block(job->rgba, job->w, job->h, job->stride, bx, by, px);
+                        encode_block(px, job->format, job->quality, out);
+                    }
+                }
+            }
+
+            bool encode(const uint8_t *rgba, int w, int h, size_t stride, Format format, uint8_t *output,
+                        Quality quality, int threadCount)
+            {
+                if (rgba == nullptr || output == nullptr || w <= 0 || h <= 0 || !valid_format(format))
+                    return false;
+
+                EncodeJob job;
+                job.rgba = rgba;
+                job.w = w;
+                job.h = h;
+                job.stride = stride;
+                job.format = format;
+                job.quality = quality;
+                job.output = output;
+                job.blocks_x = (w + 3) / 4;
+                job.blocks_y = (h + 3) / 4;
+                job.block_size = blockSize(format);
+                job.next_row = 0;
+
+                if (threadCount <= 0)
+                    threadCount = (int)std::thread::hardware_concurrency();
+                threadCount = std::max(1, std::min(threadCount, job.blocks_y));
+
+                std::vector<std::thread> threads;
+                for (int i = 1; i < threadCount; i++)
+                    threads.push_back(std::thread(encode_worker, &job));
+                encode_worker(&job);
+                for (auto &thread : threads)
+                    thread.join();
+
+                return true;
+            }
+
+            bool decode(const uint8_t *blocks, int w, int h, Format format, uint8_t *rgba, size_t stride)
+            {
+                if (blocks == nullptr || rgba == nullptr || w <= 0 || h <= 0 || !valid_format(format))
+                    return false;
+
+                size_t block_size = blockSize(format);
+                int blocks_x = (w + 3) / 4;
+                int blocks_y = (h + 3) / 4;
+                uint8_t px[16][4];
+                for (int by = 0; by < blocks_y; by++)
+                {
+                    for (int bx = 0; bx < blocks_x; bx++, blocks += block_size)
+                    {
+                        if (!decode_block(blocks, format, px))
+                            return false;
+                        int copy_w = std::min(4, w - bx * 4);
+                        int copy_h = std::min(4, h - by * 4);
+                        for (int y = 0; y < copy_h; y++)
+                            memcpy(rgba + (size_t)(by * 4 + y) * stride + (size_t)bx * 16, px[y * 4], copy_w * 4);
+                    }
+                }
+                return true;
+            }
+
+            double psnr(Format format,
+                        const uint8_t *a, size_t a_stride,
+                        const uint8_t *b, size_t b_stride,
+                        int w, int h)
+            {
+                int channels;
+                switch (format)
+                {
+                case Format::BC1:
+                    channels = 3;
+                    break;
+                case Format::BC4:
+                    channels = 1;
+                    break;
+                case Format::BC5:
+                    channels = 2;
+                    break;
+                default:
+                    channels = 4;
+                    break;
+                }
+
+                double sum = 0;
+                for (int y = 0; y < h; y++)
+                {
+                    const uint8_t *ra = a + (size_t)y * a_stride;
+                    const uint8_t *rb = b + (size_t)y * b_stride;
+                    for (int x = 0; x < w; x++)
+                        for (int c = 0; c < channels; c++)
+                        {
+                            double d = (double)ra[x * 4 + c] - (double)rb[x * 4 + c];
+                            sum += d * d;
+                        }
+                }
+                if (sum == 0 || w <= 0 || h <= 0)
+                    return 999.0;
+                double mse = sum / ((double)w * (double)h * (double)channels);
+                return 10.0 * log10(255.0 * 255.0 / mse);
+            }
+
+        }
+
+        //----------------------------------------------------------------------------------
+        // CompressedTexture
+        //----------------------------------------------------------------------------------
+
+        CompressedTexture::CompressedTexture()
+        {
+            format = BlockCompression::Format::BC7;
+            srgb = true;
+        }
+
+        bool CompressedTexture::encode(const std::vector<Resample::MipLevel> &chain, int chann, BlockCompression::Format format,
+                                       BlockCompression::Quality quality, int threadCount, bool srgb)
+        {
+            levels.clear();
+            if (chain.size() == 0 || chann < 1 || chann > 4)
+                return false;
+
+            this->format = format;
+            this->srgb = srgb;
+
+            std::vector<uint8_t> rgba;
+            levels.resize(chain.size());
+            for (size_t i = 0; i < chain.size(); i++)
+            {
+                const Resample::MipLevel &src = chain[i];
+                Level &level = levels[i];
+                level.w = src.w;
+                level.h = src.h;
+                level.blocks.resize(BlockCompression::compressedSize(format, src.w, src.h));
+
+                const uint8_t *pixels = src.pixels.data();
+                if (chann != 4)
+                {
+                    rgba.resize((size_t)src.w * src.h * 4);
+                    PixelFormat::convert(pixels, chann, (size_t)src.w * chann,
+                                         rgba.data(), 4, (size_t)src.w * 4,
+                                         src.w, src.h);
+                    pixels = rgba.data();
+                }
+
+                if (!BlockCompression::encode(pixels, src.w, src.h, (size_t)src.w * 4, format, level.blocks.data(), quality, threadCount))
+                {
+                    levels.clear();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void CompressedTexture::write(ITKExtension::IO::AdvancedWriter *writer) const
+        {
+            writer->writeUInt8((uint8_t)format);
+            writer->writeBool(srgb);
+            writer->writeUInt32((uint32_t)levels.size());
+            for (const auto &level : levels)
+            {
+                writer->writeUInt32((uint32_t)level.w);
+                writer->writeUInt32((uint32_t)level.h);
+                writer->writeUInt32((uint32_t)level.blocks.size());
+                if (level.blocks.size() > 0)
+                    writer->writeRaw(level.blocks.data(), level.blocks.size());
+            }
+        }
+
+        void CompressedTexture::read(ITKExtension::IO::AdvancedReader *reader)
+        {
+            format = (BlockCompression::Format)reader->readUInt8();
+            ITK_ABORT(!BlockCompression::valid_format(format), "Invalid block compression format.\n");
+            srgb = reader->readBool();
+            levels.resize(reader->readUInt32());
+            for (auto &level : levels)
+            {
+                level.w = (int)reader->readUInt32();
+                level.h = (int)reader->readUInt32();
+                uint32_t size = reader->readUInt32();
+                ITK_ABORT(size != BlockCompression::compressedSize(format, level.w, level.h), "Compressed texture level size mismatch.\n");
+                level.blocks.resize(size);
+                if (size > 0)
+                    reader->readRaw(level.blocks.data(), size);
+            }
+        }
+
+    }
+}
@@ -0,0 +1,302 @@
+#include <InteractiveToolkit-Extension/image/DecodedCache.h>
+#include <InteractiveToolkit-Extension/image/Image.h>
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+
+#include <string.h>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        //----------------------------------------------------------------------------------
+        // DecodedImage
+        //----------------------------------------------------------------------------------
+
+        DecodedImage::DecodedImage()
+        {
+            buffer = nullptr;
+            w = h = chann = pixel_depth = 0;
+        }
+
+        DecodedImage::~DecodedImage()
+        {
+            if (buffer != nullptr)
+                freeBuffer(buffer);
+            buffer = nullptr;
+        }
+
+        size_t DecodedImage::size() const
+        {
+            // rows of 1, 2 and 4 bits PNG pixels are packed and padded to whole bytes
+            return ((size_t)w * (size_t)chann * (size_t)pixel_depth + 7) / 8 * (size_t)h;
+        }
+
+        //----------------------------------------------------------------------------------
+        // xxHash64
+        //----------------------------------------------------------------------------------
+
+        static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+        static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+        static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+        static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+        static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+        static inline uint64_t rotl64(uint64_t v, int r)
+        {
+            return (v << r) | (v >> (64 - r));
+        }
+
+        static inline uint64_t read64(const uint8_t *p)
+        {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            return v;
+        }
+
+        static inline uint32_t read32(const uint8_t *p)
+        {
+            uint32_t v;
+            memcpy(&v, p, 4);
+            return v;
+        }
+
+        static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+        {
+            acc += input * PRIME64_2;
+            acc = rotl64(acc, 31);
+            return acc * PRIME64_1;
+        }
+
+        static inline uint64_t xxh64_merge(uint64_t acc, uint64_t value)
+        {
+            acc ^= xxh64_round(0, value);
+            return acc * PRIME64_1 + PRIME64_4;
+        }
+
+        uint64_t DecodedCache::Hash(const void *data, size_t size, uint64_t seed)
+        {
+            const uint8_t *p = (const uint8_t *)data;
+            const uint8_t *end = p + size;
+            uint64_t h;
+
+            if (size >= 32)
+            {
+                uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+                uint64_t v2 = seed + PRIME64_2;
+                uint64_t v3 = seed;
+                uint64_t v4 = seed - PRIME64_1;
+                const uint8_t *limit = end - 32;
+                do
+                {
+                    v1 = xxh64_round(v1, read64(p));
+                    v2 = xxh64_round(v2, read64(p + 8));
+                    v3 = xxh64_round(v3, read64(p + 16));
+                    v4 = xxh64_round(v4, read64(p + 24));
+                    p += 32;
+                } while (p <= limit);
+
+                h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+                h = xxh64_merge(h, v1);
+                h = xxh64_merge(h, v2);
+                h = xxh64_merge(h, v3);
+                h = xxh64_merge(h, v4);
+            }
+            else
+                h = seed + PRIME64_5;
+
+            h += (uint64_t)size;
+
+            for (; p + 8 <= end; p += 8)
+            {
+                h ^= xxh64_round(0, read64(p));
+                h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+            }
+            if (p + 4 <= end)
+            {
+                h ^= (uint64_t)read32(p) * PRIME64_1;
+                h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+                p += 4;
+            }
+            for (; p < end; p++)
+            {
+                h ^= (uint64_t)(*p) * PRIME64_5;
+                h = rotl64(h, 11) * PRIME64_1;
+            }
+
+            h ^= h >> 33;
+            h *= PRIME64_2;
+            h ^= h >> 29;
+            h *= PRIME64_3;
+            h ^= h >> 32;
+            return h;
+        }
+
+        //----------------------------------------------------------------------------------
+        // DecodedCache
+        //----------------------------------------------------------------------------------
+
+        bool DecodedCache::Key::operator==(const Key &other) const
+        {
+            return hash == other.hash &&
+                   size == other.size &&
+                   target_width == other.target_width &&
+                   target_height == other.target_height &&
+                   invertY == other.invertY;
+        }
+
+        size_t DecodedCache::KeyHasher::operator()(const Key &key) const
+        {
+            uint64_t h = key.hash;
+            h ^= ((uint64_t)(uint32_t)key.target_width << 32 | (uint32_t)key.target_height) * PRIME64_1;
+            h ^= (uint64_t)key.invertY * PRIME64_3;
+            return (size_t)(h ^ (h >> 32));
+        }
+
+        DecodedCache::DecodedCache(size_t memoryBudget)
+        {
+            this->memoryBudget = memoryBudget;
+            memset(&stats, 0, sizeof(Stats));
+        }
+
+        void DecodedCache::evict_to_budget()
+        {
+            // never evicts the front (the entry just used)
+            while (stats.bytes > memoryBudget && lru.size() > 1)
+            {
+                Entry &last = lru.back();
+                stats.bytes -= last.image->size();
+                stats.evictions++;
+                entries.erase(last.key);
+                lru.pop_back();
+            }
+            stats.entries = lru.size();
+        }
+
+        std::shared_ptr<const DecodedImage> DecodedCache::get(const char *input_buffer, int input_buffer_size,
+                                                              bool invertY,
+                                                              int target_width, int target_height,
+                                                              std::string *errorStr)
+        {
+            if (input_buffer == nullptr || input_buffer_size <= 0)
+            {
+                if (errorStr != nullptr)
+                    *errorStr = "Empty image buffer.\n";
+                return nullptr;
+            }
+
+            FileFormat format = detectFormat((const uint8_t *)input_buffer, (size_t)input_buffer_size);
+
+            Key key;
+            key.hash = Hash(input_buffer, (size_t)input_buffer_size);
+            key.size = (uint64_t)input_buffer_size;
+            // the PNG decode ignores the target size, every request shares one entry
+            key.target_width = (format == FileFormat::JPG) ? target_width : 0;
+            key.target_height = (format == FileFormat::JPG) ? target_height : 0;
+            key.invertY = invertY;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = entries.find(key);
+                if (it != entries.end())
+                {
+                    lru.splice(lru.begin(), lru, it->second);
+                    stats.hits++;
+                    return it->second->image;
+                }
+                stats.misses++;
+            }
+
+            std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+            if (format == FileFormat::PNG)
+                image->buffer = PNG::readPNGFromMemory(input_buffer, input_buffer_size,
+                                                       &image->w, &image->h, &image->chann, &image->pixel_depth,
+                                                       invertY);
+            else if (format == FileFormat::JPG)
+                image->buffer = JPG::readJPGFromMemoryScaled(input_buffer, input_buffer_size,
+                                                             target_width, target_height,
+                                                             &image->w, &image->h, &image->chann, &image->pixel_depth,
+                                                             invertY);
+            else
+            {
+                if (errorStr != nullptr)
+                    *errorStr = "Unknown image format.\n";
+                return nullptr;
+            }
+
+            if (image->buffer == nullptr)
+            {
+                if (errorStr != nullptr)
+                    *errorStr = "Error to decode image.\n";
+                return nullptr;
+            }
+
+            size_t image_size = image->size();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end())
+            {
+                // decoded by another thread meanwhile
+                lru.splice(lru.begin(), lru, it->second);
+                return it->second->image;
+            }
+            if (image_size > memoryBudget)
+                return image;
+
+            lru.push_front(Entry{key, image});
+            entries[key] = lru.begin();
+            stats.bytes += image_size;
+            evict_to_budget();
+            return image;
+        }
+
+        void DecodedCache::setMemoryBudget(size_t memoryBudget)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->memoryBudget = memoryBudget;
+            // the front entry is also dropped when it alone exceeds the new budget
+            evict_to_budget();
+            if (stats.bytes > memoryBudget && lru.size() == 1)
+            {
+                stats.bytes = 0;
+                stats.evictions++;
+                entries.clear();
+                lru.clear();
+                stats.entries = 0;
+            }
+        }
+
+        size_t DecodedCache::getMemoryBudget() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return memoryBudget;
+        }
+
+        void DecodedCache::clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries.clear();
+            lru.clear();
+            stats.bytes = 0;
+            stats.entries = 0;
+        }
+
+        DecodedCache::Stats DecodedCache::getStats() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+
+        void DecodedCache::resetStats()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.hits = 0;
+            stats.misses = 0;
+            stats.evictions = 0;
+        }
+
+    }
+}
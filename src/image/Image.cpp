@@ -0,0 +1,292 @@
+#include <InteractiveToolkit-Extension/image/Image.h>
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+#include <InteractiveToolkit-Extension/image/PixelFormat.h>
+
+#include <InteractiveToolkit/ITKCommon/StringUtil.h>
+#include <InteractiveToolkit/ITKCommon/FileSystem/File.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        FileFormat detectFormat(const uint8_t *data, size_t size)
+        {
+            if (data == nullptr)
+                return FileFormat::Unknown;
+            if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0)
+                return FileFormat::PNG;
+            if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+                return FileFormat::JPG;
+            return FileFormat::Unknown;
+        }
+
+        Image::Image()
+        {
+            data = nullptr;
+            w = h = chann = 0;
+            pixel_depth = 8;
+            stride = 0;
+        }
+
+        Image Image::Create(int w, int h, int chann, int pixel_depth)
+        {
+            Image result;
+            if (w <= 0 || h <= 0 || chann < 1 || chann > 4 || (pixel_depth != 8 && pixel_depth != 16))
+                return result;
+            result.w = w;
+            result.h = h;
+            result.chann = chann;
+            result.pixel_depth = pixel_depth;
+            result.stride = (ptrdiff_t)result.rowBytes();
+            result.data = (uint8_t *)allocBuffer(result.rowBytes() * (size_t)h);
+            result.storage = std::shared_ptr<void>(result.data, freeBuffer);
+            return result;
+        }
+
+        Image Image::FromBuffer(char *buffer, int w, int h, int chann, int pixel_depth)
+        {
+            Image result;
+            if (buffer == nullptr)
+                return result;
+            if (pixel_depth != 8 && pixel_depth != 16)
+            {
+                // the rows of packed pixels have no whole byte pixel size
+                freeBuffer(buffer);
+                return result;
+            }
+            result.storage = std::shared_ptr<void>(buffer, freeBuffer);
+            result.data = (uint8_t *)buffer;
+            result.w = w;
+            result.h = h;
+            result.chann = chann;
+            result.pixel_depth = pixel_depth;
+            result.stride = (ptrdiff_t)result.rowBytes();
+            return result;
+        }
+
+        Image Image::Wrap(uint8_t *data, int w, int h, int chann, ptrdiff_t stride, int pixel_depth,
+                          std::shared_ptr<void> owner)
+        {
+            Image result;
+            if (data == nullptr || w <= 0 || h <= 0)
+                return result;
+            result.storage = owner;
+            result.data = data;
+            result.w = w;
+            result.h = h;
+            result.chann = chann;
+            result.pixel_depth = pixel_depth;
+            result.stride = stride;
+            return result;
+        }
+
+        bool Image::empty() const
+        {
+            return data == nullptr || w <= 0 || h <= 0;
+        }
+
+        int Image::pixelBytes() const
+        {
+            return chann * (pixel_depth / 8);
+        }
+
+        size_t Image::rowBytes() const
+        {
+            return (size_t)w * (size_t)pixelBytes();
+        }
+
+        bool Image::isContiguous() const
+        {
+            return stride == (ptrdiff_t)rowBytes();
+        }
+
+        uint8_t *Image::row(int y) const
+        {
+            return data + (ptrdiff_t)y * stride;
+        }
+
+        uint8_t *Image::pixel(int x, int y) const
+        {
+            return row(y) + (ptrdiff_t)x * pixelBytes();
+        }
+
+        Image Image::crop(int x, int y, int w, int h) const
+        {
+            int x0 = std::max(x, 0);
+            int y0 = std::max(y, 0);
+            int x1 = std::min(x + w, this->w);
+            int y1 = std::min(y + h, this->h);
+            if (empty() || x1 <= x0 || y1 <= y0)
+                return Image();
+
+            Image result = *this;
+            result.data = pixel(x0, y0);
+            result.w = x1 - x0;
+            result.h = y1 - y0;
+            return result;
+        }
+
+        Image Image::flipY() const
+        {
+            if (empty())
+                return Image();
+            Image result = *this;
+            result.data = row(h - 1);
+            result.stride = -stride;
+            return result;
+        }
+
+        Image Image::clone() const
+        {
+            if (empty())
+                return Image();
+            Image result = Create(w, h, chann, pixel_depth);
+            copyTo(result);
+            return result;
+        }
+
+        Image Image::convert(int chann) const
+        {
+            if (empty() || pixel_depth != 8 || chann < 1 || chann > 4)
+                return Image();
+            Image result = Create(w, h, chann, 8);
+            copyTo(result);
+            return result;
+        }
+
+        bool Image::copyTo(const Image &dst) const
+        {
+            if (empty() || dst.empty() || dst.w != w || dst.h != h || dst.pixel_depth != pixel_depth)
+                return false;
+            if (pixel_depth != 8 && dst.chann != chann)
+                return false;
+
+            if (pixel_depth != 8 || dst.chann == chann)
+            {
+                size_t row_bytes = rowBytes();
+                for (int y = 0; y < h; y++)
+                    memmove(dst.row(y), row(y), row_bytes);
+                return true;
+            }
+
+            // PixelFormat takes unsigned strides, flipped views go row by row
+            if (stride > 0 && dst.stride > 0)
+                return PixelFormat::convert(data, chann, (size_t)stride,
+                                            dst.data, dst.chann, (size_t)dst.stride,
+                                            w, h);
+            for (int y = 0; y < h; y++)
+                if (!PixelFormat::convert(row(y), chann, rowBytes(),
+                                          dst.row(y), dst.chann, dst.rowBytes(),
+                                          w, 1))
+                    return false;
+            return true;
+        }
+
+        // 1, 2 and 4 bits PNG rows to one byte per sample. Gray levels are scaled
+        // to 0..255, palette indices are kept as they are (same as readPNG at 8 bits).
+        static Image unpack_png(char *buffer, int w, int h, int pixel_depth, bool palette)
+        {
+            Image result = Image::Create(w, h, 1, 8);
+            if (result.empty())
+            {
+                freeBuffer(buffer);
+                return result;
+            }
+            size_t packed_row_bytes = ((size_t)w * (size_t)pixel_depth + 7) / 8;
+            int max_value = (1 << pixel_depth) - 1;
+            int per_byte = 8 / pixel_depth;
+            for (int y = 0; y < h; y++)
+            {
+                const uint8_t *src = (const uint8_t *)buffer + (size_t)y * packed_row_bytes;
+                uint8_t *dst = result.row(y);
+                for (int x = 0; x < w; x++)
+                {
+                    int shift = 8 - pixel_depth * (x % per_byte + 1);
+                    int v = (src[x / per_byte] >> shift) & max_value;
+                    dst[x] = (uint8_t)(palette ? v : v * 255 / max_value);
+                }
+            }
+            freeBuffer(buffer);
+            return result;
+        }
+
+        Image decode(const Platform::ObjectBuffer &buffer, bool invertY, std::string *errorStr)
+        {
+            return decode(buffer.data, (size_t)buffer.size, invertY, errorStr);
+        }
+
+        Image decode(const uint8_t *data, size_t size, bool invertY, std::string *errorStr)
+        {
+            if (size > 0x7fffffff)
+            {
+                if (errorStr != nullptr)
+                    *errorStr = "Image buffer too big.\n";
+                return Image();
+            }
+
+            int w, h, chann, pixel_depth;
+            char *buffer = nullptr;
+            switch (detectFormat(data, size))
+            {
+            case FileFormat::PNG:
+                buffer = PNG::readPNGFromMemory((const char *)data, (int)size, &w, &h, &chann, &pixel_depth, invertY);
+                if (buffer == nullptr && errorStr != nullptr)
+                    *errorStr = "PNG decode error.\n";
+                break;
+            case FileFormat::JPG:
+                buffer = JPG::readJPGFromMemory((const char *)data, (int)size, &w, &h, &chann, &pixel_depth, invertY);
+                if (buffer == nullptr && errorStr != nullptr)
+                    *errorStr = "JPG decode error.\n";
+                break;
+            default:
+                if (errorStr != nullptr)
+                    *errorStr = "Unknown image format.\n";
+                break;
+            }
+            if (buffer == nullptr)
+                return Image();
+            if (pixel_depth < 8)
+            {
+                // readPNG keeps the file packing, the IHDR color type is at byte 25 (3 = palette)
+                bool palette = data[25] == 3;
+                return unpack_png(buffer, w, h, pixel_depth, palette);
+            }
+            return Image::FromBuffer(buffer, w, h, chann, pixel_depth);
+        }
+
+        Image load(const std::string &filename, bool invertY, std::string *errorStr)
+        {
+            FILE *fp = ITKCommon::FileSystem::File::fopen(filename.c_str(), "rb", errorStr);
+            if (!fp)
+                return Image();
+            bool ok = fseek(fp, 0, SEEK_END) == 0;
+            long size = (ok) ? ftell(fp) : -1;
+            if (size < 0 || size > 0x7fffffff || fseek(fp, 0, SEEK_SET) != 0)
+            {
+                fclose(fp);
+                if (errorStr != nullptr)
+                    *errorStr = ITKCommon::PrintfToStdString("Cannot get the size of %s\n", filename.c_str());
+                return Image();
+            }
+            std::vector<uint8_t> content((size_t)size);
+            ok = fread(content.data(), 1, (size_t)size, fp) == (size_t)size;
+            fclose(fp);
+            if (!ok)
+            {
+                if (errorStr != nullptr)
+                    *errorStr = ITKCommon::PrintfToStdString("Error reading %s\n", filename.c_str());
+                return Image();
+            }
+            return decode(content.data(), content.size(), invertY, errorStr);
+        }
+
+    }
+}
@@ -1,8 +1,9 @@
 #pragma warning(disable : 4996)
 
 #include <InteractiveToolkit-Extension/image/JPG.h>
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+#include <InteractiveToolkit-Extension/image/PixelFormat.h>
 // #include <InteractiveToolkit/InteractiveToolkit.h>
-#include <InteractiveToolkit/ITKCommon/Memory.h>
 #include <InteractiveToolkit/ITKCommon/StringUtil.h>
 #include <jpeglib.h>
 #include <setjmp.h>
@@ -10,6 +11,13 @@
 #include <InteractiveToolkit/ITKCommon/FileSystem/File.h>
 
 #include <stdint.h>
+#include <string.h>
+
+#if JPEG_LIB_VERSION >= 90
+typedef size_t JPEG_MEM_SIZE_T;
+#else
+typedef unsigned long JPEG_MEM_SIZE_T;
+#endif
 
 namespace ITKExtension
 {
@@ -64,10 +72,109 @@ namespace ITKExtension
 				longjmp(myerr->setjmp_buffer, 1);
 			}
 
-			char *readJPG(const char *filename, int *w, int *h, int *chann, int *pixel_depth, bool invertY, float *gamma, std::string *errorStr)
+			/// \private
+			struct ReadState
+			{
+				char *result;
+			};
+
+			// Picks the smallest DCT scale (1/8, 1/4, 1/2 or 1/1) that still gives an
+			// output at or above the target size. A target of 0 ignores that axis.
+			static void select_jpg_scale(struct jpeg_decompress_struct *cinfo, int target_width, int target_height)
+			{
+				if (target_width <= 0 && target_height <= 0)
+					return;
+				static const unsigned int denoms[] = {8, 4, 2};
+				for (unsigned int denom : denoms)
+				{
+					// libjpeg rounds the scaled size up
+					unsigned int scaled_width = (cinfo->image_width + denom - 1) / denom;
+					unsigned int scaled_height = (cinfo->image_height + denom - 1) / denom;
+					if ((target_width <= 0 || scaled_width >= (unsigned int)target_width) &&
+						(target_height <= 0 || scaled_height >= (unsigned int)target_height))
+					{
+						cinfo->scale_num = 1;
+						cinfo->scale_denom = denom;
+						return;
+					}
+				}
+			}
+
+			static char *read_jpg_scanlines(struct jpeg_decompress_struct *cinfo, ReadState *state,
+											int target_width, int target_height,
+											int *w, int *h, int *chann, int *pixel_depth, bool invertY, float *gamma)
 			{
+				JSAMPARRAY rows; /* Pointers to every output row */
+				int row_stride;	 /* physical row width in output buffer */
+
+				/* Step 3: read file parameters with jpeg_read_header() */
+
+				(void)jpeg_read_header(cinfo, TRUE);
+				/* We can ignore the return value from jpeg_read_header since
+				 *   (a) suspension is not possible with the stdio/memory data source, and
+				 *   (b) we passed TRUE to reject a tables-only JPEG file as an error.
+				 * See libjpeg.txt for more info.
+				 */
+
+				/* Step 4: set parameters for decompression */
+
+				/* Scaling is done inside the IDCT, so a reduced output skips most of the work. */
+				select_jpg_scale(cinfo, target_width, target_height);
+
+				/* Step 5: Start decompressor */
+
+				(void)jpeg_start_decompress(cinfo);
+
+				/* After jpeg_start_decompress() we have the correct scaled
+				 * output image dimensions available.
+				 */
+				/* JSAMPLEs per row in output buffer */
+				row_stride = cinfo->output_width * cinfo->output_components;
+
+				state->result = (char *)allocBuffer((size_t)row_stride * cinfo->output_height);
+				char *result = state->result;
+				*w = cinfo->output_width;
+				*h = cinfo->output_height;
+				*chann = cinfo->output_components;
+				*pixel_depth = 8;
+				if (gamma != nullptr)
+					*gamma = (float)cinfo->output_gamma;
+
+				/* Decode straight into the final rows. The row pointer array lives in the
+				 * image pool, so it goes away with the decompressor.
+				 */
+				rows = (JSAMPARRAY)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_IMAGE, sizeof(JSAMPROW) * cinfo->output_height);
+				for (JDIMENSION i = 0; i < cinfo->output_height; i++)
+				{
+					JDIMENSION y = (invertY) ? (cinfo->output_height - 1 - i) : i;
+					rows[i] = (JSAMPROW)&result[(size_t)y * row_stride];
+				}
+
+				/* Step 6: while (scan lines remain to be read) */
+				/*           jpeg_read_scanlines(...); */
+
+				/* Each call returns up to rec_outbuf_height rows, so the whole
+				 * remaining range is requested every time.
+				 */
+				while (cinfo->output_scanline < cinfo->output_height)
+					(void)jpeg_read_scanlines(cinfo, &rows[cinfo->output_scanline], cinfo->output_height - cinfo->output_scanline);
+
+				/* Step 7: Finish decompression */
+
+				(void)jpeg_finish_decompress(cinfo);
 
-				char *result = nullptr;
+				return result;
+			}
+
+			static char *read_jpg(FILE *infile, const char *input_buffer, int input_buffer_size,
+								  int target_width, int target_height,
+								  int *w, int *h, int *chann, int *pixel_depth, bool invertY, float *gamma, std::string *errorStr)
+			{
+				/* The output buffer lives in a struct reachable from cinfo, so its current
+				 * value is still visible after a longjmp from the error handler.
+				 */
+				ReadState state;
+				state.result = nullptr;
 
 				/* This struct contains the JPEG decompression parameters and pointers to
 				 * working space (which is allocated as needed by the JPEG library).
@@ -78,23 +185,6 @@ namespace ITKExtension
 				 * struct, to avoid dangling-pointer problems.
 				 */
 				struct my_error_mgr jerr;
-				/* More stuff */
-				FILE *infile;	   /* source file */
-				JSAMPARRAY buffer; /* Output row buffer */
-				int row_stride;	   /* physical row width in output buffer */
-
-				/* In this example we want to open the input file before doing anything else,
-				 * so that the setjmp() error recovery below can assume the file is open.
-				 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-				 * requires it in order to read binary files.
-				 */
-
-				infile = ITKCommon::FileSystem::File::fopen(filename, "rb", errorStr);
-				if (!infile)
-				{
-					fprintf(stderr, "can't open %s\n", filename);
-					return nullptr;
-				}
 
 				/* Step 1: allocate and initialize JPEG decompression object */
 
@@ -105,14 +195,12 @@ namespace ITKExtension
 				if (setjmp(jerr.setjmp_buffer))
 				{
 					/* If we get here, the JPEG code has signaled an error.
-					 * We need to clean up the JPEG object, close the input file, and return.
+					 * We need to clean up the JPEG object and return.
 					 */
 					jpeg_destroy_decompress(&cinfo);
-					fclose(infile);
 
-					if (result != nullptr)
-						ITKCommon::Memory::free(result);
-					// delete[] result;
+					if (state.result != nullptr)
+						freeBuffer(state.result);
 
 					if (errorStr != nullptr)
 						*errorStr = "JPG Signaled an Error.\n";
@@ -120,100 +208,216 @@ namespace ITKExtension
 				}
 				/* Now we can initialize the JPEG decompression object. */
 				jpeg_create_decompress(&cinfo);
+				cinfo.client_data = &state;
 
 				/* Step 2: specify data source (eg, a file) */
+				if (infile != nullptr)
+					jpeg_stdio_src(&cinfo, infile);
+				else
+					jpeg_mem_src(&cinfo, (unsigned char *)input_buffer, input_buffer_size);
 
-				jpeg_stdio_src(&cinfo, infile);
+				char *result = read_jpg_scanlines(&cinfo, &state, target_width, target_height, w, h, chann, pixel_depth, invertY, gamma);
 
-				/* Step 3: read file parameters with jpeg_read_header() */
+				/* Step 8: Release JPEG decompression object */
 
-				(void)jpeg_read_header(&cinfo, TRUE);
-				/* We can ignore the return value from jpeg_read_header since
-				 *   (a) suspension is not possible with the stdio data source, and
-				 *   (b) we passed TRUE to reject a tables-only JPEG file as an error.
-				 * See libjpeg.txt for more info.
+				/* This is an important step since it will release a good deal of memory. */
+				jpeg_destroy_decompress(&cinfo);
+
+				/* At this point you may want to check to see whether any corrupt-data
+				 * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
 				 */
 
-				/* Step 4: set parameters for decompression */
+				return result;
+			}
 
-				/* In this example, we don't need to change any of the defaults set by
-				 * jpeg_read_header(), so we do nothing here.
+			char *readJPG(const char *filename, int *w, int *h, int *chann, int *pixel_depth, bool invertY, float *gamma, std::string *errorStr)
+			{
+				return readJPGScaled(filename, 0, 0, w, h, chann, pixel_depth, invertY, gamma, errorStr);
+			}
+
+			char *readJPGScaled(const char *filename, int target_width, int target_height, int *w, int *h, int *chann, int *pixel_depth, bool invertY, float *gamma, std::string *errorStr)
+			{
+				/* VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
+				 * requires it in order to read binary files.
 				 */
+				FILE *infile = ITKCommon::FileSystem::File::fopen(filename, "rb", errorStr);
+				if (!infile)
+				{
+					fprintf(stderr, "can't open %s\n", filename);
+					return nullptr;
+				}
 
-				/* Step 5: Start decompressor */
+				char *result = read_jpg(infile, nullptr, 0, target_width, target_height, w, h, chann, pixel_depth, invertY, gamma, errorStr);
 
-				(void)jpeg_start_decompress(&cinfo);
-				/* We can ignore the return value since suspension is not possible
-				 * with the stdio data source.
-				 */
+				/* After finish_decompress, we can close the input file. */
+				fclose(infile);
 
-				/* We may need to do some setup of our own at this point before reading
-				 * the data.  After jpeg_start_decompress() we have the correct scaled
-				 * output image dimensions available, as well as the output colormap
-				 * if we asked for color quantization.
-				 * In this example, we need to make an output work buffer of the right size.
-				 */
-				/* JSAMPLEs per row in output buffer */
-				row_stride = cinfo.output_width * cinfo.output_components;
-				/* Make a one-row-high sample array that will go away when done with image */
-				buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, row_stride, 1);
-
-				// result = new char[cinfo.output_width * cinfo.output_height * cinfo.output_components];
-				result = (char *)ITKCommon::Memory::malloc(cinfo.output_width * cinfo.output_height * cinfo.output_components);
-				*w = cinfo.output_width;
-				*h = cinfo.output_height;
-				*chann = cinfo.output_components;
-				*pixel_depth = 8;
-				if (gamma != nullptr)
-					*gamma = (float)cinfo.output_gamma;
+				return result;
+			}
 
-				/* Step 6: while (scan lines remain to be read) */
-				/*           jpeg_read_scanlines(...); */
+			static bool read_jpg_stream_scanlines(struct jpeg_decompress_struct *cinfo,
+												  const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+			{
+				(void)jpeg_read_header(cinfo, TRUE);
+				(void)jpeg_start_decompress(cinfo);
 
-				/* Here we use the library's state variable cinfo.output_scanline as the
-				 * loop counter, so that we don't have to keep track ourselves.
-				 */
-				while (cinfo.output_scanline < cinfo.output_height)
+				size_t row_stride = (size_t)cinfo->output_width * cinfo->output_components;
+
+				if (onHeader != nullptr && !onHeader((int)cinfo->output_width, (int)cinfo->output_height, cinfo->output_components, 8))
 				{
-					/* jpeg_read_scanlines expects an array of pointers to scanlines.
-					 * Here the array is only one element long, but you could ask for
-					 * more than one scanline at a time if that's more convenient.
-					 */
-					(void)jpeg_read_scanlines(&cinfo, buffer, 1);
-					/* Assume put_scanline_someplace wants a pointer and sample count. */
-					// put_scanline_someplace(buffer[0], row_stride);
-					if (invertY)
-						memcpy(&result[(cinfo.output_height - 1 - (cinfo.output_scanline - 1)) * row_stride], buffer[0], row_stride);
-					else
-						memcpy(&result[(cinfo.output_scanline - 1) * row_stride], buffer[0], row_stride);
+					if (errorStr != nullptr)
+						*errorStr = "JPG decode stopped by the header callback\n";
+					return false;
 				}
 
-				/* Step 7: Finish decompression */
+				/* libjpeg returns up to rec_outbuf_height rows per call */
+				if (band_rows < cinfo->rec_outbuf_height)
+					band_rows = cinfo->rec_outbuf_height;
+				if ((JDIMENSION)band_rows > cinfo->output_height)
+					band_rows = (int)cinfo->output_height;
 
-				(void)jpeg_finish_decompress(&cinfo);
-				/* We can ignore the return value since suspension is not possible
-				 * with the stdio data source.
-				 */
+				/* One contiguous band, released with the decompressor */
+				JSAMPLE *band = (JSAMPLE *)(*cinfo->mem->alloc_large)((j_common_ptr)cinfo, JPOOL_IMAGE, row_stride * band_rows);
+				JSAMPARRAY rows = (JSAMPARRAY)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_IMAGE, sizeof(JSAMPROW) * band_rows);
+				for (int i = 0; i < band_rows; i++)
+					rows[i] = &band[i * row_stride];
 
-				/* Step 8: Release JPEG decompression object */
+				while (cinfo->output_scanline < cinfo->output_height)
+				{
+					JDIMENSION first_row = cinfo->output_scanline;
+					JDIMENSION count = 0;
+					while (count < (JDIMENSION)band_rows && cinfo->output_scanline < cinfo->output_height)
+						count += jpeg_read_scanlines(cinfo, &rows[count], (JDIMENSION)band_rows - count);
+					if (!onRows((const char *)band, (int)first_row, (int)count, row_stride))
+					{
+						if (errorStr != nullptr)
+							*errorStr = "JPG decode stopped by the row callback\n";
+						return false;
+					}
+				}
 
-				/* This is an important step since it will release a good deal of memory. */
+				(void)jpeg_finish_decompress(cinfo);
+				return true;
+			}
+
+			static bool read_jpg_stream(FILE *infile, const char *input_buffer, int input_buffer_size,
+										const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+			{
+				struct jpeg_decompress_struct cinfo;
+				struct my_error_mgr jerr;
+
+				cinfo.err = jpeg_std_error(&jerr.pub);
+				jerr.pub.error_exit = my_error_exit;
+				if (setjmp(jerr.setjmp_buffer))
+				{
+					/* every buffer lives in the libjpeg pools */
+					jpeg_destroy_decompress(&cinfo);
+					if (errorStr != nullptr)
+						*errorStr = "JPG Signaled an Error.\n";
+					return false;
+				}
+				jpeg_create_decompress(&cinfo);
+
+				if (infile != nullptr)
+					jpeg_stdio_src(&cinfo, infile);
+				else
+					jpeg_mem_src(&cinfo, (unsigned char *)input_buffer, input_buffer_size);
+
+				bool result = read_jpg_stream_scanlines(&cinfo, onHeader, onRows, band_rows, errorStr);
+
+				/* also aborts a decode stopped by a callback */
 				jpeg_destroy_decompress(&cinfo);
 
-				/* After finish_decompress, we can close the input file.
-				 * Here we postpone it until after no more JPEG errors are possible,
-				 * so as to simplify the setjmp error logic above.  (Actually, I don't
-				 * think that jpeg_destroy can do an error exit, but why assume anything...)
-				 */
+				return result;
+			}
+
+			bool readJPGRows(const char *filename, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+			{
+				FILE *infile = ITKCommon::FileSystem::File::fopen(filename, "rb", errorStr);
+				if (!infile)
+					return false;
+				bool result = read_jpg_stream(infile, nullptr, 0, onHeader, onRows, band_rows, errorStr);
 				fclose(infile);
+				return result;
+			}
 
-				/* At this point you may want to check to see whether any corrupt-data
-				 * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
-				 */
+			bool readJPGRowsFromMemory(const char *input_buffer, int input_buffer_size, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+			{
+				return read_jpg_stream(nullptr, input_buffer, input_buffer_size, onHeader, onRows, band_rows, errorStr);
+			}
 
-				/* And we're done! */
+			// Hands every row to libjpeg at once, with invertY resolved in the row pointer array.
+			// JPEG has no alpha: gray+alpha is written as gray and RGBA as RGB.
+			// libjpeg-turbo reads RGBA rows itself (JCS_EXT_RGBA), its SIMD color
+			// conversion skips the alpha, so the rows need no packing.
+			static bool jpg_color_space(int chann, J_COLOR_SPACE *color_space, int *components)
+			{
+				if (chann == 1 || chann == 2)
+				{
+					*color_space = JCS_GRAYSCALE;
+					*components = 1;
+					return true;
+				}
+#ifdef JCS_EXTENSIONS
+				if (chann == 4)
+				{
+					*color_space = JCS_EXT_RGBA;
+					*components = 4;
+					return true;
+				}
+#endif
+				if (chann == 3 || chann == 4)
+				{
+					*color_space = JCS_RGB;
+					*components = 3;
+					return true;
+				}
+				return false;
+			}
 
-				return result;
+			// Inputs with alpha are packed band by band into a buffer from the image pool.
+			static void write_jpg_scanlines(struct jpeg_compress_struct *cinfo, const char *buffer, int h, int chann, bool invertY)
+			{
+				size_t row_stride = (size_t)cinfo->image_width * chann;
+				if (chann == cinfo->input_components)
+				{
+					JSAMPARRAY rows = (JSAMPARRAY)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_IMAGE, sizeof(JSAMPROW) * h);
+					for (int i = 0; i < h; i++)
+					{
+						int y = (invertY) ? (h - 1 - i) : i;
+						rows[i] = (JSAMPROW)&buffer[(size_t)y * row_stride];
+					}
+					while (cinfo->next_scanline < cinfo->image_height)
+						(void)jpeg_write_scanlines(cinfo, &rows[cinfo->next_scanline], cinfo->image_height - cinfo->next_scanline);
+					return;
+				}
+
+				const int band_rows = 16;
+				size_t band_stride = (size_t)cinfo->image_width * cinfo->input_components;
+				JSAMPLE *band = (JSAMPLE *)(*cinfo->mem->alloc_large)((j_common_ptr)cinfo, JPOOL_IMAGE, band_stride * band_rows);
+				JSAMPARRAY rows = (JSAMPARRAY)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_IMAGE, sizeof(JSAMPROW) * band_rows);
+				for (int i = 0; i < band_rows; i++)
+					rows[i] = &band[i * band_stride];
+
+				while (cinfo->next_scanline < cinfo->image_height)
+				{
+					JDIMENSION first_row = cinfo->next_scanline;
+					JDIMENSION count = cinfo->image_height - first_row;
+					if (count > (JDIMENSION)band_rows)
+						count = (JDIMENSION)band_rows;
+					for (JDIMENSION i = 0; i < count; i++)
+					{
+						int y = (int)(first_row + i);
+						if (invertY)
+							y = h - 1 - y;
+						PixelFormat::convert((const uint8_t *)&buffer[(size_t)y * row_stride], chann, row_stride,
+											 rows[i], cinfo->input_components, band_stride,
+											 (int)cinfo->image_width, 1);
+					}
+					JDIMENSION written = 0;
+					while (written < count)
+						written += jpeg_write_scanlines(cinfo, &rows[written], count - written);
+				}
 			}
 
 			bool writeJPG(const char *file_name, int w, int h, int chann, char *buffer, int quality, bool invertY, std::string *errorStr)
@@ -236,8 +440,6 @@ namespace ITKExtension
 				struct jpeg_error_mgr jerr;
 				/* More stuff */
 				FILE *outfile;			 /* target file */
-				JSAMPROW row_pointer[1]; /* pointer to JSAMPLE row[s] */
-				int row_stride;			 /* physical row width in image buffer */
 
 				/* Step 1: allocate and initialize JPEG compression object */
 
@@ -273,16 +475,14 @@ namespace ITKExtension
 				 */
 				cinfo.image_width = w; /* image width and height, in pixels */
 				cinfo.image_height = h;
-				cinfo.input_components = chann; /* # of color components per pixel */
-				if (chann == 3)
-					cinfo.in_color_space = JCS_RGB; /* colorspace of input image */
-				else if (chann == 1)
-					cinfo.in_color_space = JCS_GRAYSCALE;
-				else
+				/* # of color components per pixel and colorspace of input image */
+				if (!jpg_color_space(chann, &cinfo.in_color_space, &cinfo.input_components))
 				{
 					if (errorStr != nullptr)
 						*errorStr = ITKCommon::PrintfToStdString("JPEG invalid number of channels: %i\n", chann);
 					fprintf(stderr, "JPEG invalid number of channels: %i\n", chann);
+					jpeg_destroy_compress(&cinfo);
+					fclose(outfile);
 					return false;
 				}
 				/* Now use the library's routine to set default compression parameters.
@@ -305,25 +505,7 @@ namespace ITKExtension
 				/* Step 5: while (scan lines remain to be written) */
 				/*           jpeg_write_scanlines(...); */
 
-				/* Here we use the library's state variable cinfo.next_scanline as the
-				 * loop counter, so that we don't have to keep track ourselves.
-				 * To keep things simple, we pass one scanline per call; you can pass
-				 * more if you wish, though.
-				 */
-				row_stride = w * chann; /* JSAMPLEs per row in image_buffer */
-
-				while (cinfo.next_scanline < cinfo.image_height)
-				{
-					/* jpeg_write_scanlines expects an array of pointers to scanlines.
-					 * Here the array is only one element long, but you could pass
-					 * more than one scanline at a time if that's more convenient.
-					 */
-					if (invertY)
-						row_pointer[0] = (JSAMPROW)&buffer[(h - 1 - cinfo.next_scanline) * row_stride];
-					else
-						row_pointer[0] = (JSAMPROW)&buffer[cinfo.next_scanline * row_stride];
-					(void)jpeg_write_scanlines(&cinfo, row_pointer, 1);
-				}
+				write_jpg_scanlines(&cinfo, buffer, h, chann, invertY);
 
 				/* Step 6: Finish compression */
 
@@ -342,151 +524,15 @@ namespace ITKExtension
 
 			char *readJPGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth, bool invertY, float *gamma)
 			{
+				return read_jpg(nullptr, input_buffer, input_buffer_size, 0, 0, w, h, chann, pixel_depth, invertY, gamma, nullptr);
+			}
 
-				char *result = nullptr;
-
-				/* This struct contains the JPEG decompression parameters and pointers to
-				 * working space (which is allocated as needed by the JPEG library).
-				 */
-				struct jpeg_decompress_struct cinfo;
-				/* We use our private extension JPEG error handler.
-				 * Note that this struct must live as long as the main JPEG parameter
-				 * struct, to avoid dangling-pointer problems.
-				 */
-				struct my_error_mgr jerr;
-				/* More stuff */
-				JSAMPARRAY buffer; /* Output row buffer */
-				int row_stride;	   /* physical row width in output buffer */
-
-				/* In this example we want to open the input file before doing anything else,
-				 * so that the setjmp() error recovery below can assume the file is open.
-				 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-				 * requires it in order to read binary files.
-				 */
-
-				// if ((infile = fopen(filename, "rb")) == nullptr) {
-				// fprintf(stderr, "can't open %s\n", filename);
-				// return 0;
-				//}
-
-				/* Step 1: allocate and initialize JPEG decompression object */
-
-				/* We set up the normal JPEG error routines, then override error_exit. */
-				cinfo.err = jpeg_std_error(&jerr.pub);
-				jerr.pub.error_exit = my_error_exit;
-				/* Establish the setjmp return context for my_error_exit to use. */
-				if (setjmp(jerr.setjmp_buffer))
-				{
-					/* If we get here, the JPEG code has signaled an error.
-					 * We need to clean up the JPEG object, close the input file, and return.
-					 */
-					jpeg_destroy_decompress(&cinfo);
-					// fclose(infile);
-
-					if (result != nullptr)
-						ITKCommon::Memory::free(result);
-					// delete[] result;
-
-					return nullptr;
-				}
-				/* Now we can initialize the JPEG decompression object. */
-				jpeg_create_decompress(&cinfo);
-
-				/* Step 2: specify data source (eg, a file) */
-				jpeg_mem_src(&cinfo, (unsigned char *)input_buffer, input_buffer_size);
-
-				/* Step 3: read file parameters with jpeg_read_header() */
-
-				(void)jpeg_read_header(&cinfo, TRUE);
-				/* We can ignore the return value from jpeg_read_header since
-				 *   (a) suspension is not possible with the stdio data source, and
-				 *   (b) we passed TRUE to reject a tables-only JPEG file as an error.
-				 * See libjpeg.txt for more info.
-				 */
-
-				/* Step 4: set parameters for decompression */
-
-				/* In this example, we don't need to change any of the defaults set by
-				 * jpeg_read_header(), so we do nothing here.
-				 */
-
-				/* Step 5: Start decompressor */
-
-				(void)jpeg_start_decompress(&cinfo);
-				/* We can ignore the return value since suspension is not possible
-				 * with the stdio data source.
-				 */
-
-				/* We may need to do some setup of our own at this point before reading
-				 * the data.  After jpeg_start_decompress() we have the correct scaled
-				 * output image dimensions available, as well as the output colormap
-				 * if we asked for color quantization.
-				 * In this example, we need to make an output work buffer of the right size.
-				 */
-				/* JSAMPLEs per row in output buffer */
-				row_stride = cinfo.output_width * cinfo.output_components;
-				/* Make a one-row-high sample array that will go away when done with image */
-				buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, row_stride, 1);
-
-				// result = new char[cinfo.output_width * cinfo.output_height * cinfo.output_components];
-				result = (char *)ITKCommon::Memory::malloc(cinfo.output_width * cinfo.output_height * cinfo.output_components);
-				*w = cinfo.output_width;
-				*h = cinfo.output_height;
-				*chann = cinfo.output_components;
-				*pixel_depth = 8;
-				if (gamma != nullptr)
-					*gamma = (float)cinfo.output_gamma;
-
-				/* Step 6: while (scan lines remain to be read) */
-				/*           jpeg_read_scanlines(...); */
-
-				/* Here we use the library's state variable cinfo.output_scanline as the
-				 * loop counter, so that we don't have to keep track ourselves.
-				 */
-				while (cinfo.output_scanline < cinfo.output_height)
-				{
-					/* jpeg_read_scanlines expects an array of pointers to scanlines.
-					 * Here the array is only one element long, but you could ask for
-					 * more than one scanline at a time if that's more convenient.
-					 */
-					(void)jpeg_read_scanlines(&cinfo, buffer, 1);
-					/* Assume put_scanline_someplace wants a pointer and sample count. */
-					// put_scanline_someplace(buffer[0], row_stride);
-					if (invertY)
-						memcpy(&result[(cinfo.output_height - 1 - (cinfo.output_scanline - 1)) * row_stride], buffer[0], row_stride);
-					else
-						memcpy(&result[(cinfo.output_scanline - 1) * row_stride], buffer[0], row_stride);
-				}
-
-				/* Step 7: Finish decompression */
-
-				(void)jpeg_finish_decompress(&cinfo);
-				/* We can ignore the return value since suspension is not possible
-				 * with the stdio data source.
-				 */
-
-				/* Step 8: Release JPEG decompression object */
-
-				/* This is an important step since it will release a good deal of memory. */
-				jpeg_destroy_decompress(&cinfo);
-
-				/* After finish_decompress, we can close the input file.
-				 * Here we postpone it until after no more JPEG errors are possible,
-				 * so as to simplify the setjmp error logic above.  (Actually, I don't
-				 * think that jpeg_destroy can do an error exit, but why assume anything...)
-				 */
-				// fclose(infile);
-
-				/* At this point you may want to check to see whether any corrupt-data
-				 * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
-				 */
-
-				/* And we're done! */
-
-				return result;
+			char *readJPGFromMemoryScaled(const char *input_buffer, int input_buffer_size, int target_width, int target_height, int *w, int *h, int *chann, int *pixel_depth, bool invertY, float *gamma)
+			{
+				return read_jpg(nullptr, input_buffer, input_buffer_size, target_width, target_height, w, h, chann, pixel_depth, invertY, gamma, nullptr);
 			}
 
-			char *writeJPGToMemory(int *output_size, int w, int h, int chann, char *buffer, int quality, bool invertY)
+			char *writeJPGToMemory(int *output_size, int w, int h, int chann, char *buffer, int quality, bool invertY, std::string *errorStr)
 			{
 				/* This struct contains the JPEG compression parameters and pointers to
 				 * working space (which is allocated as needed by the JPEG library).
@@ -506,8 +552,6 @@ namespace ITKExtension
 				struct jpeg_error_mgr jerr;
 				/* More stuff */
 				// FILE *outfile;           /* target file */
-				JSAMPROW row_pointer[1]; /* pointer to JSAMPLE row[s] */
-				int row_stride;			 /* physical row width in image buffer */
 
 				/* Step 1: allocate and initialize JPEG compression object */
 
@@ -559,15 +603,13 @@ namespace ITKExtension
 				 */
 				cinfo.image_width = w; /* image width and height, in pixels */
 				cinfo.image_height = h;
-				cinfo.input_components = chann; /* # of color components per pixel */
-				if (chann == 3)
-					cinfo.in_color_space = JCS_RGB; /* colorspace of input image */
-				else if (chann == 1)
-					cinfo.in_color_space = JCS_GRAYSCALE;
-				else
+				/* # of color components per pixel and colorspace of input image */
+				if (!jpg_color_space(chann, &cinfo.in_color_space, &cinfo.input_components))
 				{
-					fprintf(stderr, "JPEG invalid number of channels: %i\n", chann);
-					exit(1);
+					if (errorStr != nullptr)
+						*errorStr = ITKCommon::PrintfToStdString("JPEG invalid number of channels: %i\n", chann);
+					jpeg_destroy_compress(&cinfo);
+					return nullptr;
 				}
 				/* Now use the library's routine to set default compression parameters.
 				 * (You must set at least cinfo.in_color_space before calling this,
@@ -589,25 +631,7 @@ namespace ITKExtension
 				/* Step 5: while (scan lines remain to be written) */
 				/*           jpeg_write_scanlines(...); */
 
-				/* Here we use the library's state variable cinfo.next_scanline as the
-				 * loop counter, so that we don't have to keep track ourselves.
-				 * To keep things simple, we pass one scanline per call; you can pass
-				 * more if you wish, though.
-				 */
-				row_stride = w * chann; /* JSAMPLEs per row in image_buffer */
-
-				while (cinfo.next_scanline < cinfo.image_height)
-				{
-					/* jpeg_write_scanlines expects an array of pointers to scanlines.
-					 * Here the array is only one element long, but you could pass
-					 * more than one scanline at a time if that's more convenient.
-					 */
-					if (invertY)
-						row_pointer[0] = (JSAMPROW)&buffer[(h - 1 - cinfo.next_scanline) * row_stride];
-					else
-						row_pointer[0] = (JSAMPROW)&buffer[cinfo.next_scanline * row_stride];
-					(void)jpeg_write_scanlines(&cinfo, row_pointer, 1);
-				}
+				write_jpg_scanlines(&cinfo, buffer, h, chann, invertY);
 
 				/* Step 6: Finish compression */
 
@@ -615,7 +639,7 @@ namespace ITKExtension
 				/* After finish_compress, we can close the output file. */
 				// fclose(outfile);
 
-				char *result_final_buffer = (char *)ITKCommon::Memory::malloc(result_size);
+				char *result_final_buffer = (char *)allocBuffer(result_size);
 				memcpy(result_final_buffer, result_ptr, result_size);
 				*output_size = (int)result_size;
 
@@ -630,11 +654,247 @@ namespace ITKExtension
 				return result_final_buffer;
 			}
 
+			static bool write_jpg_stream_scanlines(struct jpeg_compress_struct *cinfo, int w, int h, int chann,
+												   const RowSourceCallback &getRows, int band_rows, int quality, std::string *errorStr)
+			{
+				cinfo->image_width = w;
+				cinfo->image_height = h;
+				jpg_color_space(chann, &cinfo->in_color_space, &cinfo->input_components);
+				jpeg_set_defaults(cinfo);
+				jpeg_set_quality(cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+				jpeg_start_compress(cinfo, TRUE);
+
+				size_t row_stride = (size_t)w * chann;
+				size_t jpg_row_stride = (size_t)w * cinfo->input_components;
+
+				/* One contiguous band, released with the compressor */
+				JSAMPLE *band = (JSAMPLE *)(*cinfo->mem->alloc_large)((j_common_ptr)cinfo, JPOOL_IMAGE, row_stride * band_rows);
+				JSAMPARRAY rows = (JSAMPARRAY)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_IMAGE, sizeof(JSAMPROW) * band_rows);
+				for (int i = 0; i < band_rows; i++)
+					rows[i] = &band[i * jpg_row_stride];
+
+				while (cinfo->next_scanline < cinfo->image_height)
+				{
+					JDIMENSION first_row = cinfo->next_scanline;
+					JDIMENSION count = cinfo->image_height - first_row;
+					if (count > (JDIMENSION)band_rows)
+						count = (JDIMENSION)band_rows;
+					if (!getRows((char *)band, (int)first_row, (int)count, row_stride))
+					{
+						if (errorStr != nullptr)
+							*errorStr = "JPG encode stopped by the row source callback\n";
+						return false;
+					}
+					/* drop the alpha in place, the packed rows are never longer than the source rows */
+					if (jpg_row_stride != row_stride)
+						PixelFormat::convert(band, chann, row_stride, band, cinfo->input_components, jpg_row_stride, w, (int)count);
+					JDIMENSION written = 0;
+					while (written < count)
+						written += jpeg_write_scanlines(cinfo, &rows[written], count - written);
+				}
+
+				jpeg_finish_compress(cinfo);
+				return true;
+			}
+
+			// Writes to outfile when it is set, otherwise to the jpeg_mem_dest buffer.
+			static bool write_jpg_stream(FILE *outfile, unsigned char **mem_output, JPEG_MEM_SIZE_T *mem_output_size,
+										 int w, int h, int chann, const RowSourceCallback &getRows, int band_rows, int quality, std::string *errorStr)
+			{
+				if (w <= 0 || h <= 0 || chann < 1 || chann > 4)
+				{
+					if (errorStr != nullptr)
+						*errorStr = ITKCommon::PrintfToStdString("JPEG invalid image w = %i, h = %i, chann = %i\n", w, h, chann);
+					return false;
+				}
+				if (band_rows <= 0)
+					band_rows = 1;
+				if (band_rows > h)
+					band_rows = h;
+
+				struct jpeg_compress_struct cinfo;
+				struct my_error_mgr jerr;
+
+				cinfo.err = jpeg_std_error(&jerr.pub);
+				jerr.pub.error_exit = my_error_exit;
+				if (setjmp(jerr.setjmp_buffer))
+				{
+					jpeg_destroy_compress(&cinfo);
+					if (errorStr != nullptr)
+						*errorStr = "JPG Signaled an Error.\n";
+					return false;
+				}
+				jpeg_create_compress(&cinfo);
+
+				if (outfile != nullptr)
+					jpeg_stdio_dest(&cinfo, outfile);
+				else
+					jpeg_mem_dest(&cinfo, mem_output, mem_output_size);
+
+				bool result = write_jpg_stream_scanlines(&cinfo, w, h, chann, getRows, band_rows, quality, errorStr);
+
+				/* also aborts an encode stopped by the callback */
+				jpeg_destroy_compress(&cinfo);
+
+				return result;
+			}
+
+			bool writeJPGRows(const char *file_name, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows, int quality, std::string *errorStr)
+			{
+				FILE *outfile = ITKCommon::FileSystem::File::fopen(file_name, "wb", errorStr);
+				if (!outfile)
+					return false;
+				bool result = write_jpg_stream(outfile, nullptr, nullptr, w, h, chann, getRows, band_rows, quality, errorStr);
+				fclose(outfile);
+				return result;
+			}
+
+			char *writeJPGRowsToMemory(int *output_size, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows, int quality)
+			{
+				unsigned char *result_ptr = nullptr;
+				JPEG_MEM_SIZE_T result_size = 0;
+
+				*output_size = 0;
+				bool result = write_jpg_stream(nullptr, &result_ptr, &result_size, w, h, chann, getRows, band_rows, quality, nullptr);
+
+				char *result_final_buffer = nullptr;
+				if (result)
+				{
+					result_final_buffer = (char *)allocBuffer(result_size);
+					memcpy(result_final_buffer, result_ptr, result_size);
+					*output_size = (int)result_size;
+				}
+				/* jpeg_mem_dest buffer is allocated with malloc */
+				if (result_ptr != nullptr)
+					free(result_ptr);
+
+				return result_final_buffer;
+			}
+
+			/// \private
+			struct ProbeInput
+			{
+				FILE *fp;
+				const uint8_t *buffer;
+				size_t size;
+				size_t readed;
+
+				bool read(uint8_t *out, size_t count)
+				{
+					if (fp != nullptr)
+						return fread(out, 1, count, fp) == count;
+					if (size - readed < count)
+						return false;
+					memcpy(out, buffer + readed, count);
+					readed += count;
+					return true;
+				}
+
+				bool skip(size_t count)
+				{
+					if (fp != nullptr)
+						return fseek(fp, (long)count, SEEK_CUR) == 0;
+					if (size - readed < count)
+						return false;
+					readed += count;
+					return true;
+				}
+			};
+
+			// Walks the marker segments from SOI up to the first SOFn marker.
+			// Only the segment headers are read, the entropy coded data is never touched.
+			static bool probe_jpg_header(ProbeInput *input, int *w, int *h, int *chann, int *pixel_depth)
+			{
+				uint8_t marker[2];
+				if (!input->read(marker, 2) || marker[0] != 0xFF || marker[1] != 0xD8)
+					return false;
+
+				while (true)
+				{
+					// markers may be preceded by any number of 0xFF fill bytes
+					uint8_t code = 0xFF;
+					if (!input->read(&code, 1) || code != 0xFF)
+						return false;
+					while (code == 0xFF)
+					{
+						if (!input->read(&code, 1))
+							return false;
+					}
+
+					// standalone markers without a length field
+					if (code == 0x01 || (code >= 0xD0 && code <= 0xD7))
+						continue;
+					// EOI or SOS before any frame header
+					if (code == 0xD9 || code == 0xDA)
+						return false;
+
+					uint8_t length_bytes[2];
+					if (!input->read(length_bytes, 2))
+						return false;
+					size_t length = ((size_t)length_bytes[0] << 8) | (size_t)length_bytes[1];
+					if (length < 2)
+						return false;
+
+					// SOF0..SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+					if (code >= 0xC0 && code <= 0xCF && code != 0xC4 && code != 0xC8 && code != 0xCC)
+					{
+						// precision (1), height (2), width (2), components (1)
+						uint8_t sof[6];
+						if (length < 2 + 6 || !input->read(sof, 6))
+							return false;
+						int height = ((int)sof[1] << 8) | (int)sof[2];
+						int width = ((int)sof[3] << 8) | (int)sof[4];
+						// height 0 means it is defined later by a DNL marker
+						if (width == 0 || height == 0 || sof[5] == 0)
+							return false;
+						*w = width;
+						*h = height;
+						*chann = sof[5];
+						*pixel_depth = 8;
+						return true;
+					}
+
+					if (!input->skip(length - 2))
+						return false;
+				}
+			}
+
+			bool probeJPG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, std::string *errorStr)
+			{
+				FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "rb", errorStr);
+				if (!fp)
+					return false;
+
+				ProbeInput input;
+				input.fp = fp;
+				input.buffer = nullptr;
+				input.size = 0;
+				input.readed = 0;
+				bool result = probe_jpg_header(&input, w, h, chann, pixel_depth);
+				fclose(fp);
+
+				if (!result && errorStr != nullptr)
+					*errorStr = ITKCommon::PrintfToStdString("Invalid JPEG header: %s\n", file_name);
+				return result;
+			}
+
+			bool probeJPGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth)
+			{
+				if (input_buffer == nullptr || input_buffer_size <= 0)
+					return false;
+				ProbeInput input;
+				input.fp = nullptr;
+				input.buffer = (const uint8_t *)input_buffer;
+				input.size = (size_t)input_buffer_size;
+				input.readed = 0;
+				return probe_jpg_header(&input, w, h, chann, pixel_depth);
+			}
+
 			void closeJPG(char *&buff)
 			{
 				if (!buff)
 					return;
-				ITKCommon::Memory::free(buff);
+				freeBuffer(buff);
 				// delete[]buff;
 				buff = nullptr;
 			}
@@ -1,13 +1,20 @@
 
 #include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+#include "PNGInternal.h"
 // #include <InteractiveToolkit/InteractiveToolkit.h>
-#include <InteractiveToolkit/ITKCommon/Memory.h>
 #include <InteractiveToolkit/ITKCommon/StringUtil.h>
 
 #include <png.h>
+#include <zlib.h>
 
 #include <InteractiveToolkit/ITKCommon/FileSystem/File.h>
 
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
 //----------------------------------------------------------------------------------
 /* The png_jmpbuf() macro, used in error handling, became available in
  * libpng version 1.0.6.  If you want to be able to run your code with older
@@ -67,21 +74,175 @@ namespace ITKExtension
                 fflush((FILE *)png_get_io_ptr(png_ptr));
             }
             //----------------------------------------------------------------------------------
-            bool writePNG(const char *file_name, int w, int h, int chann, char *buffer, bool invertY, std::string *errorStr)
+            EncodeOptions::EncodeOptions()
+            {
+                compression_level = -1;
+                strategy = EncodeStrategy::LibraryDefault;
+                filter = EncodeFilter::Adaptive;
+                palette = PaletteMode::Off;
+            }
+
+            EncodeOptions EncodeOptions::Default()
+            {
+                return EncodeOptions();
+            }
+
+            EncodeOptions EncodeOptions::Fast()
+            {
+                EncodeOptions result;
+                result.compression_level = 1;
+                result.strategy = EncodeStrategy::Default;
+                result.filter = EncodeFilter::Up;
+                return result;
+            }
+
+            EncodeOptions EncodeOptions::Smallest()
+            {
+                EncodeOptions result;
+                result.compression_level = 9;
+                result.palette = PaletteMode::Auto;
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            static void apply_encode_options(png_structp png_ptr, const EncodeOptions &options)
+            {
+                if (options.compression_level >= 0)
+                    png_set_compression_level(png_ptr, options.compression_level > 9 ? 9 : options.compression_level);
+
+                switch (options.strategy)
+                {
+                case EncodeStrategy::Default:
+                    png_set_compression_strategy(png_ptr, Z_DEFAULT_STRATEGY);
+                    break;
+                case EncodeStrategy::Filtered:
+                    png_set_compression_strategy(png_ptr, Z_FILTERED);
+                    break;
+                case EncodeStrategy::HuffmanOnly:
+                    png_set_compression_strategy(png_ptr, Z_HUFFMAN_ONLY);
+                    break;
+                case EncodeStrategy::RLE:
+                    png_set_compression_strategy(png_ptr, Z_RLE);
+                    break;
+                case EncodeStrategy::Fixed:
+                    png_set_compression_strategy(png_ptr, Z_FIXED);
+                    break;
+                default:
+                    break;
+                }
+
+                switch (options.filter)
+                {
+                case EncodeFilter::None:
+                    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+                    break;
+                case EncodeFilter::Sub:
+                    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+                    break;
+                case EncodeFilter::Up:
+                    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_UP);
+                    break;
+                case EncodeFilter::Average:
+                    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_AVG);
+                    break;
+                case EncodeFilter::Paeth:
+                    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_PAETH);
+                    break;
+                default:
+                    break;
+                }
+            }
+            //----------------------------------------------------------------------------------
+            /// \private
+            ///
+            /// Rows come from the whole image in buffer, or are pulled band by band
+            /// from getRows into band (band_rows rows) when buffer is nullptr.
+            struct WriteRowSource
+            {
+                const char *buffer;
+                bool invertY;
+
+                const RowSourceCallback *getRows;
+                char *band;
+                int band_rows;
+            };
+
+            /// \private
+            ///
+            /// Sample layout of the rows given to write_png.
+            /// With a palette the rows have 1 index per byte and bit_depth is the file index size.
+            struct WriteFormat
+            {
+                int bit_depth; // 8 or 16, 1/2/4/8 for palette images
+                const uint8_t *palette_rgba;
+                int palette_size;
+            };
+
+            static const WriteFormat WRITE_FORMAT_8 = {8, nullptr, 0};
+            static const WriteFormat WRITE_FORMAT_16 = {16, nullptr, 0};
+
+            static int palette_bit_depth(int palette_size)
+            {
+                if (palette_size <= 2)
+                    return 1;
+                if (palette_size <= 4)
+                    return 2;
+                if (palette_size <= 16)
+                    return 4;
+                return 8;
+            }
+
+            /// \private
+            ///
+            /// libpng internal memory (row buffers, zlib state) goes through the
+            /// allocator current when the png struct is created.
+            ///
+            static png_voidp png_malloc_allocator(png_structp png_ptr, png_alloc_size_t size)
+            {
+                Allocator *allocator = (Allocator *)png_get_mem_ptr(png_ptr);
+                return allocator->allocate(size);
+            }
+
+            /// \private
+            static void png_free_allocator(png_structp png_ptr, png_voidp ptr)
+            {
+                Allocator *allocator = (Allocator *)png_get_mem_ptr(png_ptr);
+                allocator->release(ptr);
+            }
+
+            namespace detail
+            {
+                png_structp create_png_read_struct(png_voidp error_ptr, png_error_ptr error_fn, png_error_ptr warning_fn)
+                {
+#ifdef PNG_USER_MEM_SUPPORTED
+                    return png_create_read_struct_2(PNG_LIBPNG_VER_STRING, error_ptr, error_fn, warning_fn,
+                                                    Allocator::Current(), png_malloc_allocator, png_free_allocator);
+#else
+                    return png_create_read_struct(PNG_LIBPNG_VER_STRING, error_ptr, error_fn, warning_fn);
+#endif
+                }
+            }
+
+            /// \private
+            static png_structp create_png_write_struct()
+            {
+#ifdef PNG_USER_MEM_SUPPORTED
+                return png_create_write_struct_2(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr,
+                                                 Allocator::Current(), png_malloc_allocator, png_free_allocator);
+#else
+                return png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+#endif
+            }
+
+            // Writes to fp when it is set, otherwise appends to memory_output.
+            static bool write_png(FILE *fp, std::vector<char> *memory_output,
+                                  int w, int h, int chann, const WriteFormat &format, const WriteRowSource &source,
+                                  const EncodeOptions &options, std::string *errorStr)
             {
-                FILE *fp;
                 png_structp png_ptr;
                 png_infop info_ptr;
-                fp = ITKCommon::FileSystem::File::fopen(file_name, "wb", errorStr);
-                if (!fp)
-                    return false;                                           // error
-                png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, // png_voidp_nullptr,
-                                                  0,                        // png_error_ptr_nullptr,
-                                                  0                         // png_error_ptr_nullptr
-                );
+                png_ptr = create_png_write_struct();
                 if (png_ptr == nullptr)
                 {
-                    fclose(fp);
                     if (errorStr != nullptr)
                         *errorStr = ITKCommon::PrintfToStdString("Error on png_create_write_struct\n");
                     return false; // error
@@ -89,7 +250,6 @@ namespace ITKExtension
                 info_ptr = png_create_info_struct(png_ptr);
                 if (info_ptr == nullptr)
                 {
-                    fclose(fp);
                     png_destroy_write_struct(&png_ptr, 0 // png_infopp_nullptr
                     );
                     if (errorStr != nullptr)
@@ -98,15 +258,16 @@ namespace ITKExtension
                 }
                 if (setjmp(png_jmpbuf(png_ptr)))
                 {
-                    // If we get here, we had a problem reading the file
-                    fclose(fp);
+                    // If we get here, we had a problem writing the file
                     png_destroy_write_struct(&png_ptr, &info_ptr);
                     if (errorStr != nullptr)
                         *errorStr = ITKCommon::PrintfToStdString("Error on png setjmp\n");
                     return false; // error
                 }
-                png_set_write_fn(png_ptr, fp, user_write_data, user_flush_data);
-                png_init_io(png_ptr, fp);
+                if (fp != nullptr)
+                    png_set_write_fn(png_ptr, fp, user_write_data, user_flush_data);
+                else
+                    png_set_write_fn(png_ptr, memory_output, user_write_data_vector, nullptr);
                 int colorType;
                 switch (chann)
                 {
@@ -123,203 +284,576 @@ namespace ITKExtension
                     colorType = PNG_COLOR_TYPE_RGBA;
                     break;
                 default:
-                    fclose(fp);
                     png_destroy_write_struct(&png_ptr, &info_ptr);
                     if (errorStr != nullptr)
                         *errorStr = ITKCommon::PrintfToStdString("Invalid chann = %i.\n", chann);
                     return false; // error
                 }
+                // palette rows are 1 index per byte (chann = 1)
+                if (format.palette_rgba != nullptr)
+                    colorType = PNG_COLOR_TYPE_PALETTE;
                 png_set_IHDR(png_ptr, info_ptr, w, h,
-                             8,                            // bitdepth
+                             format.bit_depth,             // bitdepth
                              colorType,                    // color_type
                              PNG_INTERLACE_NONE,           // interlace_type
                              PNG_COMPRESSION_TYPE_DEFAULT, // compression_type
                              PNG_FILTER_TYPE_DEFAULT);     // filter_method
+                if (format.palette_rgba != nullptr)
+                {
+                    png_color colors[256];
+                    png_byte alpha[256];
+                    int num_trans = 0;
+                    for (int i = 0; i < format.palette_size; i++)
+                    {
+                        colors[i].red = format.palette_rgba[i * 4 + 0];
+                        colors[i].green = format.palette_rgba[i * 4 + 1];
+                        colors[i].blue = format.palette_rgba[i * 4 + 2];
+                        alpha[i] = format.palette_rgba[i * 4 + 3];
+                        if (alpha[i] != 255)
+                            num_trans = i + 1;
+                    }
+                    png_set_PLTE(png_ptr, info_ptr, colors, format.palette_size);
+                    if (num_trans > 0)
+                        png_set_tRNS(png_ptr, info_ptr, alpha, num_trans, nullptr);
+                }
+                apply_encode_options(png_ptr, options);
                 png_write_info(png_ptr, info_ptr);
-                if (invertY)
+                if (format.bit_depth < 8)
+                    png_set_packing(png_ptr);
+                else if (format.bit_depth == 16)
+                    png_set_swap(png_ptr);
+                const char *buffer = source.buffer;
+                size_t row_bytes = (size_t)w * chann * ((format.bit_depth == 16) ? 2 : 1);
+                if (buffer == nullptr)
+                {
+                    int y = 0;
+                    while (y < h)
+                    {
+                        int count = (h - y < source.band_rows) ? (h - y) : source.band_rows;
+                        if (!(*source.getRows)(source.band, y, count, row_bytes))
+                        {
+                            png_destroy_write_struct(&png_ptr, &info_ptr);
+                            if (errorStr != nullptr)
+                                *errorStr = ITKCommon::PrintfToStdString("PNG encode stopped by the row source callback\n");
+                            return false;
+                        }
+                        for (int i = 0; i < count; i++)
+                            png_write_row(png_ptr, (png_const_bytep)&source.band[(size_t)i * row_bytes]);
+                        y += count;
+                    }
+                }
+                else if (source.invertY)
                 {
                     for (int y = 0; y < h; y++)
-                        png_write_row(png_ptr, (png_byte *)&buffer[(h - y - 1) * w * chann]);
+                        png_write_row(png_ptr, (png_const_bytep)&buffer[(size_t)(h - y - 1) * row_bytes]);
                 }
                 else
                 {
                     for (int y = 0; y < h; y++)
-                        png_write_row(png_ptr, (png_byte *)&buffer[(y)*w * chann]);
+                        png_write_row(png_ptr, (png_const_bytep)&buffer[(size_t)(y)*row_bytes]);
                 }
                 png_write_end(png_ptr, info_ptr);
                 png_destroy_write_struct(&png_ptr, &info_ptr);
-                fclose(fp);
                 return true;
             }
             //----------------------------------------------------------------------------------
-            /* Read a PNG file.  You may want to return an error code if the read
-             * fails (depending upon the failure).  There are two "prototypes" given
-             * here - one where we are given the filename, and we need to open the
-             * file, and the other where we are given an open file (possibly with
-             * some or all of the magic bytes read - see comments above).
-             */
+            static double elapsed_ms(const std::chrono::steady_clock::time_point &start)
+            {
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
             //----------------------------------------------------------------------------------
-            char *readPNG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, bool invertY, std::string *errorStr)
-            { /* We need to open the file */
-                png_structp png_ptr;
-                png_infop info_ptr;
-                unsigned int sig_read = 0;
-                // png_uint_32 width, height;
-                //   int bit_depth, color_type, interlace_type;
-                FILE *fp;
-
-                fp = ITKCommon::FileSystem::File::fopen(file_name, "rb", errorStr);
+            bool writePNG(const char *file_name, int w, int h, int chann, char *buffer, bool invertY, std::string *errorStr)
+            {
+                return writePNG(file_name, w, h, chann, buffer, EncodeOptions(), invertY, nullptr, errorStr);
+            }
+            //----------------------------------------------------------------------------------
+            /// \private
+            static bool write_png_file(const char *file_name, int w, int h, int chann, const WriteFormat &format, const WriteRowSource &source,
+                                       const EncodeOptions &options, const std::chrono::steady_clock::time_point &start,
+                                       EncodeStats *stats, std::string *errorStr)
+            {
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "wb", errorStr);
                 if (!fp)
+                    return false; // error
+                bool result = write_png(fp, nullptr, w, h, chann, format, source, options, errorStr);
+                long output_size = ftell(fp);
+                fclose(fp);
+                if (result && stats != nullptr)
+                {
+                    stats->encode_ms = elapsed_ms(start);
+                    stats->output_size = (output_size > 0) ? (size_t)output_size : 0;
+                }
+                return result;
+            }
+            /// \private
+            static char *copy_output(const std::vector<char> &output, int *output_size,
+                                     const std::chrono::steady_clock::time_point &start, EncodeStats *stats)
+            {
+                *output_size = (int)output.size();
+                // char* outputBuffer = new char[output.size()];
+                char *outputBuffer = (char *)allocBuffer(output.size());
+                memcpy(outputBuffer, &output[0], output.size());
+
+                if (stats != nullptr)
+                {
+                    stats->encode_ms = elapsed_ms(start);
+                    stats->output_size = output.size();
+                }
+
+                return outputBuffer;
+            }
+            /// \private
+            static char *write_png_memory(int *output_size, int w, int h, int chann, const WriteFormat &format, const WriteRowSource &source,
+                                          const EncodeOptions &options, const std::chrono::steady_clock::time_point &start,
+                                          EncodeStats *stats)
+            {
+                std::vector<char> output;
+                if (!write_png(nullptr, &output, w, h, chann, format, source, options, nullptr))
+                {
+                    *output_size = 0;
                     return nullptr;
-                /* Create and initialize the png_struct with the desired error handler
-                 * functions.  If you want to use the default stderr and longjump method,
-                 * you can supply nullptr for the last three parameters.  We also supply the
-                 * the compiler header file version, so that we know if the application
-                 * was compiled with a compatible version of the library.  REQUIRED
-                 */
-                png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
-                                                 [](png_structp png_ptr, png_const_charp msg)
-                                                 {
-                                                     // Warning fnc
-                                                     // we can get here if the file is not a valid PNG or if there is an error reading the file
-                                                     // printf("Warning libpng: %s\n", msg);
-                                                     // longjmp(png_jmpbuf(png_ptr), 1);
-                                                 });
-                if (png_ptr == nullptr)
+                }
+                return copy_output(output, output_size, start, stats);
+            }
+            //----------------------------------------------------------------------------------
+            /// \private
+            static inline uint32_t pack_rgba(const uint8_t *pixel, int chann)
+            {
+                switch (chann)
                 {
-                    fclose(fp);
-                    if (errorStr != nullptr)
-                        *errorStr = ITKCommon::PrintfToStdString("Error on png_create_read_struct\n");
+                case 1:
+                    return (uint32_t)pixel[0] * 0x010101u | 0xff000000u;
+                case 2:
+                    return (uint32_t)pixel[0] * 0x010101u | (uint32_t)pixel[1] << 24;
+                case 3:
+                    return (uint32_t)pixel[0] | (uint32_t)pixel[1] << 8 | (uint32_t)pixel[2] << 16 | 0xff000000u;
+                default:
+                    return (uint32_t)pixel[0] | (uint32_t)pixel[1] << 8 | (uint32_t)pixel[2] << 16 | (uint32_t)pixel[3] << 24;
+                }
+            }
+
+            /// \private
+            ///
+            /// Collects the distinct colors of an 8 bits image as RGBA and maps every pixel to its entry.
+            /// Entries with alpha below 255 come first, so the tRNS chunk stays short.
+            ///
+            /// Returns the w * h index buffer (Image::allocBuffer), or nullptr when the image
+            /// has more than max_colors colors.
+            ///
+            static uint8_t *build_palette(const uint8_t *buffer, int w, int h, int chann, int max_colors,
+                                          uint8_t palette_rgba[256 * 4], int *palette_size)
+            {
+                if (buffer == nullptr || w <= 0 || h <= 0 || chann < 1 || chann > 4)
                     return nullptr;
+
+                // open addressing, 4x the biggest palette
+                const int HASH_BITS = 10;
+                const uint32_t HASH_MASK = (1u << HASH_BITS) - 1u;
+                uint32_t keys[1 << HASH_BITS];
+                int16_t entries[1 << HASH_BITS];
+                memset(entries, 0xff, sizeof(entries)); // -1: empty slot
+
+                uint32_t colors[256];
+                int count = 0;
+
+                size_t pixel_count = (size_t)w * (size_t)h;
+                uint32_t last_key = pack_rgba(buffer, chann) ^ 1u; // differs from the first pixel
+                for (size_t i = 0; i < pixel_count; i++)
+                {
+                    uint32_t key = pack_rgba(&buffer[i * chann], chann);
+                    if (key == last_key)
+                        continue;
+                    last_key = key;
+                    uint32_t slot = (key * 0x9E3779B1u) >> (32 - HASH_BITS);
+                    while (entries[slot] >= 0 && keys[slot] != key)
+                        slot = (slot + 1) & HASH_MASK;
+                    if (entries[slot] >= 0)
+                        continue;
+                    if (count == max_colors)
+                        return nullptr;
+                    keys[slot] = key;
+                    entries[slot] = (int16_t)count;
+                    colors[count++] = key;
                 }
-                /* Allocate/initialize the memory for image information.  REQUIRED. */
-                info_ptr = png_create_info_struct(png_ptr);
-                if (info_ptr == nullptr)
+
+                // translucent entries first, keeping the order of appearance
+                uint8_t remap[256];
+                int next = 0;
+                for (int pass = 0; pass < 2; pass++)
+                    for (int i = 0; i < count; i++)
+                        if (((colors[i] >> 24) != 0xff) == (pass == 0))
+                            remap[i] = (uint8_t)next++;
+                for (int i = 0; i < count; i++)
+                {
+                    uint32_t c = colors[i];
+                    uint8_t *entry = &palette_rgba[remap[i] * 4];
+                    entry[0] = (uint8_t)c;
+                    entry[1] = (uint8_t)(c >> 8);
+                    entry[2] = (uint8_t)(c >> 16);
+                    entry[3] = (uint8_t)(c >> 24);
+                }
+                *palette_size = count;
+
+                uint8_t *indices = (uint8_t *)allocBuffer(pixel_count);
+                last_key = pack_rgba(buffer, chann) ^ 1u;
+                uint8_t last_index = 0;
+                for (size_t i = 0; i < pixel_count; i++)
+                {
+                    uint32_t key = pack_rgba(&buffer[i * chann], chann);
+                    if (key != last_key)
+                    {
+                        last_key = key;
+                        uint32_t slot = (key * 0x9E3779B1u) >> (32 - HASH_BITS);
+                        while (keys[slot] != key)
+                            slot = (slot + 1) & HASH_MASK;
+                        last_index = remap[entries[slot]];
+                    }
+                    indices[i] = last_index;
+                }
+                return indices;
+            }
+
+            namespace detail
+            {
+                bool write_png_palette_candidate(std::vector<char> *output, int w, int h, int chann, const char *buffer,
+                                                 const EncodeOptions &options, bool invertY)
+                {
+                    uint8_t palette_rgba[256 * 4];
+                    int palette_size;
+                    uint8_t *indices = build_palette((const uint8_t *)buffer, w, h, chann, (chann == 1) ? 16 : 256, palette_rgba, &palette_size);
+                    if (indices == nullptr)
+                        return false;
+
+                    WriteFormat format = {palette_bit_depth(palette_size), palette_rgba, palette_size};
+                    WriteRowSource index_source = {(const char *)indices, invertY, nullptr, nullptr, 0};
+                    bool result = write_png(nullptr, output, w, h, 1, format, index_source, options, nullptr);
+                    freeBuffer(indices);
+                    return result;
+                }
+            }
+
+            /// \private
+            ///
+            /// PaletteMode::Auto: an image with few colors is encoded both as given and as a
+            /// palette image, the smaller output is kept.
+            static bool write_png_auto(std::vector<char> *output, int w, int h, int chann, const char *buffer,
+                                       const EncodeOptions &options, bool invertY, std::string *errorStr)
+            {
+                WriteRowSource source = {buffer, invertY, nullptr, nullptr, 0};
+                if (!write_png(nullptr, output, w, h, chann, WRITE_FORMAT_8, source, options, errorStr))
+                    return false;
+
+                std::vector<char> indexed;
+                if (detail::write_png_palette_candidate(&indexed, w, h, chann, buffer, options, invertY) &&
+                    indexed.size() < output->size())
+                    output->swap(indexed);
+                return true;
+            }
+
+            /// \private
+            ///
+            /// Position of the first index that is not below palette_size, -1 when all are valid.
+            static int64_t find_index_out_of_palette(const uint8_t *indices, int w, int h, int palette_size)
+            {
+                if (w <= 0 || h <= 0 || palette_size >= 256)
+                    return -1;
+                size_t count = (size_t)w * (size_t)h;
+                for (size_t i = 0; i < count; i++)
+                    if (indices[i] >= palette_size)
+                        return (int64_t)i;
+                return -1;
+            }
+            //----------------------------------------------------------------------------------
+            bool writePNG(const char *file_name, int w, int h, int chann, char *buffer, const EncodeOptions &options, bool invertY, EncodeStats *stats, std::string *errorStr)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+                if (options.palette == PaletteMode::Auto)
                 {
+                    std::vector<char> output;
+                    if (!write_png_auto(&output, w, h, chann, buffer, options, invertY, errorStr))
+                        return false;
+                    FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "wb", errorStr);
+                    if (!fp)
+                        return false; // error
+                    bool result = fwrite(&output[0], 1, output.size(), fp) == output.size();
                     fclose(fp);
-                    png_destroy_read_struct(&png_ptr, 0, // png_infopp_nullptr,
-                                            0            // png_infopp_nullptr
-                    );
+                    if (!result)
+                    {
+                        if (errorStr != nullptr)
+                            *errorStr = ITKCommon::PrintfToStdString("Error writing %s\n", file_name);
+                        return false;
+                    }
+                    if (stats != nullptr)
+                    {
+                        stats->encode_ms = elapsed_ms(start);
+                        stats->output_size = output.size();
+                    }
+                    return true;
+                }
+
+                WriteRowSource source = {buffer, invertY, nullptr, nullptr, 0};
+                return write_png_file(file_name, w, h, chann, WRITE_FORMAT_8, source, options, start, stats, errorStr);
+            }
+            //----------------------------------------------------------------------------------
+            bool writePNGIndexed(const char *file_name, int w, int h, const uint8_t *indices, const uint8_t *palette_rgba, int palette_size, const EncodeOptions &options, bool invertY, EncodeStats *stats, std::string *errorStr)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                if (indices == nullptr || palette_rgba == nullptr || palette_size < 1 || palette_size > 256)
+                {
                     if (errorStr != nullptr)
-                        *errorStr = ITKCommon::PrintfToStdString("Error on png_create_info_struct\n");
-                    return nullptr;
+                        *errorStr = ITKCommon::PrintfToStdString("Invalid palette size = %i.\n", palette_size);
+                    return false;
                 }
-                /* Set error handling if you are using the setjmp/longjmp method (this is
-                 * the normal method of doing things with libpng).  REQUIRED unless you
-                 * set up your own error handlers in the png_create_read_struct() earlier.
-                 */
-                if (setjmp(png_jmpbuf(png_ptr)))
+                int64_t invalid = find_index_out_of_palette(indices, w, h, palette_size);
+                if (invalid >= 0)
                 {
-                    /* Free all of the memory associated with the png_ptr and info_ptr */
-                    png_destroy_read_struct(&png_ptr, &info_ptr, 0 // png_infopp_nullptr
-                    );
-                    fclose(fp);
-                    /* If we get here, we had a problem reading the file */
                     if (errorStr != nullptr)
-                        *errorStr = ITKCommon::PrintfToStdString("Error on png setjmp\n");
+                        *errorStr = ITKCommon::PrintfToStdString("Palette index %i at pixel (%i, %i) is not below the palette size %i.\n",
+                                                                 (int)indices[invalid], (int)(invalid % w), (int)(invalid / w), palette_size);
+                    return false;
+                }
+                WriteFormat format = {palette_bit_depth(palette_size), palette_rgba, palette_size};
+                WriteRowSource source = {(const char *)indices, invertY, nullptr, nullptr, 0};
+                return write_png_file(file_name, w, h, 1, format, source, options, start, stats, errorStr);
+            }
+            //----------------------------------------------------------------------------------
+            bool writePNG16(const char *file_name, int w, int h, int chann, const uint16_t *buffer, const EncodeOptions &options, bool invertY, EncodeStats *stats, std::string *errorStr)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                WriteRowSource source = {(const char *)buffer, invertY, nullptr, nullptr, 0};
+                return write_png_file(file_name, w, h, chann, WRITE_FORMAT_16, source, options, start, stats, errorStr);
+            }
+            //----------------------------------------------------------------------------------
+            bool writePNGRows(const char *file_name, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows, const EncodeOptions &options, EncodeStats *stats, std::string *errorStr)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                if (w <= 0 || h <= 0 || chann < 1 || chann > 4)
+                {
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Invalid image w = %i, h = %i, chann = %i.\n", w, h, chann);
+                    return false;
+                }
+                if (band_rows <= 0)
+                    band_rows = 1;
+                if (band_rows > h)
+                    band_rows = h;
+
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "wb", errorStr);
+                if (!fp)
+                    return false; // error
+
+                WriteRowSource source;
+                source.buffer = nullptr;
+                source.invertY = false;
+                source.getRows = &getRows;
+                source.band_rows = band_rows;
+                source.band = (char *)allocBuffer((size_t)w * chann * band_rows);
+
+                bool result = write_png(fp, nullptr, w, h, chann, WRITE_FORMAT_8, source, options, errorStr);
+                long output_size = ftell(fp);
+                fclose(fp);
+                freeBuffer(source.band);
+
+                if (result && stats != nullptr)
+                {
+                    stats->encode_ms = elapsed_ms(start);
+                    stats->output_size = (output_size > 0) ? (size_t)output_size : 0;
+                }
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            char *writePNGRowsToMemory(int *output_size, int w, int h, int chann, const RowSourceCallback &getRows, int band_rows, const EncodeOptions &options, EncodeStats *stats)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                *output_size = 0;
+                if (w <= 0 || h <= 0 || chann < 1 || chann > 4)
                     return nullptr;
+                if (band_rows <= 0)
+                    band_rows = 1;
+                if (band_rows > h)
+                    band_rows = h;
+
+                std::vector<char> output;
+                WriteRowSource source;
+                source.buffer = nullptr;
+                source.invertY = false;
+                source.getRows = &getRows;
+                source.band_rows = band_rows;
+                source.band = (char *)allocBuffer((size_t)w * chann * band_rows);
+
+                bool result = write_png(nullptr, &output, w, h, chann, WRITE_FORMAT_8, source, options, nullptr);
+                freeBuffer(source.band);
+                if (!result)
+                    return nullptr;
+
+                *output_size = (int)output.size();
+                char *outputBuffer = (char *)allocBuffer(output.size());
+                memcpy(outputBuffer, &output[0], output.size());
+
+                if (stats != nullptr)
+                {
+                    stats->encode_ms = elapsed_ms(start);
+                    stats->output_size = output.size();
                 }
-                /* Set up the input control if you are using standard C streams */
-                png_init_io(png_ptr, fp);
-                /* If we have already read some of the signature */
-                png_set_sig_bytes(png_ptr, sig_read);
-                /*
-                png_bytepp row_pointers = (png_bytepp)png_malloc(png_ptr,info_ptr->height*png_sizeof(png_bytep));
-                  row_pointers[0] = (png_bytep)png_malloc(png_ptr,info_ptr->width*info_ptr->pixel_depth);
-                  for (int i=1; i<png_ptr->height; i++)
-                     row_pointers[i]=(png_bytep)row_pointers[i*info_ptr->width];
-                  png_set_rows(png_ptr, info_ptr, row_pointers);
-                  */
-                /*
-                 * If you have enough memory to read in the entire image at once,
-                 * and you need to specify only transforms that can be controlled
-                 * with one of the PNG_TRANSFORM_* bits (this presently excludes
-                 * dithering, filling, setting background, and doing gamma
-                 * adjustment), then you can read the entire image (including
-                 * pixels) into the info structure with this call:
-                 */
-                // png_set_expand(
-                // PNG_TRANSFORM_SWAP_ENDIAN -- PNG_TRANSFORM_IDENTITY
-                png_read_png(png_ptr, info_ptr, PNG_TRANSFORM_SWAP_ENDIAN, 0 // png_voidp_nullptr
-                );
-                /* At this point you have read the entire image */
+                return outputBuffer;
+            }
+            //----------------------------------------------------------------------------------
+            /// \private
+            ///
+            /// Lives in the frame that calls setjmp and is only modified through a pointer
+            /// by read_png_rows, so its values are still valid after a longjmp.
+            struct ReadState
+            {
+                char *allocated; // output allocated by the decoder, freed on error
+                png_bytepp rows;
+            };
+
+            /// \private
+            ///
+            /// Set by readPNGIndexed: the file must be a palette image, decoded as 1 byte per index.
+            struct PaletteOutput
+            {
+                uint8_t *rgba;
+                int *size;
+            };
+
+            /// \private
+            static void png_warning_ignore(png_structp png_ptr, png_const_charp msg)
+            {
+                // Warning fnc
+                // we can get here if the file is not a valid PNG or if there is an error reading the file
+                // printf("Warning libpng: %s\n", msg);
+                // longjmp(png_jmpbuf(png_ptr), 1);
+            }
+
+            /// \private
+            static char *read_png_rows(png_structp png_ptr, png_infop info_ptr, ReadState *state,
+                                       char *output, size_t output_stride, size_t output_capacity,
+                                       int *w, int *h, int *chann, int *pixel_depth, bool invertY,
+                                       const PaletteOutput *palette, std::string *errorStr)
+            {
+                png_read_info(png_ptr, info_ptr);
+
+                if (palette != nullptr)
+                {
+                    if (png_get_color_type(png_ptr, info_ptr) != PNG_COLOR_TYPE_PALETTE)
+                    {
+                        if (errorStr != nullptr)
+                            *errorStr = ITKCommon::PrintfToStdString("Not a palette PNG.\n");
+                        return nullptr;
+                    }
+                    png_colorp colors = nullptr;
+                    int num_colors = 0;
+                    png_get_PLTE(png_ptr, info_ptr, &colors, &num_colors);
+                    png_bytep alpha = nullptr;
+                    int num_trans = 0;
+                    if (!png_get_tRNS(png_ptr, info_ptr, &alpha, &num_trans, nullptr))
+                        num_trans = 0;
+                    for (int i = 0; i < num_colors; i++)
+                    {
+                        palette->rgba[i * 4 + 0] = colors[i].red;
+                        palette->rgba[i * 4 + 1] = colors[i].green;
+                        palette->rgba[i * 4 + 2] = colors[i].blue;
+                        palette->rgba[i * 4 + 3] = (i < num_trans) ? alpha[i] : 255;
+                    }
+                    *palette->size = num_colors;
+                    // 1, 2 and 4 bits indices to 1 byte each
+                    if (png_get_bit_depth(png_ptr, info_ptr) < 8)
+                        png_set_packing(png_ptr);
+                }
+
+                // same transforms png_read_png applied with PNG_TRANSFORM_SWAP_ENDIAN
+                if (png_get_bit_depth(png_ptr, info_ptr) == 16)
+                    png_set_swap(png_ptr);
+                png_set_interlace_handling(png_ptr);
+                png_read_update_info(png_ptr, info_ptr);
+
                 png_uint_32 width = png_get_image_width(png_ptr, info_ptr);
                 png_uint_32 height = png_get_image_height(png_ptr, info_ptr);
                 png_byte channels = png_get_channels(png_ptr, info_ptr);
                 png_byte depth = png_get_bit_depth(png_ptr, info_ptr);
+                size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
 
-                // printf("PNG READED (w: %i h: %i chn:%i bits: %i)\n",
-                //        width,
-                //        height,
-                //        channels,
-                //        depth);
-
-                // char* retorno = new char[width*height*channels*(depth / 8)];
-                char *retorno = (char *)ITKCommon::Memory::malloc(width * height * channels * (depth / 8));
                 *w = width;
                 *h = height;
                 *chann = channels;
                 *pixel_depth = depth;
-                png_bytepp rows = png_get_rows(png_ptr, info_ptr);
-                if (invertY)
+
+                if (output != nullptr)
                 {
-                    for (unsigned int i = 0; i < height; i++)
+                    if (output_stride == 0)
+                        output_stride = row_bytes;
+                    if (output_stride < row_bytes || (height > 0 && output_capacity < output_stride * (height - 1) + row_bytes))
                     {
-                        memcpy(&retorno[i * width * channels * (depth / 8)],
-                               rows[height - 1 - i],
-                               width * channels * (depth / 8));
+                        if (errorStr != nullptr)
+                            *errorStr = ITKCommon::PrintfToStdString("Output buffer too small for %ux%u PNG (row bytes: %u).\n", width, height, (unsigned int)row_bytes);
+                        return nullptr;
                     }
                 }
                 else
                 {
-                    for (unsigned int i = 0; i < height; i++)
-                    {
-                        memcpy(&retorno[i * width * channels * (depth / 8)],
-                               rows[i],
-                               width * channels * (depth / 8));
-                    }
+                    output_stride = row_bytes;
+                    state->allocated = (char *)allocBuffer(row_bytes * height);
+                    output = state->allocated;
                 }
-                /* clean up after the read, and free any memory allocated - REQUIRED */
-                png_destroy_read_struct(&png_ptr, &info_ptr, 0 // png_infopp_nullptr
-                );
-                /* close the file */
-                fclose(fp);
-                /* that's it */
-                return retorno;
+
+                state->rows = (png_bytepp)allocBuffer(sizeof(png_bytep) * height);
+                for (png_uint_32 i = 0; i < height; i++)
+                {
+                    png_uint_32 y = (invertY) ? (height - 1 - i) : i;
+                    state->rows[i] = (png_bytep)&output[y * output_stride];
+                }
+
+                png_read_image(png_ptr, state->rows);
+                png_read_end(png_ptr, nullptr);
+
+                return output;
             }
-            //----------------------------------------------------------------------------------
-            char *readPNGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth, bool invertY)
+
+            /// \private
+            ///
+            /// Decode from a FILE* or from memory straight into the final buffer.
+            ///
+            /// The row pointers are set to the output rows (reversed when invertY),
+            /// so libpng writes each row once and no intermediate image is allocated.
+            /// When output is nullptr the buffer is allocated with Image::allocBuffer.
+            ///
+            static char *read_png(FILE *fp, DataReadInput *memory_input,
+                                  char *output, size_t output_stride, size_t output_capacity,
+                                  int *w, int *h, int *chann, int *pixel_depth, bool invertY,
+                                  const PaletteOutput *palette, std::string *errorStr)
             {
                 png_structp png_ptr;
                 png_infop info_ptr;
-                unsigned int sig_read = 0;
-                // png_uint_32 width, height;
-                //   int bit_depth, color_type, interlace_type;
+
                 /* Create and initialize the png_struct with the desired error handler
                  * functions.  If you want to use the default stderr and longjump method,
                  * you can supply nullptr for the last three parameters.  We also supply the
                  * the compiler header file version, so that we know if the application
                  * was compiled with a compatible version of the library.  REQUIRED
                  */
-                png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
-                                                 [](png_structp png_ptr, png_const_charp msg)
-                                                 {
-                                                     // Warning fnc
-                                                     // we can get here if the file is not a valid PNG or if there is an error reading the file
-                                                     // printf("Warning libpng: %s\n", msg);
-                                                     // longjmp(png_jmpbuf(png_ptr), 1);
-                                                 });
+                png_ptr = detail::create_png_read_struct(nullptr, nullptr, png_warning_ignore);
                 if (png_ptr == nullptr)
                 {
-                    return (nullptr);
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Error on png_create_read_struct\n");
+                    return nullptr;
                 }
                 /* Allocate/initialize the memory for image information.  REQUIRED. */
                 info_ptr = png_create_info_struct(png_ptr);
                 if (info_ptr == nullptr)
                 {
                     png_destroy_read_struct(&png_ptr, nullptr, nullptr);
-                    return (nullptr);
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Error on png_create_info_struct\n");
+                    return nullptr;
                 }
+
+                ReadState state;
+                state.allocated = nullptr;
+                state.rows = nullptr;
+
                 /* Set error handling if you are using the setjmp/longjmp method (this is
                  * the normal method of doing things with libpng).  REQUIRED unless you
                  * set up your own error handlers in the png_create_read_struct() earlier.
@@ -328,164 +862,352 @@ namespace ITKExtension
                 {
                     /* Free all of the memory associated with the png_ptr and info_ptr */
                     png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+                    if (state.rows != nullptr)
+                        freeBuffer(state.rows);
+                    if (state.allocated != nullptr)
+                        freeBuffer(state.allocated);
                     /* If we get here, we had a problem reading the file */
-                    return (nullptr);
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Error on png setjmp\n");
+                    return nullptr;
                 }
 
+                if (fp != nullptr)
+                    png_init_io(png_ptr, fp);
+                else
+                    png_set_read_fn(png_ptr, memory_input, user_read_data_DataReadInput);
+                png_set_sig_bytes(png_ptr, 0);
+
+                char *result = read_png_rows(png_ptr, info_ptr, &state, output, output_stride, output_capacity, w, h, chann, pixel_depth, invertY, palette, errorStr);
+
+                if (state.rows != nullptr)
+                    freeBuffer(state.rows);
+                /* clean up after the read, and free any memory allocated - REQUIRED */
+                png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            char *readPNG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, bool invertY, std::string *errorStr)
+            {
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "rb", errorStr);
+                if (!fp)
+                    return nullptr;
+                char *result = read_png(fp, nullptr, nullptr, 0, 0, w, h, chann, pixel_depth, invertY, nullptr, errorStr);
+                fclose(fp);
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            bool readPNGToBuffer(const char *file_name, char *output, size_t output_stride, size_t output_capacity, int *w, int *h, int *chann, int *pixel_depth, bool invertY, std::string *errorStr)
+            {
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "rb", errorStr);
+                if (!fp)
+                    return false;
+                char *result = read_png(fp, nullptr, output, output_stride, output_capacity, w, h, chann, pixel_depth, invertY, nullptr, errorStr);
+                fclose(fp);
+                return result != nullptr;
+            }
+            //----------------------------------------------------------------------------------
+            char *readPNGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth, bool invertY)
+            {
                 DataReadInput inputBuffer;
                 inputBuffer.buffer = input_buffer;
                 inputBuffer.size = input_buffer_size;
                 inputBuffer.readed = 0;
-                png_set_read_fn(png_ptr, &inputBuffer, user_read_data_DataReadInput);
-
-                /* Set up the input control if you are using standard C streams */
-                // png_init_io(png_ptr, fp);
-                /* If we have already read some of the signature */
-                png_set_sig_bytes(png_ptr, sig_read);
-                /*
-                png_bytepp row_pointers = (png_bytepp)png_malloc(png_ptr,info_ptr->height*png_sizeof(png_bytep));
-                  row_pointers[0] = (png_bytep)png_malloc(png_ptr,info_ptr->width*info_ptr->pixel_depth);
-                  for (int i=1; i<png_ptr->height; i++)
-                     row_pointers[i]=(png_bytep)row_pointers[i*info_ptr->width];
-                  png_set_rows(png_ptr, info_ptr, row_pointers);
-                  */
-                /*
-                 * If you have enough memory to read in the entire image at once,
-                 * and you need to specify only transforms that can be controlled
-                 * with one of the PNG_TRANSFORM_* bits (this presently excludes
-                 * dithering, filling, setting background, and doing gamma
-                 * adjustment), then you can read the entire image (including
-                 * pixels) into the info structure with this call:
-                 */
-                // png_set_expand(
-                // PNG_TRANSFORM_SWAP_ENDIAN -- PNG_TRANSFORM_IDENTITY
-                png_read_png(png_ptr, info_ptr, PNG_TRANSFORM_SWAP_ENDIAN, nullptr);
-                /* At this point you have read the entire image */
+                return read_png(nullptr, &inputBuffer, nullptr, 0, 0, w, h, chann, pixel_depth, invertY, nullptr, nullptr);
+            }
+            //----------------------------------------------------------------------------------
+            bool readPNGFromMemoryToBuffer(const char *input_buffer, int input_buffer_size, char *output, size_t output_stride, size_t output_capacity, int *w, int *h, int *chann, int *pixel_depth, bool invertY, std::string *errorStr)
+            {
+                DataReadInput inputBuffer;
+                inputBuffer.buffer = input_buffer;
+                inputBuffer.size = input_buffer_size;
+                inputBuffer.readed = 0;
+                return read_png(nullptr, &inputBuffer, output, output_stride, output_capacity, w, h, chann, pixel_depth, invertY, nullptr, errorStr) != nullptr;
+            }
+            //----------------------------------------------------------------------------------
+            char *readPNGIndexed(const char *file_name, int *w, int *h, uint8_t *palette_rgba, int *palette_size, bool invertY, std::string *errorStr)
+            {
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "rb", errorStr);
+                if (!fp)
+                    return nullptr;
+                int chann, pixel_depth;
+                PaletteOutput palette = {palette_rgba, palette_size};
+                char *result = read_png(fp, nullptr, nullptr, 0, 0, w, h, &chann, &pixel_depth, invertY, &palette, errorStr);
+                fclose(fp);
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            char *readPNGIndexedFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, uint8_t *palette_rgba, int *palette_size, bool invertY, std::string *errorStr)
+            {
+                DataReadInput inputBuffer;
+                inputBuffer.buffer = input_buffer;
+                inputBuffer.size = input_buffer_size;
+                inputBuffer.readed = 0;
+                int chann, pixel_depth;
+                PaletteOutput palette = {palette_rgba, palette_size};
+                return read_png(nullptr, &inputBuffer, nullptr, 0, 0, w, h, &chann, &pixel_depth, invertY, &palette, errorStr);
+            }
+            //----------------------------------------------------------------------------------
+            /// \private
+            static bool read_png_stream_rows(png_structp png_ptr, png_infop info_ptr, ReadState *state,
+                                             const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+            {
+                png_read_info(png_ptr, info_ptr);
+
+                if (png_get_bit_depth(png_ptr, info_ptr) == 16)
+                    png_set_swap(png_ptr);
+                int passes = png_set_interlace_handling(png_ptr);
+                png_read_update_info(png_ptr, info_ptr);
+
                 png_uint_32 width = png_get_image_width(png_ptr, info_ptr);
                 png_uint_32 height = png_get_image_height(png_ptr, info_ptr);
                 png_byte channels = png_get_channels(png_ptr, info_ptr);
                 png_byte depth = png_get_bit_depth(png_ptr, info_ptr);
-                // printf("PNG READED (w: %i h: %i chn:%i bits: %i)\n",
-                //        width,
-                //        height,
-                //        channels,
-                //        depth);
-                // char* retorno = new char[width*height*channels*(depth / 8)];
-                char *retorno = (char *)ITKCommon::Memory::malloc(width * height * channels * (depth / 8));
-                *w = width;
-                *h = height;
-                *chann = channels;
-                *pixel_depth = depth;
-                png_bytepp rows = png_get_rows(png_ptr, info_ptr);
-                if (invertY)
+                size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+
+                if (onHeader != nullptr && !onHeader((int)width, (int)height, (int)channels, (int)depth))
+                {
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("PNG decode stopped by the header callback\n");
+                    return false;
+                }
+
+                if (band_rows <= 0)
+                    band_rows = 1;
+                if ((png_uint_32)band_rows > height)
+                    band_rows = (int)height;
+
+                if (passes > 1)
                 {
-                    for (unsigned int i = 0; i < height; i++)
+                    // Adam7 rows are only complete after the last pass, so an
+                    // interlaced image needs the whole frame in memory.
+                    state->allocated = (char *)allocBuffer(row_bytes * height);
+                    state->rows = (png_bytepp)allocBuffer(sizeof(png_bytep) * height);
+                    for (png_uint_32 y = 0; y < height; y++)
+                        state->rows[y] = (png_bytep)&state->allocated[y * row_bytes];
+                    png_read_image(png_ptr, state->rows);
+                    for (png_uint_32 y = 0; y < height; y += band_rows)
                     {
-                        memcpy(&retorno[i * width * channels * (depth / 8)],
-                               rows[height - 1 - i],
-                               width * channels * (depth / 8));
+                        int count = (int)((height - y < (png_uint_32)band_rows) ? (height - y) : (png_uint_32)band_rows);
+                        if (!onRows(&state->allocated[y * row_bytes], (int)y, count, row_bytes))
+                        {
+                            if (errorStr != nullptr)
+                                *errorStr = ITKCommon::PrintfToStdString("PNG decode stopped by the row callback\n");
+                            return false;
+                        }
                     }
+                    png_read_end(png_ptr, nullptr);
+                    return true;
                 }
-                else
+
+                state->allocated = (char *)allocBuffer(row_bytes * band_rows);
+                png_uint_32 y = 0;
+                while (y < height)
                 {
-                    for (unsigned int i = 0; i < height; i++)
+                    int count = (int)((height - y < (png_uint_32)band_rows) ? (height - y) : (png_uint_32)band_rows);
+                    for (int i = 0; i < count; i++)
+                        png_read_row(png_ptr, (png_bytep)&state->allocated[i * row_bytes], nullptr);
+                    if (!onRows(state->allocated, (int)y, count, row_bytes))
                     {
-                        memcpy(&retorno[i * width * channels * (depth / 8)],
-                               rows[i],
-                               width * channels * (depth / 8));
+                        if (errorStr != nullptr)
+                            *errorStr = ITKCommon::PrintfToStdString("PNG decode stopped by the row callback\n");
+                        return false;
                     }
+                    y += count;
                 }
-                /* clean up after the read, and free any memory allocated - REQUIRED */
-                png_destroy_read_struct(&png_ptr, &info_ptr, 0 // png_infopp_nullptr
-                );
-                /* that's it */
-                return retorno;
+                png_read_end(png_ptr, nullptr);
+                return true;
             }
-            //----------------------------------------------------------------------------------
-            char *writePNGToMemory(int *output_size, int w, int h, int chann, char *buffer, bool invertY)
-            {
-                std::vector<char> output;
-
-                png_structp png_ptr;
-                png_infop info_ptr;
 
-                png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+            /// \private
+            static bool read_png_stream(FILE *fp, DataReadInput *memory_input,
+                                        const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+            {
+                png_structp png_ptr = detail::create_png_read_struct(nullptr, nullptr, png_warning_ignore);
                 if (png_ptr == nullptr)
                 {
-                    // error
-                    *output_size = 0;
-                    return nullptr;
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Error on png_create_read_struct\n");
+                    return false;
                 }
-                info_ptr = png_create_info_struct(png_ptr);
+                png_infop info_ptr = png_create_info_struct(png_ptr);
                 if (info_ptr == nullptr)
                 {
-                    // error
-                    png_destroy_write_struct(&png_ptr, nullptr);
-                    *output_size = 0;
-                    return nullptr;
+                    png_destroy_read_struct(&png_ptr, nullptr, nullptr);
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Error on png_create_info_struct\n");
+                    return false;
                 }
+
+                ReadState state;
+                state.allocated = nullptr; // band buffer
+                state.rows = nullptr;
+
                 if (setjmp(png_jmpbuf(png_ptr)))
                 {
-                    // error
-                    png_destroy_write_struct(&png_ptr, &info_ptr);
-                    *output_size = 0;
-                    return nullptr;
+                    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+                    if (state.rows != nullptr)
+                        freeBuffer(state.rows);
+                    if (state.allocated != nullptr)
+                        freeBuffer(state.allocated);
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Error on png setjmp\n");
+                    return false;
                 }
-                png_set_write_fn(png_ptr, &output, user_write_data_vector, nullptr);
-                // png_init_io(png_ptr, fp);
-                int colorType;
-                switch (chann)
+
+                if (fp != nullptr)
+                    png_init_io(png_ptr, fp);
+                else
+                    png_set_read_fn(png_ptr, memory_input, user_read_data_DataReadInput);
+                png_set_sig_bytes(png_ptr, 0);
+
+                bool result = read_png_stream_rows(png_ptr, info_ptr, &state, onHeader, onRows, band_rows, errorStr);
+
+                if (state.rows != nullptr)
+                    freeBuffer(state.rows);
+                if (state.allocated != nullptr)
+                    freeBuffer(state.allocated);
+                png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            bool readPNGRows(const char *file_name, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+            {
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "rb", errorStr);
+                if (!fp)
+                    return false;
+                bool result = read_png_stream(fp, nullptr, onHeader, onRows, band_rows, errorStr);
+                fclose(fp);
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            bool readPNGRowsFromMemory(const char *input_buffer, int input_buffer_size, const HeaderCallback &onHeader, const RowCallback &onRows, int band_rows, std::string *errorStr)
+            {
+                DataReadInput inputBuffer;
+                inputBuffer.buffer = input_buffer;
+                inputBuffer.size = input_buffer_size;
+                inputBuffer.readed = 0;
+                return read_png_stream(nullptr, &inputBuffer, onHeader, onRows, band_rows, errorStr);
+            }
+            //----------------------------------------------------------------------------------
+            // signature (8) + IHDR length (4) + "IHDR" (4) + IHDR data (13)
+            static const int PNG_PROBE_SIZE = 8 + 4 + 4 + 13;
+
+            static bool probe_png_header(const uint8_t *data, int size, int *w, int *h, int *chann, int *pixel_depth)
+            {
+                static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+                if (size < PNG_PROBE_SIZE ||
+                    memcmp(data, signature, 8) != 0 ||
+                    memcmp(data + 12, "IHDR", 4) != 0)
+                    return false;
+
+                const uint8_t *ihdr = data + 16;
+                uint32_t width = ((uint32_t)ihdr[0] << 24) | ((uint32_t)ihdr[1] << 16) | ((uint32_t)ihdr[2] << 8) | (uint32_t)ihdr[3];
+                uint32_t height = ((uint32_t)ihdr[4] << 24) | ((uint32_t)ihdr[5] << 16) | ((uint32_t)ihdr[6] << 8) | (uint32_t)ihdr[7];
+                if (width == 0 || height == 0 || width > 0x7fffffff || height > 0x7fffffff)
+                    return false;
+
+                // channels as returned by readPNG (palette images are not expanded)
+                int channels;
+                switch (ihdr[9])
                 {
-                case 1:
-                    colorType = PNG_COLOR_TYPE_GRAY;
+                case PNG_COLOR_TYPE_GRAY:
+                case PNG_COLOR_TYPE_PALETTE:
+                    channels = 1;
                     break;
-                case 2:
-                    colorType = PNG_COLOR_TYPE_GRAY_ALPHA;
+                case PNG_COLOR_TYPE_GRAY_ALPHA:
+                    channels = 2;
                     break;
-                case 3:
-                    colorType = PNG_COLOR_TYPE_RGB;
+                case PNG_COLOR_TYPE_RGB:
+                    channels = 3;
                     break;
-                case 4:
-                    colorType = PNG_COLOR_TYPE_RGBA;
+                case PNG_COLOR_TYPE_RGB_ALPHA:
+                    channels = 4;
                     break;
                 default:
-                    png_destroy_write_struct(&png_ptr, &info_ptr);
-                    *output_size = 0;
-                    return nullptr; // error
+                    return false;
                 }
-                png_set_IHDR(png_ptr, info_ptr, w, h,
-                             8,                            // bitdepth
-                             colorType,                    // color_type
-                             PNG_INTERLACE_NONE,           // interlace_type
-                             PNG_COMPRESSION_TYPE_DEFAULT, // compression_type
-                             PNG_FILTER_TYPE_DEFAULT);     // filter_method
-                png_write_info(png_ptr, info_ptr);
-                if (invertY)
+
+                *w = (int)width;
+                *h = (int)height;
+                *chann = channels;
+                *pixel_depth = ihdr[8];
+                return true;
+            }
+            //----------------------------------------------------------------------------------
+            bool probePNG(const char *file_name, int *w, int *h, int *chann, int *pixel_depth, std::string *errorStr)
+            {
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "rb", errorStr);
+                if (!fp)
+                    return false;
+                uint8_t header[PNG_PROBE_SIZE];
+                int readed = (int)fread(header, 1, PNG_PROBE_SIZE, fp);
+                fclose(fp);
+                if (!probe_png_header(header, readed, w, h, chann, pixel_depth))
                 {
-                    for (int y = 0; y < h; y++)
-                        png_write_row(png_ptr, (png_byte *)&buffer[(h - y - 1) * w * chann]);
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Invalid PNG header: %s\n", file_name);
+                    return false;
                 }
-                else
+                return true;
+            }
+            //----------------------------------------------------------------------------------
+            bool probePNGFromMemory(const char *input_buffer, int input_buffer_size, int *w, int *h, int *chann, int *pixel_depth)
+            {
+                return probe_png_header((const uint8_t *)input_buffer, input_buffer_size, w, h, chann, pixel_depth);
+            }
+            //----------------------------------------------------------------------------------
+            char *writePNGToMemory(int *output_size, int w, int h, int chann, char *buffer, bool invertY)
+            {
+                return writePNGToMemory(output_size, w, h, chann, buffer, EncodeOptions(), invertY, nullptr);
+            }
+            //----------------------------------------------------------------------------------
+            char *writePNGToMemory(int *output_size, int w, int h, int chann, char *buffer, const EncodeOptions &options, bool invertY, EncodeStats *stats)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+                if (options.palette == PaletteMode::Auto)
                 {
-                    for (int y = 0; y < h; y++)
-                        png_write_row(png_ptr, (png_byte *)&buffer[(y)*w * chann]);
+                    std::vector<char> output;
+                    if (!write_png_auto(&output, w, h, chann, buffer, options, invertY, nullptr))
+                    {
+                        *output_size = 0;
+                        return nullptr;
+                    }
+                    return copy_output(output, output_size, start, stats);
                 }
-                png_write_end(png_ptr, info_ptr);
-                png_destroy_write_struct(&png_ptr, &info_ptr);
 
-                *output_size = (int)output.size();
-                // char* outputBuffer = new char[output.size()];
-                char *outputBuffer = (char *)ITKCommon::Memory::malloc(output.size());
-                memcpy(outputBuffer, &output[0], output.size());
-
-                return outputBuffer;
+                WriteRowSource source = {buffer, invertY, nullptr, nullptr, 0};
+                return write_png_memory(output_size, w, h, chann, WRITE_FORMAT_8, source, options, start, stats);
+            }
+            //----------------------------------------------------------------------------------
+            char *writePNGIndexedToMemory(int *output_size, int w, int h, const uint8_t *indices, const uint8_t *palette_rgba, int palette_size, const EncodeOptions &options, bool invertY, EncodeStats *stats)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                *output_size = 0;
+                if (indices == nullptr || palette_rgba == nullptr || palette_size < 1 || palette_size > 256)
+                    return nullptr;
+                if (find_index_out_of_palette(indices, w, h, palette_size) >= 0)
+                    return nullptr;
+                WriteFormat format = {palette_bit_depth(palette_size), palette_rgba, palette_size};
+                WriteRowSource source = {(const char *)indices, invertY, nullptr, nullptr, 0};
+                return write_png_memory(output_size, w, h, 1, format, source, options, start, stats);
+            }
+            //----------------------------------------------------------------------------------
+            char *writePNG16ToMemory(int *output_size, int w, int h, int chann, const uint16_t *buffer, const EncodeOptions &options, bool invertY, EncodeStats *stats)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                WriteRowSource source = {(const char *)buffer, invertY, nullptr, nullptr, 0};
+                return write_png_memory(output_size, w, h, chann, WRITE_FORMAT_16, source, options, start, stats);
             }
             //----------------------------------------------------------------------------------
             void closePNG(char *&buff)
             {
                 if (!buff)
                     return;
-                ITKCommon::Memory::free(buff);
+                freeBuffer(buff);
                 // delete[]buff;
                 buff = nullptr;
             }
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <InteractiveToolkit-Extension/image/PNG.h>
+
+#include <png.h>
+
+#include <vector>
+
+//
+// Helpers shared by the PNG sources, not part of the public interface.
+//
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+        namespace PNG
+        {
+            namespace detail
+            {
+                /// \private
+                ///
+                /// The palette candidate of PaletteMode::Auto, shared by the serial and parallel writers.
+                /// Gray images only try a palette when it needs less than 8 bits per index.
+                /// Returns false when the image has too many colors.
+                bool write_png_palette_candidate(std::vector<char> *output, int w, int h, int chann, const char *buffer,
+                                                 const EncodeOptions &options, bool invertY);
+
+                /// \private
+                ///
+                /// png_create_read_struct with the libpng internal memory (row buffers, zlib state)
+                /// going through the Image::Allocator current at creation, that allocator must
+                /// outlive the struct.
+                png_structp create_png_read_struct(png_voidp error_ptr, png_error_ptr error_fn, png_error_ptr warning_fn);
+            }
+        }
+    }
+}
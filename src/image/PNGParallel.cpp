@@ -0,0 +1,542 @@
+
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+#include "PNGInternal.h"
+#include <InteractiveToolkit/ITKCommon/StringUtil.h>
+
+#include <zlib.h>
+
+#include <InteractiveToolkit/ITKCommon/FileSystem/File.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+//
+// Parallel PNG encoder
+//
+// The image is split in strips of rows. Every strip is filtered and deflated
+// by a worker as a raw deflate stream ending with Z_SYNC_FLUSH (the last one
+// with Z_FINISH), so the concatenation of all strips is one valid deflate
+// stream. Each worker primes its stream with the last 32K of filtered data of
+// the previous strip, this keeps the ratio close to the serial encoder.
+//
+// The zlib header goes in front of the first strip and the adler32 of the
+// whole stream, combined from the per strip values, after the last one.
+// Every strip is written as its own IDAT chunk.
+//
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+        namespace PNG
+        {
+
+            /// \private
+            struct ParallelStrip
+            {
+                std::vector<uint8_t> data; // raw deflate output
+                uint32_t adler;            // adler32 of the filtered rows
+                uint32_t crc;              // crc32 of data
+                size_t filtered_size;
+                bool ok;
+            };
+
+            /// \private
+            struct ParallelEncoder
+            {
+                const uint8_t *buffer;
+                int w;
+                int h;
+                int chann;
+                bool invertY;
+
+                int level;
+                int strategy;
+                EncodeFilter filter;
+
+                size_t row_bytes;
+                int strip_rows;
+                int strip_count;
+
+                std::vector<ParallelStrip> strips;
+                std::atomic<int> next_strip;
+
+                const uint8_t *row(int y) const
+                {
+                    if (invertY)
+                        y = h - 1 - y;
+                    return buffer + (size_t)y * row_bytes;
+                }
+            };
+
+            static inline uint8_t paeth_predictor(int a, int b, int c)
+            {
+                int p = a + b - c;
+                int pa = abs(p - a);
+                int pb = abs(p - b);
+                int pc = abs(p - c);
+                if (pa <= pb && pa <= pc)
+                    return (uint8_t)a;
+                if (pb <= pc)
+                    return (uint8_t)b;
+                return (uint8_t)c;
+            }
+
+            // out[0] receives the filter type, out[1..row_bytes] the filtered bytes
+            static void filter_row(EncodeFilter filter, const uint8_t *cur, const uint8_t *prev, size_t row_bytes, int bpp, uint8_t *out)
+            {
+                uint8_t *dst = out + 1;
+                switch (filter)
+                {
+                case EncodeFilter::Sub:
+                    for (size_t i = 0; i < (size_t)bpp; i++)
+                        dst[i] = cur[i];
+                    for (size_t i = bpp; i < row_bytes; i++)
+                        dst[i] = (uint8_t)(cur[i] - cur[i - bpp]);
+                    break;
+                case EncodeFilter::Up:
+                    if (prev == nullptr)
+                    {
+                        memcpy(dst, cur, row_bytes);
+                        break;
+                    }
+                    for (size_t i = 0; i < row_bytes; i++)
+                        dst[i] = (uint8_t)(cur[i] - prev[i]);
+                    break;
+                case EncodeFilter::Average:
+                    for (size_t i = 0; i < row_bytes; i++)
+                    {
+                        int left = (i >= (size_t)bpp) ? cur[i - bpp] : 0;
+                        int up = (prev != nullptr) ? prev[i] : 0;
+                        dst[i] = (uint8_t)(cur[i] - ((left + up) >> 1));
+                    }
+                    break;
+                case EncodeFilter::Paeth:
+                    for (size_t i = 0; i < row_bytes; i++)
+                    {
+                        int left = (i >= (size_t)bpp) ? cur[i - bpp] : 0;
+                        int up = (prev != nullptr) ? prev[i] : 0;
+                        int up_left = (prev != nullptr && i >= (size_t)bpp) ? prev[i - bpp] : 0;
+                        dst[i] = (uint8_t)(cur[i] - paeth_predictor(left, up, up_left));
+                    }
+                    break;
+                default:
+                    filter = EncodeFilter::None;
+                    memcpy(dst, cur, row_bytes);
+                    break;
+                }
+                out[0] = (uint8_t)filter;
+            }
+
+            // Same heuristic as libpng: keep the filter with the minimum sum of
+            // absolute values, treating the bytes as signed.
+            static void filter_row_adaptive(const uint8_t *cur, const uint8_t *prev, size_t row_bytes, int bpp, uint8_t *out, uint8_t *scratch)
+            {
+                static const EncodeFilter candidates[] = {
+                    EncodeFilter::None,
+                    EncodeFilter::Sub,
+                    EncodeFilter::Up,
+                    EncodeFilter::Average,
+                    EncodeFilter::Paeth};
+
+                uint64_t best_sum = UINT64_MAX;
+                for (EncodeFilter candidate : candidates)
+                {
+                    filter_row(candidate, cur, prev, row_bytes, bpp, scratch);
+                    uint64_t sum = 0;
+                    for (size_t i = 1; i <= row_bytes; i++)
+                    {
+                        int v = (int8_t)scratch[i];
+                        sum += (uint64_t)((v < 0) ? -v : v);
+                    }
+                    if (sum < best_sum)
+                    {
+                        best_sum = sum;
+                        memcpy(out, scratch, row_bytes + 1);
+                    }
+                }
+            }
+
+            static void filter_rows(const ParallelEncoder *encoder, int first, int last, uint8_t *out, uint8_t *scratch)
+            {
+                size_t filtered_row_bytes = encoder->row_bytes + 1;
+                for (int y = first; y < last; y++)
+                {
+                    const uint8_t *prev = (y > 0) ? encoder->row(y - 1) : nullptr;
+                    uint8_t *dst = out + (size_t)(y - first) * filtered_row_bytes;
+                    if (encoder->filter == EncodeFilter::Adaptive)
+                        filter_row_adaptive(encoder->row(y), prev, encoder->row_bytes, encoder->chann, dst, scratch);
+                    else
+                        filter_row(encoder->filter, encoder->row(y), prev, encoder->row_bytes, encoder->chann, dst);
+                }
+            }
+
+            static void encode_strip(ParallelEncoder *encoder, int strip_index, std::vector<uint8_t> &filtered, std::vector<uint8_t> &scratch)
+            {
+                ParallelStrip &strip = encoder->strips[strip_index];
+                strip.ok = false;
+
+                const size_t window_size = 32768;
+                size_t filtered_row_bytes = encoder->row_bytes + 1;
+
+                int first = strip_index * encoder->strip_rows;
+                int last = std::min(first + encoder->strip_rows, encoder->h);
+
+                // rows of the previous strip needed to rebuild its last 32K of output
+                int dictionary_rows = 0;
+                if (first > 0)
+                    dictionary_rows = std::min(first, (int)((window_size + filtered_row_bytes - 1) / filtered_row_bytes));
+
+                size_t dictionary_size = (size_t)dictionary_rows * filtered_row_bytes;
+                size_t strip_size = (size_t)(last - first) * filtered_row_bytes;
+                filtered.resize(dictionary_size + strip_size);
+                filter_rows(encoder, first - dictionary_rows, last, filtered.data(), scratch.data());
+
+                const uint8_t *strip_data = filtered.data() + dictionary_size;
+                strip.filtered_size = strip_size;
+                strip.adler = (uint32_t)adler32(adler32(0L, Z_NULL, 0), strip_data, (uInt)strip_size);
+
+                z_stream stream;
+                memset(&stream, 0, sizeof(z_stream));
+                if (deflateInit2(&stream, encoder->level, Z_DEFLATED, -15, 8, encoder->strategy) != Z_OK)
+                    return;
+
+                if (dictionary_size > 0)
+                {
+                    size_t used = std::min(dictionary_size, window_size);
+                    deflateSetDictionary(&stream, strip_data - used, (uInt)used);
+                }
+
+                bool is_last = (strip_index == encoder->strip_count - 1);
+                strip.data.resize(deflateBound(&stream, (uLong)strip_size) + 16);
+
+                stream.next_in = (Bytef *)strip_data;
+                stream.avail_in = (uInt)strip_size;
+                stream.next_out = strip.data.data();
+                stream.avail_out = (uInt)strip.data.size();
+
+                int ret = deflate(&stream, is_last ? Z_FINISH : Z_SYNC_FLUSH);
+                bool done = is_last ? (ret == Z_STREAM_END) : (ret == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+                strip.data.resize(stream.total_out);
+                deflateEnd(&stream);
+                if (!done)
+                    return;
+
+                strip.crc = (uint32_t)crc32(crc32(0L, Z_NULL, 0), strip.data.data(), (uInt)strip.data.size());
+                strip.ok = true;
+            }
+
+            static void encode_worker(ParallelEncoder *encoder)
+            {
+                std::vector<uint8_t> filtered;
+                std::vector<uint8_t> scratch(encoder->row_bytes + 1);
+                while (true)
+                {
+                    int strip_index = encoder->next_strip.fetch_add(1);
+                    if (strip_index >= encoder->strip_count)
+                        break;
+                    encode_strip(encoder, strip_index, filtered, scratch);
+                }
+            }
+
+            static inline void put_u32_be(uint8_t *out, uint32_t v)
+            {
+                out[0] = (uint8_t)(v >> 24);
+                out[1] = (uint8_t)(v >> 16);
+                out[2] = (uint8_t)(v >> 8);
+                out[3] = (uint8_t)v;
+            }
+
+            /// \private
+            struct ChunkOutput
+            {
+                FILE *fp;
+                std::vector<char> *memory;
+                size_t written;
+                bool ok;
+
+                void write(const void *data, size_t size)
+                {
+                    if (!ok || size == 0)
+                        return;
+                    if (fp != nullptr)
+                        ok = fwrite(data, 1, size, fp) == size;
+                    else
+                        memory->insert(memory->end(), (const char *)data, (const char *)data + size);
+                    written += size;
+                }
+
+                // prefix and suffix are written around data inside the same chunk,
+                // data_crc is the crc32 of data alone
+                void chunk(const char type[4],
+                           const uint8_t *prefix, size_t prefix_size,
+                           const uint8_t *data, size_t data_size, uint32_t data_crc,
+                           const uint8_t *suffix, size_t suffix_size)
+                {
+                    uint8_t header[8];
+                    put_u32_be(header, (uint32_t)(prefix_size + data_size + suffix_size));
+                    memcpy(header + 4, type, 4);
+
+                    uLong crc = crc32(0L, Z_NULL, 0);
+                    crc = crc32(crc, header + 4, 4);
+                    if (prefix_size > 0)
+                        crc = crc32(crc, prefix, (uInt)prefix_size);
+                    if (data_size > 0)
+                        crc = crc32_combine(crc, data_crc, (z_off_t)data_size);
+                    if (suffix_size > 0)
+                        crc = crc32(crc, suffix, (uInt)suffix_size);
+
+                    uint8_t footer[4];
+                    put_u32_be(footer, (uint32_t)crc);
+
+                    write(header, 8);
+                    write(prefix, prefix_size);
+                    write(data, data_size);
+                    write(suffix, suffix_size);
+                    write(footer, 4);
+                }
+            };
+
+            static bool write_png_parallel(ChunkOutput *output, int w, int h, int chann, const char *buffer,
+                                           const EncodeOptions &options, bool invertY, int threadCount, std::string *errorStr)
+            {
+                if (w <= 0 || h <= 0 || chann < 1 || chann > 4 || buffer == nullptr)
+                {
+                    if (errorStr != nullptr)
+                        *errorStr = ITKCommon::PrintfToStdString("Invalid image w = %i, h = %i, chann = %i.\n", w, h, chann);
+                    return false;
+                }
+
+                ParallelEncoder encoder;
+                encoder.buffer = (const uint8_t *)buffer;
+                encoder.w = w;
+                encoder.h = h;
+                encoder.chann = chann;
+                encoder.invertY = invertY;
+                encoder.level = (options.compression_level < 0) ? Z_DEFAULT_COMPRESSION : std::min(options.compression_level, 9);
+                encoder.filter = options.filter;
+                switch (options.strategy)
+                {
+                case EncodeStrategy::Default:
+                    encoder.strategy = Z_DEFAULT_STRATEGY;
+                    break;
+                case EncodeStrategy::Filtered:
+                    encoder.strategy = Z_FILTERED;
+                    break;
+                case EncodeStrategy::HuffmanOnly:
+                    encoder.strategy = Z_HUFFMAN_ONLY;
+                    break;
+                case EncodeStrategy::RLE:
+                    encoder.strategy = Z_RLE;
+                    break;
+                case EncodeStrategy::Fixed:
+                    encoder.strategy = Z_FIXED;
+                    break;
+                default:
+                    // libpng uses Z_FILTERED for filtered data
+                    encoder.strategy = (options.filter == EncodeFilter::None) ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+                    break;
+                }
+
+                encoder.row_bytes = (size_t)w * chann;
+
+                // about 512K of filtered data per strip
+                encoder.strip_rows = (int)std::max((size_t)1, ((size_t)512 * 1024) / (encoder.row_bytes + 1));
+                encoder.strip_rows = std::min(encoder.strip_rows, h);
+                encoder.strip_count = (h + encoder.strip_rows - 1) / encoder.strip_rows;
+                encoder.strips.resize(encoder.strip_count);
+                encoder.next_strip = 0;
+
+                if (threadCount <= 0)
+                    threadCount = (int)std::thread::hardware_concurrency();
+                threadCount = std::max(1, std::min(threadCount, encoder.strip_count));
+
+                std::vector<std::thread> threads;
+                for (int i = 1; i < threadCount; i++)
+                    threads.push_back(std::thread(encode_worker, &encoder));
+                encode_worker(&encoder);
+                for (auto &thread : threads)
+                    thread.join();
+
+                uLong adler = adler32(0L, Z_NULL, 0);
+                for (const auto &strip : encoder.strips)
+                {
+                    if (!strip.ok)
+                    {
+                        if (errorStr != nullptr)
+                            *errorStr = ITKCommon::PrintfToStdString("Error on deflate\n");
+                        return false;
+                    }
+                    adler = adler32_combine(adler, strip.adler, (z_off_t)strip.filtered_size);
+                }
+
+                static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+                output->write(signature, 8);
+
+                uint8_t ihdr[13];
+                put_u32_be(ihdr, (uint32_t)w);
+                put_u32_be(ihdr + 4, (uint32_t)h);
+                static const uint8_t color_types[4] = {0, 4, 2, 6}; // gray, gray+alpha, rgb, rgba
+                ihdr[8] = 8;                      // bit depth
+                ihdr[9] = color_types[chann - 1]; // color type
+                ihdr[10] = 0;                     // compression method
+                ihdr[11] = 0;                     // filter method
+                ihdr[12] = 0;                     // interlace method
+                output->chunk("IHDR", nullptr, 0, ihdr, 13, (uint32_t)crc32(crc32(0L, Z_NULL, 0), ihdr, 13), nullptr, 0);
+
+                // zlib header: 32K window, FLEVEL from the compression level
+                int level = (encoder.level == Z_DEFAULT_COMPRESSION) ? 6 : encoder.level;
+                int flevel = (level <= 1) ? 0 : (level <= 5) ? 1
+                                            : (level == 6) ? 2
+                                                           : 3;
+                uint8_t zlib_header[2];
+                zlib_header[0] = 0x78;
+                zlib_header[1] = (uint8_t)(flevel << 6);
+                zlib_header[1] += (uint8_t)(31 - ((zlib_header[0] << 8) | zlib_header[1]) % 31);
+
+                uint8_t zlib_footer[4];
+                put_u32_be(zlib_footer, (uint32_t)adler);
+
+                for (int i = 0; i < encoder.strip_count; i++)
+                {
+                    const ParallelStrip &strip = encoder.strips[i];
+                    bool is_first = (i == 0);
+                    bool is_last = (i == encoder.strip_count - 1);
+                    output->chunk("IDAT",
+                                  is_first ? zlib_header : nullptr, is_first ? 2 : 0,
+                                  strip.data.data(), strip.data.size(), strip.crc,
+                                  is_last ? zlib_footer : nullptr, is_last ? 4 : 0);
+                }
+
+                output->chunk("IEND", nullptr, 0, nullptr, 0, 0, nullptr, 0);
+
+                if (!output->ok && errorStr != nullptr)
+                    *errorStr = ITKCommon::PrintfToStdString("Error writing PNG data\n");
+                return output->ok;
+            }
+
+            // PaletteMode::Auto: the palette image (serial, 1 to 8 bits per pixel) is tried
+            // after the parallel encode, the smaller output is kept
+            static bool write_png_parallel_auto(std::vector<char> *memory, int w, int h, int chann, const char *buffer,
+                                                const EncodeOptions &options, bool invertY, int threadCount, std::string *errorStr)
+            {
+                ChunkOutput output;
+                output.fp = nullptr;
+                output.memory = memory;
+                output.written = 0;
+                output.ok = true;
+
+                if (!write_png_parallel(&output, w, h, chann, buffer, options, invertY, threadCount, errorStr))
+                    return false;
+
+                std::vector<char> indexed;
+                if (detail::write_png_palette_candidate(&indexed, w, h, chann, buffer, options, invertY) &&
+                    indexed.size() < memory->size())
+                    memory->swap(indexed);
+                return true;
+            }
+
+            static double parallel_elapsed_ms(const std::chrono::steady_clock::time_point &start)
+            {
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            //----------------------------------------------------------------------------------
+            bool writePNGParallel(const char *file_name, int w, int h, int chann, const char *buffer, const EncodeOptions &options, bool invertY, int threadCount, EncodeStats *stats, std::string *errorStr)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+                if (options.palette == PaletteMode::Auto)
+                {
+                    std::vector<char> memory;
+                    if (!write_png_parallel_auto(&memory, w, h, chann, buffer, options, invertY, threadCount, errorStr))
+                        return false;
+                    FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "wb", errorStr);
+                    if (!fp)
+                        return false; // error
+                    bool result = fwrite(memory.data(), 1, memory.size(), fp) == memory.size();
+                    fclose(fp);
+                    if (!result)
+                    {
+                        if (errorStr != nullptr)
+                            *errorStr = ITKCommon::PrintfToStdString("Error writing %s\n", file_name);
+                        return false;
+                    }
+                    if (stats != nullptr)
+                    {
+                        stats->encode_ms = parallel_elapsed_ms(start);
+                        stats->output_size = memory.size();
+                    }
+                    return true;
+                }
+
+                FILE *fp = ITKCommon::FileSystem::File::fopen(file_name, "wb", errorStr);
+                if (!fp)
+                    return false; // error
+
+                ChunkOutput output;
+                output.fp = fp;
+                output.memory = nullptr;
+                output.written = 0;
+                output.ok = true;
+
+                bool result = write_png_parallel(&output, w, h, chann, buffer, options, invertY, threadCount, errorStr);
+                fclose(fp);
+
+                if (result && stats != nullptr)
+                {
+                    stats->encode_ms = parallel_elapsed_ms(start);
+                    stats->output_size = output.written;
+                }
+                return result;
+            }
+            //----------------------------------------------------------------------------------
+            char *writePNGToMemoryParallel(int *output_size, int w, int h, int chann, const char *buffer, const EncodeOptions &options, bool invertY, int threadCount, EncodeStats *stats)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                std::vector<char> memory;
+
+                bool result;
+                if (options.palette == PaletteMode::Auto)
+                    result = write_png_parallel_auto(&memory, w, h, chann, buffer, options, invertY, threadCount, nullptr);
+                else
+                {
+                    ChunkOutput output;
+                    output.fp = nullptr;
+                    output.memory = &memory;
+                    output.written = 0;
+                    output.ok = true;
+                    result = write_png_parallel(&output, w, h, chann, buffer, options, invertY, threadCount, nullptr);
+                }
+
+                if (!result)
+                {
+                    *output_size = 0;
+                    return nullptr;
+                }
+
+                *output_size = (int)memory.size();
+                char *outputBuffer = (char *)allocBuffer(memory.size());
+                memcpy(outputBuffer, memory.data(), memory.size());
+
+                if (stats != nullptr)
+                {
+                    stats->encode_ms = parallel_elapsed_ms(start);
+                    stats->output_size = memory.size();
+                }
+                return outputBuffer;
+            }
+
+        }
+    }
+}
@@ -0,0 +1,629 @@
+#include <InteractiveToolkit-Extension/image/PixelFormat.h>
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_FORMAT_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define PIXEL_FORMAT_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PIXEL_FORMAT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+        namespace PixelFormat
+        {
+
+            // round(v * a / 255) for v, a in 0..255
+            static inline uint8_t mul_div_255(uint32_t v, uint32_t a)
+            {
+                uint32_t t = v * a + 128;
+                return (uint8_t)((t + (t >> 8)) >> 8);
+            }
+
+            /// \private
+            typedef void (*RowFunction)(const uint8_t *src, uint8_t *dst, int count);
+
+            //----------------------------------------------------------------------------------
+            // expand
+            //----------------------------------------------------------------------------------
+
+            static void row_1_to_4(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x4_t px;
+                    px.val[0] = px.val[1] = px.val[2] = vld1q_u8(&src[i]);
+                    px.val[3] = vdupq_n_u8(0xff);
+                    vst4q_u8(&dst[i * 4], px);
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                const __m128i alpha = _mm_set1_epi8((char)0xff);
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m128i g = _mm_loadu_si128((const __m128i *)&src[i]);
+                    __m128i gg_lo = _mm_unpacklo_epi8(g, g);
+                    __m128i gg_hi = _mm_unpackhi_epi8(g, g);
+                    __m128i ga_lo = _mm_unpacklo_epi8(g, alpha);
+                    __m128i ga_hi = _mm_unpackhi_epi8(g, alpha);
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 0], _mm_unpacklo_epi16(gg_lo, ga_lo));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 16], _mm_unpackhi_epi16(gg_lo, ga_lo));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 32], _mm_unpacklo_epi16(gg_hi, ga_hi));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 48], _mm_unpackhi_epi16(gg_hi, ga_hi));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    uint8_t g = src[i];
+                    dst[i * 4 + 0] = g;
+                    dst[i * 4 + 1] = g;
+                    dst[i * 4 + 2] = g;
+                    dst[i * 4 + 3] = 0xff;
+                }
+            }
+
+            static void row_1_to_3(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x3_t px;
+                    px.val[0] = px.val[1] = px.val[2] = vld1q_u8(&src[i]);
+                    vst3q_u8(&dst[i * 3], px);
+                }
+#elif defined(PIXEL_FORMAT_SSSE3)
+                // target byte k receives gray k / 3
+                const __m128i m0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+                const __m128i m1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+                const __m128i m2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m128i g = _mm_loadu_si128((const __m128i *)&src[i]);
+                    _mm_storeu_si128((__m128i *)&dst[i * 3 + 0], _mm_shuffle_epi8(g, m0));
+                    _mm_storeu_si128((__m128i *)&dst[i * 3 + 16], _mm_shuffle_epi8(g, m1));
+                    _mm_storeu_si128((__m128i *)&dst[i * 3 + 32], _mm_shuffle_epi8(g, m2));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    uint8_t g = src[i];
+                    dst[i * 3 + 0] = g;
+                    dst[i * 3 + 1] = g;
+                    dst[i * 3 + 2] = g;
+                }
+            }
+
+            static void row_3_to_4(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x3_t rgb = vld3q_u8(&src[i * 3]);
+                    uint8x16x4_t px;
+                    px.val[0] = rgb.val[0];
+                    px.val[1] = rgb.val[1];
+                    px.val[2] = rgb.val[2];
+                    px.val[3] = vdupq_n_u8(0xff);
+                    vst4q_u8(&dst[i * 4], px);
+                }
+#elif defined(PIXEL_FORMAT_SSSE3)
+                const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+                const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m128i a = _mm_loadu_si128((const __m128i *)&src[i * 3 + 0]);
+                    __m128i b = _mm_loadu_si128((const __m128i *)&src[i * 3 + 16]);
+                    __m128i c = _mm_loadu_si128((const __m128i *)&src[i * 3 + 32]);
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 0], _mm_or_si128(_mm_shuffle_epi8(a, mask), alpha));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 16], _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), mask), alpha));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 32], _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), mask), alpha));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 48], _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), mask), alpha));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    dst[i * 4 + 0] = src[i * 3 + 0];
+                    dst[i * 4 + 1] = src[i * 3 + 1];
+                    dst[i * 4 + 2] = src[i * 3 + 2];
+                    dst[i * 4 + 3] = 0xff;
+                }
+            }
+
+            static void row_1_to_2(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x2_t px;
+                    px.val[0] = vld1q_u8(&src[i]);
+                    px.val[1] = vdupq_n_u8(0xff);
+                    vst2q_u8(&dst[i * 2], px);
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                const __m128i alpha = _mm_set1_epi8((char)0xff);
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m128i g = _mm_loadu_si128((const __m128i *)&src[i]);
+                    _mm_storeu_si128((__m128i *)&dst[i * 2 + 0], _mm_unpacklo_epi8(g, alpha));
+                    _mm_storeu_si128((__m128i *)&dst[i * 2 + 16], _mm_unpackhi_epi8(g, alpha));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    dst[i * 2 + 0] = src[i];
+                    dst[i * 2 + 1] = 0xff;
+                }
+            }
+
+            static void row_2_to_4(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x2_t ga = vld2q_u8(&src[i * 2]);
+                    uint8x16x4_t px;
+                    px.val[0] = px.val[1] = px.val[2] = ga.val[0];
+                    px.val[3] = ga.val[1];
+                    vst4q_u8(&dst[i * 4], px);
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                for (; i + 8 <= count; i += 8)
+                {
+                    // 16 bit lanes: g | a << 8
+                    __m128i ga = _mm_loadu_si128((const __m128i *)&src[i * 2]);
+                    __m128i g = _mm_and_si128(ga, _mm_set1_epi16(0x00ff));
+                    __m128i gg = _mm_or_si128(g, _mm_slli_epi16(g, 8));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 0], _mm_unpacklo_epi16(gg, ga));
+                    _mm_storeu_si128((__m128i *)&dst[i * 4 + 16], _mm_unpackhi_epi16(gg, ga));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    uint8_t g = src[i * 2 + 0];
+                    dst[i * 4 + 0] = g;
+                    dst[i * 4 + 1] = g;
+                    dst[i * 4 + 2] = g;
+                    dst[i * 4 + 3] = src[i * 2 + 1];
+                }
+            }
+
+            static void row_2_to_3(const uint8_t *src, uint8_t *dst, int count)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    uint8_t g = src[i * 2 + 0];
+                    dst[i * 3 + 0] = g;
+                    dst[i * 3 + 1] = g;
+                    dst[i * 3 + 2] = g;
+                }
+            }
+
+            static void row_3_to_2(const uint8_t *src, uint8_t *dst, int count)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    dst[i * 2 + 0] = src[i * 3 + 0];
+                    dst[i * 2 + 1] = 0xff;
+                }
+            }
+
+            //----------------------------------------------------------------------------------
+            // pack
+            //----------------------------------------------------------------------------------
+
+            static void row_4_to_3(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x4_t px = vld4q_u8(&src[i * 4]);
+                    uint8x16x3_t rgb;
+                    rgb.val[0] = px.val[0];
+                    rgb.val[1] = px.val[1];
+                    rgb.val[2] = px.val[2];
+                    vst3q_u8(&dst[i * 3], rgb);
+                }
+#elif defined(PIXEL_FORMAT_SSSE3)
+                // each 4 pixels pack to 12 bytes in the low part of the register
+                const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&src[i * 4 + 0]), mask);
+                    __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&src[i * 4 + 16]), mask);
+                    __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&src[i * 4 + 32]), mask);
+                    __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&src[i * 4 + 48]), mask);
+                    _mm_storeu_si128((__m128i *)&dst[i * 3 + 0], _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+                    _mm_storeu_si128((__m128i *)&dst[i * 3 + 16], _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+                    _mm_storeu_si128((__m128i *)&dst[i * 3 + 32], _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    dst[i * 3 + 0] = src[i * 4 + 0];
+                    dst[i * 3 + 1] = src[i * 4 + 1];
+                    dst[i * 3 + 2] = src[i * 4 + 2];
+                }
+            }
+
+            static void row_4_to_2(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x4_t px = vld4q_u8(&src[i * 4]);
+                    uint8x16x2_t ga;
+                    ga.val[0] = px.val[0];
+                    ga.val[1] = px.val[3];
+                    vst2q_u8(&dst[i * 2], ga);
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                const __m128i low = _mm_set1_epi32(0x000000ff);
+                const __m128i bias32 = _mm_set1_epi32(0x8000);
+                const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m128i p0 = _mm_loadu_si128((const __m128i *)&src[i * 4 + 0]);
+                    __m128i p1 = _mm_loadu_si128((const __m128i *)&src[i * 4 + 16]);
+                    // 32 bit lanes: r | a << 8
+                    p0 = _mm_or_si128(_mm_and_si128(p0, low), _mm_slli_epi32(_mm_srli_epi32(p0, 24), 8));
+                    p1 = _mm_or_si128(_mm_and_si128(p1, low), _mm_slli_epi32(_mm_srli_epi32(p1, 24), 8));
+                    // packs_epi32 saturates signed values, move the range before packing
+                    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(p0, bias32), _mm_sub_epi32(p1, bias32));
+                    _mm_storeu_si128((__m128i *)&dst[i * 2], _mm_add_epi16(packed, bias16));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    dst[i * 2 + 0] = src[i * 4 + 0];
+                    dst[i * 2 + 1] = src[i * 4 + 3];
+                }
+            }
+
+            static void row_extract_4(const uint8_t *src, uint8_t *dst, int count, int channel)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x4_t px = vld4q_u8(&src[i * 4]);
+                    vst1q_u8(&dst[i], px.val[channel]);
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                const __m128i low = _mm_set1_epi32(0x000000ff);
+                const __m128i shift = _mm_cvtsi32_si128(channel * 8);
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m128i p0 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)&src[i * 4 + 0]), shift), low);
+                    __m128i p1 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)&src[i * 4 + 16]), shift), low);
+                    __m128i p2 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)&src[i * 4 + 32]), shift), low);
+                    __m128i p3 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)&src[i * 4 + 48]), shift), low);
+                    _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+                }
+#endif
+                for (; i < count; i++)
+                    dst[i] = src[i * 4 + channel];
+            }
+
+            static void row_extract_3(const uint8_t *src, uint8_t *dst, int count, int channel)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x3_t px = vld3q_u8(&src[i * 3]);
+                    vst1q_u8(&dst[i], px.val[channel]);
+                }
+#endif
+                for (; i < count; i++)
+                    dst[i] = src[i * 3 + channel];
+            }
+
+            static void row_extract_2(const uint8_t *src, uint8_t *dst, int count, int channel)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x2_t px = vld2q_u8(&src[i * 2]);
+                    vst1q_u8(&dst[i], px.val[channel]);
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                const __m128i low = _mm_set1_epi16(0x00ff);
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m128i p0 = _mm_loadu_si128((const __m128i *)&src[i * 2 + 0]);
+                    __m128i p1 = _mm_loadu_si128((const __m128i *)&src[i * 2 + 16]);
+                    if (channel != 0)
+                    {
+                        p0 = _mm_srli_epi16(p0, 8);
+                        p1 = _mm_srli_epi16(p1, 8);
+                    }
+                    _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(_mm_and_si128(p0, low), _mm_and_si128(p1, low)));
+                }
+#endif
+                for (; i < count; i++)
+                    dst[i] = src[i * 2 + channel];
+            }
+
+            static void row_4_to_1(const uint8_t *src, uint8_t *dst, int count)
+            {
+                row_extract_4(src, dst, count, 0);
+            }
+
+            static void row_3_to_1(const uint8_t *src, uint8_t *dst, int count)
+            {
+                row_extract_3(src, dst, count, 0);
+            }
+
+            static void row_2_to_1(const uint8_t *src, uint8_t *dst, int count)
+            {
+                row_extract_2(src, dst, count, 0);
+            }
+
+            //----------------------------------------------------------------------------------
+            // alpha
+            //----------------------------------------------------------------------------------
+
+            static void row_premultiply(const uint8_t *src, uint8_t *dst, int count)
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x4_t px = vld4q_u8(&src[i * 4]);
+                    uint8x8_t a_lo = vget_low_u8(px.val[3]);
+                    uint8x8_t a_hi = vget_high_u8(px.val[3]);
+                    for (int c = 0; c < 3; c++)
+                    {
+                        // (t + ((t + 128) >> 8) + 128) >> 8, the same as mul_div_255
+                        uint16x8_t t_lo = vmull_u8(vget_low_u8(px.val[c]), a_lo);
+                        uint16x8_t t_hi = vmull_u8(vget_high_u8(px.val[c]), a_hi);
+                        px.val[c] = vcombine_u8(vraddhn_u16(t_lo, vrshrq_n_u16(t_lo, 8)),
+                                                vraddhn_u16(t_hi, vrshrq_n_u16(t_hi, 8)));
+                    }
+                    vst4q_u8(&dst[i * 4], px);
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i alpha_lanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+                const __m128i alpha_255 = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+                const __m128i round = _mm_set1_epi16(128);
+                for (; i + 4 <= count; i += 4)
+                {
+                    __m128i px = _mm_loadu_si128((const __m128i *)&src[i * 4]);
+                    __m128i lo = _mm_unpacklo_epi8(px, zero);
+                    __m128i hi = _mm_unpackhi_epi8(px, zero);
+                    // broadcast alpha to the color lanes, alpha itself is multiplied by 255
+                    __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                    __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                    a_lo = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a_lo), alpha_255);
+                    a_hi = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a_hi), alpha_255);
+                    __m128i t_lo = _mm_add_epi16(_mm_mullo_epi16(lo, a_lo), round);
+                    __m128i t_hi = _mm_add_epi16(_mm_mullo_epi16(hi, a_hi), round);
+                    t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+                    t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+                    _mm_storeu_si128((__m128i *)&dst[i * 4], _mm_packus_epi16(t_lo, t_hi));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    uint32_t a = src[i * 4 + 3];
+                    dst[i * 4 + 0] = mul_div_255(src[i * 4 + 0], a);
+                    dst[i * 4 + 1] = mul_div_255(src[i * 4 + 1], a);
+                    dst[i * 4 + 2] = mul_div_255(src[i * 4 + 2], a);
+                    dst[i * 4 + 3] = (uint8_t)a;
+                }
+            }
+
+            /// \private
+            ///
+            /// ceil(2^24 / a): for n < 2^16, (n * table[a]) >> 24 == n / a,
+            /// so the division by alpha becomes a multiplication.
+            ///
+            struct ReciprocalTable
+            {
+                uint32_t value[256];
+                ReciprocalTable()
+                {
+                    value[0] = 0;
+                    for (uint32_t a = 1; a < 256; a++)
+                        value[a] = ((1u << 24) + a - 1) / a;
+                }
+            };
+
+            static void row_unpremultiply(const uint8_t *src, uint8_t *dst, int count)
+            {
+                static const ReciprocalTable reciprocal;
+                for (int i = 0; i < count; i++)
+                {
+                    uint32_t a = src[i * 4 + 3];
+                    uint64_t r = reciprocal.value[a];
+                    for (int c = 0; c < 3; c++)
+                    {
+                        uint32_t v = src[i * 4 + c];
+                        uint32_t n = v * 255 + (a >> 1);
+                        uint32_t result = (uint32_t)(((uint64_t)n * r) >> 24);
+                        dst[i * 4 + c] = (uint8_t)((result > 255) ? 255 : result);
+                    }
+                    dst[i * 4 + 3] = (uint8_t)a;
+                }
+            }
+
+            //----------------------------------------------------------------------------------
+            // swizzle
+            //----------------------------------------------------------------------------------
+
+            static void row_swizzle(const uint8_t *src, uint8_t *dst, int count, const int order[4])
+            {
+                int i = 0;
+#if defined(PIXEL_FORMAT_NEON)
+                for (; i + 16 <= count; i += 16)
+                {
+                    uint8x16x4_t px = vld4q_u8(&src[i * 4]);
+                    uint8x16x4_t out;
+                    out.val[0] = px.val[order[0]];
+                    out.val[1] = px.val[order[1]];
+                    out.val[2] = px.val[order[2]];
+                    out.val[3] = px.val[order[3]];
+                    vst4q_u8(&dst[i * 4], out);
+                }
+#elif defined(PIXEL_FORMAT_SSSE3)
+                const __m128i mask = _mm_setr_epi8(
+                    (char)(order[0] + 0), (char)(order[1] + 0), (char)(order[2] + 0), (char)(order[3] + 0),
+                    (char)(order[0] + 4), (char)(order[1] + 4), (char)(order[2] + 4), (char)(order[3] + 4),
+                    (char)(order[0] + 8), (char)(order[1] + 8), (char)(order[2] + 8), (char)(order[3] + 8),
+                    (char)(order[0] + 12), (char)(order[1] + 12), (char)(order[2] + 12), (char)(order[3] + 12));
+                for (; i + 4 <= count; i += 4)
+                {
+                    __m128i px = _mm_loadu_si128((const __m128i *)&src[i * 4]);
+                    _mm_storeu_si128((__m128i *)&dst[i * 4], _mm_shuffle_epi8(px, mask));
+                }
+#elif defined(PIXEL_FORMAT_SSE2)
+                // without pshufb only the R <-> B swap is vectorized
+                if (order[0] == 2 && order[1] == 1 && order[2] == 0 && order[3] == 3)
+                {
+                    const __m128i keep = _mm_set1_epi32((int)0xff00ff00);
+                    const __m128i low = _mm_set1_epi32(0x000000ff);
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        __m128i px = _mm_loadu_si128((const __m128i *)&src[i * 4]);
+                        __m128i r_to_b = _mm_slli_epi32(_mm_and_si128(px, low), 16);
+                        __m128i b_to_r = _mm_and_si128(_mm_srli_epi32(px, 16), low);
+                        _mm_storeu_si128((__m128i *)&dst[i * 4], _mm_or_si128(_mm_and_si128(px, keep), _mm_or_si128(r_to_b, b_to_r)));
+                    }
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    uint8_t px[4] = {src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2], src[i * 4 + 3]};
+                    dst[i * 4 + 0] = px[order[0]];
+                    dst[i * 4 + 1] = px[order[1]];
+                    dst[i * 4 + 2] = px[order[2]];
+                    dst[i * 4 + 3] = px[order[3]];
+                }
+            }
+
+            //----------------------------------------------------------------------------------
+            // rows loop
+            //----------------------------------------------------------------------------------
+
+            // Contiguous images are processed as one long row, so narrow images
+            // still run in the vector loop.
+            template <typename RowCall>
+            static void for_each_row(const uint8_t *src, size_t src_stride, size_t src_pixel,
+                                     uint8_t *dst, size_t dst_stride, size_t dst_pixel,
+                                     int w, int h, const RowCall &row)
+            {
+                if (w <= 0 || h <= 0)
+                    return;
+                if (src_stride == (size_t)w * src_pixel && dst_stride == (size_t)w * dst_pixel &&
+                    (size_t)w * (size_t)h <= 0x7fffffff)
+                {
+                    row(src, dst, w * h);
+                    return;
+                }
+                for (int y = 0; y < h; y++)
+                    row(&src[(size_t)y * src_stride], &dst[(size_t)y * dst_stride], w);
+            }
+
+            static RowFunction select_row_function(int src_chann, int dst_chann)
+            {
+                static const RowFunction table[4][4] = {
+                    // dst:     1           2           3           4
+                    {nullptr, row_1_to_2, row_1_to_3, row_1_to_4}, // src 1
+                    {row_2_to_1, nullptr, row_2_to_3, row_2_to_4}, // src 2
+                    {row_3_to_1, row_3_to_2, nullptr, row_3_to_4}, // src 3
+                    {row_4_to_1, row_4_to_2, row_4_to_3, nullptr}, // src 4
+                };
+                return table[src_chann - 1][dst_chann - 1];
+            }
+
+            bool convert(const uint8_t *src, int src_chann, size_t src_stride,
+                         uint8_t *dst, int dst_chann, size_t dst_stride,
+                         int w, int h)
+            {
+                if (src_chann < 1 || src_chann > 4 || dst_chann < 1 || dst_chann > 4)
+                    return false;
+
+                if (src_chann == dst_chann)
+                {
+                    for_each_row(src, src_stride, src_chann, dst, dst_stride, dst_chann, w, h,
+                                 [src_chann](const uint8_t *s, uint8_t *d, int count)
+                                 {
+                                     if (s != d)
+                                         memcpy(d, s, (size_t)count * src_chann);
+                                 });
+                    return true;
+                }
+
+                RowFunction function = select_row_function(src_chann, dst_chann);
+                for_each_row(src, src_stride, src_chann, dst, dst_stride, dst_chann, w, h, function);
+                return true;
+            }
+
+            void extractChannel(const uint8_t *src, int src_chann, int channel, size_t src_stride,
+                                uint8_t *dst, size_t dst_stride,
+                                int w, int h)
+            {
+                if (channel < 0 || channel >= src_chann)
+                    return;
+                for_each_row(src, src_stride, src_chann, dst, dst_stride, 1, w, h,
+                             [src_chann, channel](const uint8_t *s, uint8_t *d, int count)
+                             {
+                                 if (src_chann == 4)
+                                     row_extract_4(s, d, count, channel);
+                                 else if (src_chann == 3)
+                                     row_extract_3(s, d, count, channel);
+                                 else if (src_chann == 2)
+                                     row_extract_2(s, d, count, channel);
+                                 else
+                                     memcpy(d, s, count);
+                             });
+            }
+
+            void swizzle(const uint8_t *src, size_t src_stride,
+                         uint8_t *dst, size_t dst_stride,
+                         int w, int h,
+                         int order_0, int order_1, int order_2, int order_3)
+            {
+                int order[4] = {order_0 & 3, order_1 & 3, order_2 & 3, order_3 & 3};
+                for_each_row(src, src_stride, 4, dst, dst_stride, 4, w, h,
+                             [&order](const uint8_t *s, uint8_t *d, int count)
+                             { row_swizzle(s, d, count, order); });
+            }
+
+            void premultiplyAlpha(const uint8_t *src, size_t src_stride,
+                                  uint8_t *dst, size_t dst_stride,
+                                  int w, int h)
+            {
+                for_each_row(src, src_stride, 4, dst, dst_stride, 4, w, h, row_premultiply);
+            }
+
+            void unpremultiplyAlpha(const uint8_t *src, size_t src_stride,
+                                    uint8_t *dst, size_t dst_stride,
+                                    int w, int h)
+            {
+                for_each_row(src, src_stride, 4, dst, dst_stride, 4, w, h, row_unpremultiply);
+            }
+
+        }
+    }
+}
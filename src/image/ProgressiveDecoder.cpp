@@ -0,0 +1,480 @@
+#include <InteractiveToolkit-Extension/image/ProgressiveDecoder.h>
+#include "PNGInternal.h"
+
+#include <png.h>
+#include <jpeglib.h>
+#include <setjmp.h>
+
+#include <string.h>
+#include <vector>
+
+#ifndef png_jmpbuf
+#define png_jmpbuf(png_ptr) ((png_ptr)->jmpbuf)
+#endif
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+
+        /// \private
+        struct ProgressiveDecoder::State
+        {
+            FileFormat format;
+            bool invertY;
+            bool complete;
+            bool failed;
+            std::string error;
+            uint32_t update_count;
+            bool updated; // pixels written during the current append
+
+            Image output;
+            Image target; // output, or a flipped view of it with invertY
+
+            std::vector<uint8_t> signature; // first bytes, until the format is known
+
+            // PNG
+            png_structp png_ptr;
+            png_infop info_ptr;
+
+            // JPG
+            struct ErrorManager
+            {
+                struct jpeg_error_mgr pub;
+                jmp_buf setjmp_buffer;
+                State *state;
+            };
+            enum class JPGStage : int
+            {
+                Header,
+                Start,
+                Output,
+                Done
+            };
+            bool jpg_created;
+            struct jpeg_decompress_struct cinfo;
+            ErrorManager jerr;
+            struct jpeg_source_mgr src;
+            std::vector<uint8_t> jpg_input; // bytes libjpeg has not consumed yet
+            size_t jpg_skip;                // bytes skip_input_data could not skip yet
+            JPGStage jpg_stage;
+            bool jpg_output_active;
+            int jpg_shown_scan;
+
+            State(bool invertY);
+            ~State();
+
+            bool allocate(int w, int h, int chann, int pixel_depth);
+            bool fail(const std::string &message);
+
+            bool start(FileFormat format);
+            bool decode(const uint8_t *data, size_t size);
+            bool decode_png(const uint8_t *data, size_t size);
+            bool decode_jpg(const uint8_t *data, size_t size);
+            bool run_jpg();
+        };
+
+        //----------------------------------------------------------------------------------
+        // PNG progressive reader callbacks
+        //----------------------------------------------------------------------------------
+
+        /// \private
+        static void png_error_progressive(png_structp png_ptr, png_const_charp msg)
+        {
+            ProgressiveDecoder::State *state = (ProgressiveDecoder::State *)png_get_error_ptr(png_ptr);
+            state->error = std::string("PNG: ") + msg + "\n";
+            png_longjmp(png_ptr, 1);
+        }
+
+        /// \private
+        static void png_warning_progressive(png_structp png_ptr, png_const_charp msg)
+        {
+            (void)png_ptr;
+            (void)msg;
+        }
+
+        /// \private
+        static void png_info_progressive(png_structp png_ptr, png_infop info_ptr)
+        {
+            ProgressiveDecoder::State *state = (ProgressiveDecoder::State *)png_get_progressive_ptr(png_ptr);
+
+            // palette to RGB, gray 1/2/4 bits to 8 bits, tRNS to alpha
+            png_set_expand(png_ptr);
+            if (png_get_bit_depth(png_ptr, info_ptr) == 16)
+                png_set_swap(png_ptr);
+            png_set_interlace_handling(png_ptr);
+            png_read_update_info(png_ptr, info_ptr);
+
+            if (!state->allocate((int)png_get_image_width(png_ptr, info_ptr),
+                                 (int)png_get_image_height(png_ptr, info_ptr),
+                                 (int)png_get_channels(png_ptr, info_ptr),
+                                 (int)png_get_bit_depth(png_ptr, info_ptr)))
+                png_error(png_ptr, "invalid image size");
+        }
+
+        /// \private
+        ///
+        /// For Adam7 images libpng gives each pass row to all the rows of its block,
+        /// and png_progressive_combine_row also fills the block horizontally,
+        /// so the early passes already show up scaled to blocks.
+        static void png_row_progressive(png_structp png_ptr, png_bytep new_row, png_uint_32 row_num, int pass)
+        {
+            (void)pass;
+            ProgressiveDecoder::State *state = (ProgressiveDecoder::State *)png_get_progressive_ptr(png_ptr);
+            if (new_row == nullptr)
+                return;
+            png_progressive_combine_row(png_ptr, state->target.row((int)row_num), new_row);
+            state->updated = true;
+        }
+
+        /// \private
+        static void png_end_progressive(png_structp png_ptr, png_infop info_ptr)
+        {
+            (void)info_ptr;
+            ProgressiveDecoder::State *state = (ProgressiveDecoder::State *)png_get_progressive_ptr(png_ptr);
+            state->complete = true;
+        }
+
+        //----------------------------------------------------------------------------------
+        // JPG suspending source and error manager
+        //----------------------------------------------------------------------------------
+
+        /// \private
+        static void jpg_error_exit(j_common_ptr cinfo)
+        {
+            ProgressiveDecoder::State::ErrorManager *err = (ProgressiveDecoder::State::ErrorManager *)cinfo->err;
+            char message[JMSG_LENGTH_MAX];
+            (*cinfo->err->format_message)(cinfo, message);
+            err->state->error = std::string("JPG: ") + message + "\n";
+            longjmp(err->setjmp_buffer, 1);
+        }
+
+        /// \private
+        static void jpg_output_message(j_common_ptr cinfo)
+        {
+            (void)cinfo;
+        }
+
+        /// \private
+        static void jpg_init_source(j_decompress_ptr cinfo)
+        {
+            (void)cinfo;
+        }
+
+        /// \private
+        ///
+        /// Returning FALSE suspends the decoder, it resumes on the next append.
+        static boolean jpg_fill_input_buffer(j_decompress_ptr cinfo)
+        {
+            (void)cinfo;
+            return FALSE;
+        }
+
+        /// \private
+        static void jpg_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
+        {
+            if (num_bytes <= 0)
+                return;
+            ProgressiveDecoder::State::ErrorManager *err = (ProgressiveDecoder::State::ErrorManager *)cinfo->err;
+            struct jpeg_source_mgr *src = cinfo->src;
+            if ((size_t)num_bytes <= src->bytes_in_buffer)
+            {
+                src->next_input_byte += num_bytes;
+                src->bytes_in_buffer -= (size_t)num_bytes;
+                return;
+            }
+            err->state->jpg_skip += (size_t)num_bytes - src->bytes_in_buffer;
+            src->next_input_byte += src->bytes_in_buffer;
+            src->bytes_in_buffer = 0;
+        }
+
+        /// \private
+        static void jpg_term_source(j_decompress_ptr cinfo)
+        {
+            (void)cinfo;
+        }
+
+        //----------------------------------------------------------------------------------
+        // State
+        //----------------------------------------------------------------------------------
+
+        ProgressiveDecoder::State::State(bool invertY)
+        {
+            format = FileFormat::Unknown;
+            this->invertY = invertY;
+            complete = false;
+            failed = false;
+            update_count = 0;
+            updated = false;
+
+            png_ptr = nullptr;
+            info_ptr = nullptr;
+
+            jpg_created = false;
+            jpg_skip = 0;
+            jpg_stage = JPGStage::Header;
+            jpg_output_active = false;
+            jpg_shown_scan = 0;
+        }
+
+        ProgressiveDecoder::State::~State()
+        {
+            if (png_ptr != nullptr)
+                png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+            if (jpg_created)
+                jpeg_destroy_decompress(&cinfo);
+        }
+
+        bool ProgressiveDecoder::State::allocate(int w, int h, int chann, int pixel_depth)
+        {
+            output = Image::Create(w, h, chann, pixel_depth);
+            if (output.empty())
+                return false;
+            memset(output.data, 0, output.rowBytes() * (size_t)h);
+            target = (invertY) ? output.flipY() : output;
+            return true;
+        }
+
+        bool ProgressiveDecoder::State::fail(const std::string &message)
+        {
+            if (error.empty())
+                error = message;
+            failed = true;
+            return false;
+        }
+
+        bool ProgressiveDecoder::State::start(FileFormat format)
+        {
+            this->format = format;
+            if (format == FileFormat::PNG)
+            {
+                png_ptr = PNG::detail::create_png_read_struct(this, png_error_progressive, png_warning_progressive);
+                if (png_ptr == nullptr)
+                    return fail("Error on png_create_read_struct\n");
+                info_ptr = png_create_info_struct(png_ptr);
+                if (info_ptr == nullptr)
+                    return fail("Error on png_create_info_struct\n");
+                png_set_progressive_read_fn(png_ptr, this, png_info_progressive, png_row_progressive, png_end_progressive);
+                return true;
+            }
+            if (format == FileFormat::JPG)
+            {
+                cinfo.err = jpeg_std_error(&jerr.pub);
+                jerr.pub.error_exit = jpg_error_exit;
+                jerr.pub.output_message = jpg_output_message;
+                jerr.state = this;
+                if (setjmp(jerr.setjmp_buffer))
+                    return fail("JPG Signaled an Error.\n");
+                jpeg_create_decompress(&cinfo);
+                jpg_created = true;
+
+                src.init_source = jpg_init_source;
+                src.fill_input_buffer = jpg_fill_input_buffer;
+                src.skip_input_data = jpg_skip_input_data;
+                src.resync_to_restart = jpeg_resync_to_restart;
+                src.term_source = jpg_term_source;
+                src.next_input_byte = nullptr;
+                src.bytes_in_buffer = 0;
+                cinfo.src = &src;
+                return true;
+            }
+            return fail("Unknown image format.\n");
+        }
+
+        bool ProgressiveDecoder::State::decode(const uint8_t *data, size_t size)
+        {
+            if (size == 0 || complete)
+                return true;
+            if (format == FileFormat::PNG)
+                return decode_png(data, size);
+            return decode_jpg(data, size);
+        }
+
+        bool ProgressiveDecoder::State::decode_png(const uint8_t *data, size_t size)
+        {
+            if (setjmp(png_jmpbuf(png_ptr)))
+                return fail("Error on png setjmp\n");
+            png_process_data(png_ptr, info_ptr, (png_bytep)data, size);
+            return true;
+        }
+
+        bool ProgressiveDecoder::State::decode_jpg(const uint8_t *data, size_t size)
+        {
+            // drop what libjpeg consumed, it never reads before next_input_byte again
+            size_t consumed = jpg_input.size() - src.bytes_in_buffer;
+            jpg_input.erase(jpg_input.begin(), jpg_input.begin() + consumed);
+
+            size_t skip = (jpg_skip < size) ? jpg_skip : size;
+            jpg_skip -= skip;
+            jpg_input.insert(jpg_input.end(), data + skip, data + size);
+
+            src.next_input_byte = jpg_input.data();
+            src.bytes_in_buffer = jpg_input.size();
+
+            if (setjmp(jerr.setjmp_buffer))
+                return fail("JPG Signaled an Error.\n");
+            return run_jpg();
+        }
+
+        // Buffered-image loop: absorb the input, then run an output pass for the latest scan.
+        // Every libjpeg call can suspend (FALSE, 0 or JPEG_SUSPENDED) and is resumed
+        // by the next append.
+        bool ProgressiveDecoder::State::run_jpg()
+        {
+            if (jpg_stage == JPGStage::Header)
+            {
+                if (jpeg_read_header(&cinfo, TRUE) == JPEG_SUSPENDED)
+                    return true;
+                cinfo.buffered_image = TRUE;
+                jpg_stage = JPGStage::Start;
+            }
+
+            if (jpg_stage == JPGStage::Start)
+            {
+                if (!jpeg_start_decompress(&cinfo))
+                    return true;
+                if (cinfo.output_components != 1 && cinfo.output_components != 3)
+                    return fail("Unsupported JPG color space.\n");
+                if (!allocate((int)cinfo.output_width, (int)cinfo.output_height, cinfo.output_components, 8))
+                    return fail("Invalid JPG size.\n");
+                jpg_stage = JPGStage::Output;
+            }
+
+            while (jpg_stage == JPGStage::Output)
+            {
+                if (!jpg_output_active)
+                {
+                    int status;
+                    do
+                        status = jpeg_consume_input(&cinfo);
+                    while (status != JPEG_SUSPENDED && status != JPEG_REACHED_EOI);
+
+                    if (cinfo.input_scan_number == jpg_shown_scan)
+                    {
+                        // the last scan is already on screen
+                        if (!jpeg_input_complete(&cinfo))
+                            return true;
+                        jpeg_finish_decompress(&cinfo);
+                        jpg_stage = JPGStage::Done;
+                        complete = true;
+                        return true;
+                    }
+
+                    if (!jpeg_start_output(&cinfo, cinfo.input_scan_number))
+                        return true;
+                    jpg_output_active = true;
+                }
+
+                while (cinfo.output_scanline < cinfo.output_height)
+                {
+                    JSAMPROW row = (JSAMPROW)target.row((int)cinfo.output_scanline);
+                    if (jpeg_read_scanlines(&cinfo, &row, 1) == 0)
+                        return true;
+                    updated = true;
+                }
+
+                if (!jpeg_finish_output(&cinfo))
+                    return true;
+                jpg_output_active = false;
+                jpg_shown_scan = cinfo.output_scan_number;
+            }
+            return true;
+        }
+
+        //----------------------------------------------------------------------------------
+        // ProgressiveDecoder
+        //----------------------------------------------------------------------------------
+
+        ProgressiveDecoder::ProgressiveDecoder(bool invertY)
+        {
+            this->invertY = invertY;
+            state = new State(invertY);
+        }
+
+        ProgressiveDecoder::~ProgressiveDecoder()
+        {
+            delete state;
+            state = nullptr;
+        }
+
+        bool ProgressiveDecoder::append(const void *data, size_t size)
+        {
+            if (state->failed)
+                return false;
+            if (state->complete || size == 0)
+                return true;
+
+            const uint8_t *bytes = (const uint8_t *)data;
+            std::vector<uint8_t> signature;
+            if (state->format == FileFormat::Unknown)
+            {
+                // PNG needs 8 bytes to be recognized
+                size_t needed = 8 - state->signature.size();
+                size_t count = (size < needed) ? size : needed;
+                state->signature.insert(state->signature.end(), bytes, bytes + count);
+                FileFormat format = detectFormat(state->signature.data(), state->signature.size());
+                if (format == FileFormat::Unknown)
+                {
+                    if (state->signature.size() < 8)
+                        return true;
+                    return state->fail("Unknown image format.\n");
+                }
+                if (!state->start(format))
+                    return false;
+                // the signature bytes go first, followed by the rest of this call
+                signature.swap(state->signature);
+                bytes += count;
+                size -= count;
+            }
+
+            state->updated = false;
+            bool result = state->decode(signature.data(), signature.size()) &&
+                          state->decode(bytes, size);
+            if (state->updated)
+                state->update_count++;
+            return result;
+        }
+
+        void ProgressiveDecoder::reset()
+        {
+            delete state;
+            state = new State(invertY);
+        }
+
+        FileFormat ProgressiveDecoder::getFormat() const
+        {
+            return state->format;
+        }
+
+        bool ProgressiveDecoder::hasHeader() const
+        {
+            return !state->output.empty();
+        }
+
+        bool ProgressiveDecoder::isComplete() const
+        {
+            return state->complete;
+        }
+
+        bool ProgressiveDecoder::hasError() const
+        {
+            return state->failed;
+        }
+
+        const std::string &ProgressiveDecoder::getError() const
+        {
+            return state->error;
+        }
+
+        const Image &ProgressiveDecoder::image() const
+        {
+            return state->output;
+        }
+
+        uint32_t ProgressiveDecoder::getUpdateCount() const
+        {
+            return state->update_count;
+        }
+
+    }
+}
@@ -0,0 +1,452 @@
+#include <InteractiveToolkit-Extension/image/Resample.h>
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#define RESAMPLE_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RESAMPLE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace ITKExtension
+{
+    namespace Image
+    {
+        namespace Resample
+        {
+
+            Options::Options()
+            {
+                filter = Filter::Mitchell;
+                color_space = ColorSpace::sRGB;
+                edge = Edge::Clamp;
+            }
+
+            //----------------------------------------------------------------------------------
+            // filters
+            //----------------------------------------------------------------------------------
+
+            static double filter_support(Filter filter)
+            {
+                switch (filter)
+                {
+                case Filter::Box:
+                    return 0.5;
+                case Filter::Bilinear:
+                    return 1.0;
+                case Filter::Lanczos3:
+                    return 3.0;
+                case Filter::Mitchell:
+                default:
+                    return 2.0;
+                }
+            }
+
+            static double sinc(double x)
+            {
+                if (x == 0.0)
+                    return 1.0;
+                x *= 3.14159265358979323846;
+                return sin(x) / x;
+            }
+
+            static double filter_weight(Filter filter, double x)
+            {
+                switch (filter)
+                {
+                case Filter::Box:
+                    return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+                case Filter::Bilinear:
+                    x = fabs(x);
+                    return (x < 1.0) ? 1.0 - x : 0.0;
+                case Filter::Lanczos3:
+                    x = fabs(x);
+                    return (x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+                case Filter::Mitchell:
+                default:
+                {
+                    const double B = 1.0 / 3.0;
+                    const double C = 1.0 / 3.0;
+                    x = fabs(x);
+                    double x2 = x * x;
+                    double x3 = x2 * x;
+                    if (x < 1.0)
+                        return ((12.0 - 9.0 * B - 6.0 * C) * x3 + (-18.0 + 12.0 * B + 6.0 * C) * x2 + (6.0 - 2.0 * B)) / 6.0;
+                    if (x < 2.0)
+                        return ((-B - 6.0 * C) * x3 + (6.0 * B + 30.0 * C) * x2 + (-12.0 * B - 48.0 * C) * x + (8.0 * B + 24.0 * C)) / 6.0;
+                    return 0.0;
+                }
+                }
+            }
+
+            /// \private
+            ///
+            /// Source taps of every target pixel along one axis.
+            /// Taps of target i are [start[i], start[i] + count[i]) in index/weight.
+            ///
+            struct Contributions
+            {
+                std::vector<int> start;
+                std::vector<int> count;
+                std::vector<int> index;
+                std::vector<float> weight;
+                int max_taps;
+            };
+
+            static void compute_contributions(int src_size, int dst_size, Filter filter, Edge edge, Contributions *c)
+            {
+                double scale = (double)src_size / (double)dst_size;
+                // when shrinking, the filter is stretched to cover the source pixels
+                double filter_scale = (scale > 1.0) ? scale : 1.0;
+                double support = filter_support(filter) * filter_scale;
+
+                c->start.resize(dst_size);
+                c->count.resize(dst_size);
+                c->index.clear();
+                c->weight.clear();
+                c->max_taps = 0;
+
+                for (int i = 0; i < dst_size; i++)
+                {
+                    double center = ((double)i + 0.5) * scale;
+                    int left = (int)floor(center - support);
+                    int right = (int)ceil(center + support);
+
+                    int start = (int)c->index.size();
+                    double sum = 0.0;
+                    for (int j = left; j <= right; j++)
+                    {
+                        double w = filter_weight(filter, ((double)j + 0.5 - center) / filter_scale);
+                        if (w == 0.0)
+                            continue;
+                        int index = j;
+                        if (edge == Edge::Wrap)
+                            index = ((j % src_size) + src_size) % src_size;
+                        else if (index < 0)
+                            index = 0;
+                        else if (index >= src_size)
+                            index = src_size - 1;
+
+                        // clamped taps fall on the same border pixel, keep them as one
+                        if ((int)c->index.size() > start && c->index.back() == index)
+                            c->weight.back() += (float)w;
+                        else
+                        {
+                            c->index.push_back(index);
+                            c->weight.push_back((float)w);
+                        }
+                        sum += w;
+                    }
+
+                    if (sum == 0.0)
+                    {
+                        // nothing covered (box filter between two pixels): nearest
+                        int nearest = (int)center;
+                        c->index.resize(start);
+                        c->weight.resize(start);
+                        c->index.push_back((nearest < src_size) ? nearest : src_size - 1);
+                        c->weight.push_back(1.0f);
+                        sum = 1.0;
+                    }
+
+                    c->start[i] = start;
+                    c->count[i] = (int)c->index.size() - start;
+                    for (int k = start; k < (int)c->index.size(); k++)
+                        c->weight[k] = (float)(c->weight[k] / sum);
+                    if (c->count[i] > c->max_taps)
+                        c->max_taps = c->count[i];
+                }
+            }
+
+            //----------------------------------------------------------------------------------
+            // color conversion
+            //----------------------------------------------------------------------------------
+
+            static const int LINEAR_TO_SRGB_SIZE = 16384;
+
+            /// \private
+            struct ColorTables
+            {
+                float srgb_to_linear[256];
+                float unorm_to_float[256];
+                uint8_t linear_to_srgb[LINEAR_TO_SRGB_SIZE];
+
+                ColorTables()
+                {
+                    for (int i = 0; i < 256; i++)
+                    {
+                        double v = (double)i / 255.0;
+                        srgb_to_linear[i] = (float)((v <= 0.04045) ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4));
+                        unorm_to_float[i] = (float)v;
+                    }
+                    for (int i = 0; i < LINEAR_TO_SRGB_SIZE; i++)
+                    {
+                        double v = (double)i / (double)(LINEAR_TO_SRGB_SIZE - 1);
+                        double s = (v <= 0.0031308) ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+                        linear_to_srgb[i] = (uint8_t)(s * 255.0 + 0.5);
+                    }
+                }
+
+                static const ColorTables &Instance()
+                {
+                    static const ColorTables tables;
+                    return tables;
+                }
+            };
+
+            static inline float clamp01(float v)
+            {
+                return (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+            }
+
+            // 8 bits row to float, linear light and premultiplied by alpha
+            static void decode_row(const uint8_t *src, float *out, int w, int chann, bool srgb)
+            {
+                const ColorTables &tables = ColorTables::Instance();
+                const float *color = (srgb) ? tables.srgb_to_linear : tables.unorm_to_float;
+                const float *unorm = tables.unorm_to_float;
+
+                if (chann == 1 || chann == 3)
+                {
+                    for (int i = 0; i < w * chann; i++)
+                        out[i] = color[src[i]];
+                    return;
+                }
+
+                int alpha = chann - 1;
+                for (int x = 0; x < w; x++)
+                {
+                    const uint8_t *px = &src[x * chann];
+                    float *o = &out[x * chann];
+                    float a = unorm[px[alpha]];
+                    for (int c = 0; c < alpha; c++)
+                        o[c] = color[px[c]] * a;
+                    o[alpha] = a;
+                }
+            }
+
+            // float row (linear, premultiplied) back to 8 bits
+            static void encode_row(const float *in, uint8_t *out, int w, int chann, bool srgb)
+            {
+                const ColorTables &tables = ColorTables::Instance();
+                bool has_alpha = (chann == 2 || chann == 4);
+                int colors = (has_alpha) ? chann - 1 : chann;
+
+                for (int x = 0; x < w; x++)
+                {
+                    const float *px = &in[x * chann];
+                    uint8_t *o = &out[x * chann];
+                    float inv_alpha = 1.0f;
+                    if (has_alpha)
+                    {
+                        float a = clamp01(px[colors]);
+                        o[colors] = (uint8_t)(a * 255.0f + 0.5f);
+                        inv_alpha = (a > 0.0f) ? 1.0f / a : 0.0f;
+                    }
+                    for (int c = 0; c < colors; c++)
+                    {
+                        float v = clamp01(px[c] * inv_alpha);
+                        if (srgb)
+                            o[c] = tables.linear_to_srgb[(int)(v * (float)(LINEAR_TO_SRGB_SIZE - 1) + 0.5f)];
+                        else
+                            o[c] = (uint8_t)(v * 255.0f + 0.5f);
+                    }
+                }
+            }
+
+            //----------------------------------------------------------------------------------
+            // passes
+            //----------------------------------------------------------------------------------
+
+            static void horizontal_pass(const float *in, float *out, int chann, int dst_w, const Contributions &c)
+            {
+#if defined(RESAMPLE_SSE)
+                if (chann == 4)
+                {
+                    // one pixel per register
+                    for (int x = 0; x < dst_w; x++)
+                    {
+                        const int *index = &c.index[c.start[x]];
+                        const float *weight = &c.weight[c.start[x]];
+                        __m128 acc = _mm_setzero_ps();
+                        for (int t = 0; t < c.count[x]; t++)
+                            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weight[t]), _mm_loadu_ps(&in[index[t] * 4])));
+                        _mm_storeu_ps(&out[x * 4], acc);
+                    }
+                    return;
+                }
+#endif
+                for (int x = 0; x < dst_w; x++)
+                {
+                    const int *index = &c.index[c.start[x]];
+                    const float *weight = &c.weight[c.start[x]];
+                    float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    for (int t = 0; t < c.count[x]; t++)
+                    {
+                        const float *px = &in[index[t] * chann];
+                        for (int ch = 0; ch < chann; ch++)
+                            acc[ch] += weight[t] * px[ch];
+                    }
+                    for (int ch = 0; ch < chann; ch++)
+                        out[x * chann + ch] = acc[ch];
+                }
+            }
+
+            // acc += row * weight
+            static void accumulate_row(float *acc, const float *row, float weight, size_t count)
+            {
+                size_t i = 0;
+#if defined(RESAMPLE_AVX)
+                __m256 w8 = _mm256_set1_ps(weight);
+                for (; i + 8 <= count; i += 8)
+                {
+#if defined(__FMA__)
+                    __m256 sum = _mm256_fmadd_ps(_mm256_loadu_ps(&row[i]), w8, _mm256_loadu_ps(&acc[i]));
+#else
+                    __m256 sum = _mm256_add_ps(_mm256_loadu_ps(&acc[i]), _mm256_mul_ps(_mm256_loadu_ps(&row[i]), w8));
+#endif
+                    _mm256_storeu_ps(&acc[i], sum);
+                }
+#endif
+#if defined(RESAMPLE_SSE)
+                __m128 w4 = _mm_set1_ps(weight);
+                for (; i + 4 <= count; i += 4)
+                    _mm_storeu_ps(&acc[i], _mm_add_ps(_mm_loadu_ps(&acc[i]), _mm_mul_ps(_mm_loadu_ps(&row[i]), w4)));
+#endif
+                for (; i < count; i++)
+                    acc[i] += row[i] * weight;
+            }
+
+            // Vertical pass over horizontally filtered rows kept in a small ring.
+            // Source rows are filtered once each when the taps move forward.
+            // source_row(y, scratch) returns the linear row y, decoded into scratch when needed.
+            template <typename SourceRow, typename TargetRow>
+            static void resample(int src_w, int src_h, int chann, int dst_w, int dst_h, const Options &options,
+                                 const SourceRow &source_row, const TargetRow &target_row)
+            {
+                Contributions horizontal, vertical;
+                compute_contributions(src_w, dst_w, options.filter, options.edge, &horizontal);
+                compute_contributions(src_h, dst_h, options.filter, options.edge, &vertical);
+
+                size_t dst_row_size = (size_t)dst_w * chann;
+                int ring_size = vertical.max_taps + 1;
+                std::vector<float> ring((size_t)ring_size * dst_row_size);
+                std::vector<int> ring_row(ring_size, -1);
+                std::vector<float> input((size_t)src_w * chann);
+                std::vector<float> acc(dst_row_size);
+
+                for (int y = 0; y < dst_h; y++)
+                {
+                    memset(acc.data(), 0, sizeof(float) * dst_row_size);
+                    for (int t = 0; t < vertical.count[y]; t++)
+                    {
+                        int j = vertical.index[vertical.start[y] + t];
+                        int slot = j % ring_size;
+                        float *filtered = &ring[(size_t)slot * dst_row_size];
+                        if (ring_row[slot] != j)
+                        {
+                            horizontal_pass(source_row(j, input.data()), filtered, chann, dst_w, horizontal);
+                            ring_row[slot] = j;
+                        }
+                        accumulate_row(acc.data(), filtered, vertical.weight[vertical.start[y] + t], dst_row_size);
+                    }
+                    target_row(y, acc.data());
+                }
+            }
+
+            //----------------------------------------------------------------------------------
+            // public
+            //----------------------------------------------------------------------------------
+
+            bool resize(const uint8_t *src, int src_w, int src_h, size_t src_stride, int chann,
+                        uint8_t *dst, int dst_w, int dst_h, size_t dst_stride,
+                        const Options &options)
+            {
+                if (src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0 || chann < 1 || chann > 4)
+                    return false;
+
+                bool srgb = options.color_space == ColorSpace::sRGB;
+                resample(src_w, src_h, chann, dst_w, dst_h, options,
+                         [&](int y, float *scratch) -> const float *
+                         {
+                             decode_row(&src[(size_t)y * src_stride], scratch, src_w, chann, srgb);
+                             return scratch;
+                         },
+                         [&](int y, const float *row)
+                         { encode_row(row, &dst[(size_t)y * dst_stride], dst_w, chann, srgb); });
+                return true;
+            }
+
+            std::vector<MipLevel> generateMipChain(const uint8_t *src, int w, int h, size_t src_stride, int chann,
+                                                   const Options &options, int max_levels)
+            {
+                std::vector<MipLevel> levels;
+                if (w <= 0 || h <= 0 || chann < 1 || chann > 4)
+                    return levels;
+
+                bool srgb = options.color_space == ColorSpace::sRGB;
+
+                MipLevel base;
+                base.w = w;
+                base.h = h;
+                base.pixels.resize((size_t)w * h * chann);
+                for (int y = 0; y < h; y++)
+                    memcpy(&base.pixels[(size_t)y * w * chann], &src[(size_t)y * src_stride], (size_t)w * chann);
+                levels.push_back(std::move(base));
+
+                // previous level in linear premultiplied float (empty for level 0, read from src)
+                std::vector<float> previous;
+                std::vector<float> current;
+
+                while ((w > 1 || h > 1) && (max_levels <= 0 || (int)levels.size() < max_levels))
+                {
+                    int next_w = (w > 1) ? w / 2 : 1;
+                    int next_h = (h > 1) ? h / 2 : 1;
+                    size_t next_row = (size_t)next_w * chann;
+
+                    MipLevel level;
+                    level.w = next_w;
+                    level.h = next_h;
+                    level.pixels.resize(next_row * next_h);
+                    current.resize(next_row * next_h);
+
+                    auto target_row = [&](int y, const float *row)
+                    {
+                        memcpy(&current[(size_t)y * next_row], row, sizeof(float) * next_row);
+                        encode_row(row, &level.pixels[(size_t)y * next_row], next_w, chann, srgb);
+                    };
+
+                    if (previous.empty())
+                        resample(w, h, chann, next_w, next_h, options,
+                                 [&](int y, float *scratch) -> const float *
+                                 {
+                                     decode_row(&src[(size_t)y * src_stride], scratch, w, chann, srgb);
+                                     return scratch;
+                                 },
+                                 target_row);
+                    else
+                    {
+                        size_t row = (size_t)w * chann;
+                        resample(w, h, chann, next_w, next_h, options,
+                                 [&](int y, float *) -> const float *
+                                 { return &previous[(size_t)y * row]; },
+                                 target_row);
+                    }
+
+                    levels.push_back(std::move(level));
+                    previous.swap(current);
+                    w = next_w;
+                    h = next_h;
+                }
+
+                return levels;
+            }
+
+        }
+    }
+}
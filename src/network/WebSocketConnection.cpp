@@ -1,9 +1,9 @@
 #include <InteractiveToolkit-Extension/network/WebSocketConnection.h>
 #include <InteractiveToolkit-Extension/encoding/Base64.h>
 #include <InteractiveToolkit-Extension/hashing/SHA1.h>
+#include <InteractiveToolkit-Extension/random/SecureRandom.h>
 #include <InteractiveToolkit/Platform/SocketTCP.h>
 #include <InteractiveToolkit/ITKCommon/StringUtil.h>
-#include <InteractiveToolkit/ITKCommon/Random.h>
 
 #include <cstring>
 #include <algorithm>
@@ -99,10 +99,7 @@ namespace ITKExtension
         {
             // Generate 16 random bytes and base64 encode them
             uint8_t random_bytes[16];
-            // ITKCommon::Random32 rnd( ITKCommon::Random32::TypeDefinition::randomSeed() );
-            auto &rnd = *ITKCommon::Random32::Instance();
-            for (int i = 0; i < 16; i++)
-                random_bytes[i] = rnd.getRange<uint8_t>(0, 255);
+            Random::SecureRandom::fill(random_bytes, 16);
             return Encoding::Base64::EncodeToString(random_bytes, 16, &websocket_key);
         }
 
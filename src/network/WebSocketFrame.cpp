@@ -1,7 +1,7 @@
 #include <InteractiveToolkit-Extension/network/WebSocketFrame.h>
+#include <InteractiveToolkit-Extension/random/SecureRandom.h>
 #include <cstring>
 #include <algorithm>
-#include <InteractiveToolkit/ITKCommon/Random.h>
 
 #if defined(_WIN32)
 #pragma warning(push)
@@ -248,12 +248,9 @@ namespace ITKExtension
             if (mask)
             {
                 // Generate random mask key
-                auto &rnd = *ITKCommon::Random32::Instance();
-                for (int i = 0; i < 4; i++)
-                {
-                    mask_key[i] = rnd.getRange<uint8_t>(0, 255);
-                    header_buffer[pos++] = mask_key[i];
-                }
+                Random::SecureRandom::fill(mask_key, 4);
+                memcpy(header_buffer + pos, mask_key, 4);
+                pos += 4;
             }
 
             header_size = pos;
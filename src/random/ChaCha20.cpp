@@ -0,0 +1,125 @@
+#include <InteractiveToolkit-Extension/random/ChaCha20.h>
+
+#include <string.h>
+
+namespace ITKExtension
+{
+    namespace Random
+    {
+        static inline uint32_t rotl(uint32_t x, uint32_t n) { return (x << n) | (x >> (32 - n)); }
+
+        static inline uint32_t load32_le(const uint8_t *p)
+        {
+            return ((uint32_t)p[0]) |
+                   ((uint32_t)p[1] << 8) |
+                   ((uint32_t)p[2] << 16) |
+                   ((uint32_t)p[3] << 24);
+        }
+
+        static inline void store32_le(uint8_t *p, uint32_t v)
+        {
+            p[0] = v & 0xff;
+            p[1] = (v >> 8) & 0xff;
+            p[2] = (v >> 16) & 0xff;
+            p[3] = (v >> 24) & 0xff;
+        }
+
+#define CHACHA_QUARTERROUND(a, b, c, d) \
+    a += b;                             \
+    d = rotl(d ^ a, 16);                \
+    c += d;                             \
+    b = rotl(b ^ c, 12);                \
+    a += b;                             \
+    d = rotl(d ^ a, 8);                 \
+    c += d;                             \
+    b = rotl(b ^ c, 7);
+
+        ChaCha20::ChaCha20()
+        {
+            memset(state, 0, sizeof(state));
+        }
+
+        ChaCha20::~ChaCha20()
+        {
+            // do not leave key material behind
+            volatile uint32_t *p = state;
+            for (int i = 0; i < 16; i++)
+                p[i] = 0;
+        }
+
+        void ChaCha20::setKey(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter)
+        {
+            // "expand 32-byte k"
+            state[0] = 0x61707865;
+            state[1] = 0x3320646e;
+            state[2] = 0x79622d32;
+            state[3] = 0x6b206574;
+            for (int i = 0; i < 8; i++)
+                state[4 + i] = load32_le(key + i * 4);
+            state[12] = counter;
+            for (int i = 0; i < 3; i++)
+                state[13 + i] = load32_le(nonce + i * 4);
+        }
+
+        void ChaCha20::block(uint8_t output[64])
+        {
+            uint32_t x0 = state[0], x1 = state[1], x2 = state[2], x3 = state[3];
+            uint32_t x4 = state[4], x5 = state[5], x6 = state[6], x7 = state[7];
+            uint32_t x8 = state[8], x9 = state[9], x10 = state[10], x11 = state[11];
+            uint32_t x12 = state[12], x13 = state[13], x14 = state[14], x15 = state[15];
+
+            for (int i = 0; i < 10; i++)
+            {
+                // column rounds
+                CHACHA_QUARTERROUND(x0, x4, x8, x12)
+                CHACHA_QUARTERROUND(x1, x5, x9, x13)
+                CHACHA_QUARTERROUND(x2, x6, x10, x14)
+                CHACHA_QUARTERROUND(x3, x7, x11, x15)
+                // diagonal rounds
+                CHACHA_QUARTERROUND(x0, x5, x10, x15)
+                CHACHA_QUARTERROUND(x1, x6, x11, x12)
+                CHACHA_QUARTERROUND(x2, x7, x8, x13)
+                CHACHA_QUARTERROUND(x3, x4, x9, x14)
+            }
+
+            store32_le(output + 0, x0 + state[0]);
+            store32_le(output + 4, x1 + state[1]);
+            store32_le(output + 8, x2 + state[2]);
+            store32_le(output + 12, x3 + state[3]);
+            store32_le(output + 16, x4 + state[4]);
+            store32_le(output + 20, x5 + state[5]);
+            store32_le(output + 24, x6 + state[6]);
+            store32_le(output + 28, x7 + state[7]);
+            store32_le(output + 32, x8 + state[8]);
+            store32_le(output + 36, x9 + state[9]);
+            store32_le(output + 40, x10 + state[10]);
+            store32_le(output + 44, x11 + state[11]);
+            store32_le(output + 48, x12 + state[12]);
+            store32_le(output + 52, x13 + state[13]);
+            store32_le(output + 56, x14 + state[14]);
+            store32_le(output + 60, x15 + state[15]);
+
+            state[12]++;
+        }
+
+        void ChaCha20::keystream(uint8_t *output, size_t len)
+        {
+            while (len >= 64)
+            {
+                block(output);
+                output += 64;
+                len -= 64;
+            }
+            if (len > 0)
+            {
+                uint8_t tmp[64];
+                block(tmp);
+                memcpy(output, tmp, len);
+                memset(tmp, 0, sizeof(tmp));
+            }
+        }
+
+#undef CHACHA_QUARTERROUND
+
+    }
+}
@@ -0,0 +1,177 @@
+#include <InteractiveToolkit-Extension/random/SecureRandom.h>
+#include <InteractiveToolkit-Extension/random/ChaCha20.h>
+#include <InteractiveToolkit/ITKCommon/ITKAbort.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <bcrypt.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <stdlib.h>
+#include <pthread.h>
+#else
+#include <sys/random.h>
+#include <errno.h>
+#include <stdio.h>
+#include <pthread.h>
+#endif
+
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+namespace ITKExtension
+{
+    namespace Random
+    {
+        namespace SecureRandom
+        {
+            // 16 ChaCha20 blocks per refill, the first 44 bytes rekey the generator
+            static const size_t RNG_BUFFER_SIZE = 1024;
+            static const size_t RNG_REKEY_SIZE = 32 + 12;
+            static const uint64_t RNG_RESEED_INTERVAL = 1024 * 1024;
+
+            static bool os_entropy(uint8_t *output, size_t len)
+            {
+#if defined(_WIN32)
+                return BCryptGenRandom(NULL, output, (ULONG)len, BCRYPT_USE_SYSTEM_PREFERRED_RNG) == 0;
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+                arc4random_buf(output, len);
+                return true;
+#else
+                while (len > 0)
+                {
+                    ssize_t result = getrandom(output, len, 0);
+                    if (result < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        break;
+                    }
+                    output += result;
+                    len -= (size_t)result;
+                }
+                if (len == 0)
+                    return true;
+
+                // kernels older than 3.17 have no getrandom
+                FILE *urandom = fopen("/dev/urandom", "rb");
+                if (!urandom)
+                    return false;
+                size_t readed = fread(output, 1, len, urandom);
+                fclose(urandom);
+                return readed == len;
+#endif
+            }
+
+            // incremented in the child process, so every thread reseeds after fork()
+            static std::atomic<uint32_t> fork_generation(0);
+
+#if !defined(_WIN32)
+            static void on_fork_child()
+            {
+                fork_generation.fetch_add(1);
+            }
+#endif
+
+            static void register_fork_handler()
+            {
+#if !defined(_WIN32)
+                static std::once_flag once;
+                std::call_once(once, []()
+                               { pthread_atfork(nullptr, nullptr, on_fork_child); });
+#endif
+            }
+
+            struct GeneratorState
+            {
+                ChaCha20 chacha;
+                uint8_t buffer[RNG_BUFFER_SIZE];
+                size_t available;
+                uint64_t bytes_since_reseed;
+                uint32_t generation;
+                bool seeded;
+
+                GeneratorState() : available(0), bytes_since_reseed(0), generation(0), seeded(false)
+                {
+                }
+
+                ~GeneratorState()
+                {
+                    volatile uint8_t *p = buffer;
+                    for (size_t i = 0; i < RNG_BUFFER_SIZE; i++)
+                        p[i] = 0;
+                }
+
+                void reseed()
+                {
+                    register_fork_handler();
+
+                    uint8_t seed[RNG_REKEY_SIZE];
+                    ITK_ABORT(!os_entropy(seed, RNG_REKEY_SIZE), "Failed to read the OS entropy source.\n");
+                    chacha.setKey(seed, seed + 32);
+                    memset(seed, 0, sizeof(seed));
+
+                    available = 0;
+                    bytes_since_reseed = 0;
+                    generation = fork_generation.load();
+                    seeded = true;
+                }
+
+                void refill()
+                {
+                    if (!seeded || generation != fork_generation.load() || bytes_since_reseed >= RNG_RESEED_INTERVAL)
+                        reseed();
+
+                    // fast key erasure: the next key comes from this output,
+                    // so already returned bytes cannot be recomputed later
+                    chacha.keystream(buffer, RNG_BUFFER_SIZE);
+                    chacha.setKey(buffer, buffer + 32);
+                    memset(buffer, 0, RNG_REKEY_SIZE);
+
+                    available = RNG_BUFFER_SIZE - RNG_REKEY_SIZE;
+                    bytes_since_reseed += RNG_BUFFER_SIZE;
+                }
+
+                void fill(uint8_t *output, size_t len)
+                {
+                    // a forked child must not repeat the parent's buffered bytes
+                    if (generation != fork_generation.load())
+                        available = 0;
+
+                    while (len > 0)
+                    {
+                        if (available == 0)
+                            refill();
+                        size_t to_copy = (len < available) ? len : available;
+                        uint8_t *src = buffer + (RNG_BUFFER_SIZE - available);
+                        memcpy(output, src, to_copy);
+                        memset(src, 0, to_copy);
+                        available -= to_copy;
+                        output += to_copy;
+                        len -= to_copy;
+                    }
+                }
+            };
+
+            static GeneratorState &thread_state()
+            {
+                static thread_local GeneratorState state;
+                return state;
+            }
+
+            void fill(uint8_t *output, size_t len)
+            {
+                thread_state().fill(output, len);
+            }
+
+            uint32_t next32()
+            {
+                uint8_t bytes[4];
+                fill(bytes, 4);
+                uint32_t result;
+                memcpy(&result, bytes, 4);
+                return result;
+            }
+        }
+    }
+}
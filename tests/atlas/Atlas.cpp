@@ -0,0 +1,185 @@
+#include <InteractiveToolkit-Extension/atlas/Atlas.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+using namespace ITKExtension::Atlas;
+
+static int failures = 0;
+
+static void check(const char *name, bool ok)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+        failures++;
+}
+
+static const char *packer_name(PackingAlgorithm algorithm)
+{
+    return (algorithm == PackingAlgorithm::Skyline) ? "skyline" : "maxrects";
+}
+
+// every element with pixels is inside the texture and keeps the spacing to the others
+static bool valid_placement(const Atlas &atlas, const std::vector<std::shared_ptr<AtlasElement>> &elements)
+{
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        const AtlasRect &rect = elements[i]->rect;
+        if (rect.w == 0 || rect.h == 0)
+            continue;
+        if (!rect.inside(atlas.textureResolution, atlas.xspacing / 2, atlas.yspacing / 2))
+            return false;
+        for (size_t j = i + 1; j < elements.size(); j++)
+            if (rect.overlaps(elements[j]->rect, atlas.xspacing, atlas.yspacing))
+                return false;
+    }
+    return true;
+}
+
+static bool is_power_of_two(int v)
+{
+    return v > 0 && (v & (v - 1)) == 0;
+}
+
+// glyph like sizes (narrow and tall) or sprite like sizes, with a few empty elements
+static void check_random_set(const char *kind, int count, bool sprites, int spacing, PackingAlgorithm algorithm, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    Atlas atlas(spacing, spacing);
+    std::vector<std::shared_ptr<AtlasElement>> elements;
+    for (int i = 0; i < count; i++)
+    {
+        int w = sprites ? 8 + (int)(rng() % 200) : 6 + (int)(rng() % 30);
+        int h = sprites ? 8 + (int)(rng() % 200) : 12 + (int)(rng() % 28);
+        if (i % 97 == 5)
+            w = 0; // a space glyph
+        elements.push_back(atlas.addElement("e", w, h));
+    }
+    atlas.organizePositions(algorithm);
+
+    char name[128];
+    snprintf(name, sizeof(name), "%s %d %s, spacing %d: %dx%d", kind, count, packer_name(algorithm), spacing,
+             atlas.textureResolution.w, atlas.textureResolution.h);
+    check(name, is_power_of_two(atlas.textureResolution.w) && is_power_of_two(atlas.textureResolution.h) &&
+                    valid_placement(atlas, elements));
+}
+
+static void fill_random(const std::shared_ptr<AtlasElement> &element, std::mt19937 &rng)
+{
+    std::vector<uint8_t> pixels((size_t)element->rect.w * element->rect.h * 4);
+    for (auto &v : pixels)
+        v = (uint8_t)rng();
+    element->copyFromRGBABuffer(pixels.data(), element->rect.w * 4);
+}
+
+// online mode: random insertions and removals, the texture kept by updateRGBA
+// must be the same as a full createRGBA after every update
+static void check_online(PackingAlgorithm algorithm)
+{
+    std::mt19937 rng(11);
+    Atlas atlas(2, 2);
+    std::vector<std::shared_ptr<AtlasElement>> live;
+    for (int i = 0; i < 150; i++)
+    {
+        live.push_back(atlas.addElement("g", 6 + (int)(rng() % 30), 12 + (int)(rng() % 28)));
+        fill_random(live.back(), rng);
+    }
+    atlas.organizePositions(algorithm);
+    atlas.beginOnlineMode(atlas.textureResolution);
+    std::shared_ptr<uint8_t[]> texture = atlas.createRGBA();
+
+    bool ok = true;
+    bool dirty_inside = true;
+    int updates = 0, grows = 0;
+    for (int step = 0; ok && step < 3000; step++)
+    {
+        if (rng() % 3 != 0 || live.empty())
+        {
+            int w = (rng() % 50 == 0) ? 0 : 6 + (int)(rng() % 30);
+            std::shared_ptr<AtlasElement> element = atlas.insertElement("n", w, 12 + (int)(rng() % 28));
+            if (element == nullptr)
+            {
+                // full: grow keeping the positions, the texture is created again
+                AtlasRect resolution = atlas.textureResolution;
+                if (resolution.w <= resolution.h)
+                    resolution.w *= 2;
+                else
+                    resolution.h *= 2;
+                atlas.beginOnlineMode(resolution);
+                texture = atlas.createRGBA();
+                grows++;
+                continue;
+            }
+            if (w > 0)
+                fill_random(element, rng);
+            live.push_back(element);
+        }
+        else
+        {
+            size_t index = rng() % live.size();
+            ok = atlas.removeElement(live[index]);
+            live.erase(live.begin() + index);
+        }
+
+        if (step % 100 == 99)
+        {
+            std::vector<AtlasRect> dirty;
+            atlas.updateRGBA(texture.get(), &dirty);
+            for (const auto &rect : dirty)
+                dirty_inside = dirty_inside && rect.inside(atlas.textureResolution, 0, 0);
+            std::shared_ptr<uint8_t[]> full = atlas.createRGBA();
+            ok = ok && !atlas.hasPendingUpdates() &&
+                 memcmp(full.get(), texture.get(), (size_t)atlas.textureResolution.w * atlas.textureResolution.h * 4) == 0;
+            updates++;
+        }
+    }
+
+    char name[128];
+    snprintf(name, sizeof(name), "online %s: updateRGBA equals createRGBA (%d updates, %d grows)", packer_name(algorithm), updates, grows);
+    check(name, ok && updates > 0);
+    snprintf(name, sizeof(name), "online %s: dirty rects inside the texture", packer_name(algorithm));
+    check(name, dirty_inside);
+    snprintf(name, sizeof(name), "online %s: %d live elements placed", packer_name(algorithm), (int)live.size());
+    check(name, valid_placement(atlas, live));
+}
+
+int main()
+{
+    const PackingAlgorithm algorithms[] = {PackingAlgorithm::Skyline, PackingAlgorithm::MaxRectsBSSF};
+
+    for (PackingAlgorithm algorithm : algorithms)
+    {
+        unsigned int seed = 1;
+        for (int count : {1, 50, 300, 2000})
+        {
+            check_random_set("glyphs", count, false, 2, algorithm, seed++);
+            check_random_set("glyphs", count, false, 3, algorithm, seed++);
+            check_random_set("sprites", count, true, 0, algorithm, seed++);
+        }
+    }
+
+    // the size search goes by area level: 100 squares of 100x100 fit in 1024x1024
+    for (PackingAlgorithm algorithm : algorithms)
+    {
+        Atlas atlas(0, 0);
+        std::vector<std::shared_ptr<AtlasElement>> elements;
+        for (int i = 0; i < 100; i++)
+            elements.push_back(atlas.addElement("square", 100, 100));
+        atlas.organizePositions(algorithm);
+
+        char name[128];
+        snprintf(name, sizeof(name), "100 squares %s: %dx%d", packer_name(algorithm),
+                 atlas.textureResolution.w, atlas.textureResolution.h);
+        check(name, atlas.textureResolution.w == 1024 && atlas.textureResolution.h == 1024 &&
+                        valid_placement(atlas, elements));
+    }
+
+    for (PackingAlgorithm algorithm : algorithms)
+        check_online(algorithm);
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
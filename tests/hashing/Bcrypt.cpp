@@ -0,0 +1,91 @@
+#include <InteractiveToolkit-Extension/hashing/Bcrypt.h>
+
+#include <stdio.h>
+#include <string>
+
+using namespace ITKExtension::Hashing;
+
+static int failures = 0;
+
+static void check(const char *name, bool ok)
+{
+    if (!ok)
+    {
+        printf("FAIL %s\n", name);
+        failures++;
+    }
+    else
+        printf("ok   %s\n", name);
+}
+
+// hash() with the salt and cost of the expected value must rebuild it, and verify() must accept it
+static void check_vector(const char *password, const char *expected)
+{
+    std::string expected_str = expected;
+    int cost;
+    uint8_t salt[16];
+    Bcrypt::string_to_salt(expected_str.substr(0, 29), &cost, salt);
+
+    std::string name = std::string(expected).substr(0, 7) + " \"" + password + "\"";
+    check((name + " hash").c_str(), Bcrypt::hash(password, cost, salt, expected[2]) == expected_str);
+    check((name + " verify").c_str(), Bcrypt::verify(password, expected_str));
+}
+
+int main()
+{
+    // OpenBSD / OpenWall vectors
+    check_vector("", "$2a$06$DCq7YPn5Rq63x1Lad4cll.TV4S6ytwfsfvkgY8jIucDrjc8deX1s.");
+    check_vector("a", "$2a$06$m0CrhHm10qJ3lXRY.5zDGO3rS2KdeeWLuGmsfGlMfOxih58VYVfxe");
+    check_vector("abc", "$2a$06$If6bvum7DFjUnE9p2uDeDu0YHzrHM6tf.iqN8.yx.jNN1ILEf7h0i");
+    check_vector("abcdefghijklmnopqrstuvwxyz", "$2a$06$.rCVZVOThsIa97pEDOxvGuRRgzG64bvtJ0938xuqzv18d3ZpQhstC");
+    check_vector("~!@#$%^&*()      ~!@#$%^&*()PNBFRD", "$2a$06$fPIsBO8qRqkjj273rfaOI.HtSV9jLDpTbZn782DC6/t7qT67P6FfO");
+    check_vector("U*U", "$2a$05$CCCCCCCCCCCCCCCCCCCCC.E5YPO9kmyuRGyh0XouQYb4YMJKvyOeW");
+    check_vector("U*U*", "$2a$05$CCCCCCCCCCCCCCCCCCCCC.VGOzA784oUp/Z0DY336zx7pLYAy0lwK");
+    check_vector("", "$2a$05$CCCCCCCCCCCCCCCCCCCCC.7uG0VCzI2bS7j6ymqJi9CdcdxiRTWNy");
+    // 8 bit character, the same in $2b$ and $2y$
+    check_vector("\xa3", "$2b$05$/OK.fbVrR/bpIqNJ5ianF.Sa7shbm4.OzKpvFnX1pQLmQW96oUlCq");
+    check_vector("\xa3", "$2y$05$/OK.fbVrR/bpIqNJ5ianF.Sa7shbm4.OzKpvFnX1pQLmQW96oUlCq");
+    check_vector("Kk4DQuMMfZL9o", "$2b$04$cVWp4XaNU8a4v1uMRum2SO026BWLIoQMD/TXg5uZV.0P.uO8m3YEm");
+    // only the first 72 bytes count
+    check_vector("0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789chars after 72 are ignored",
+                 "$2a$05$abcdefghijklmnopqrstuu5s2v8.iXieOjg/.AySBTTZIIVFJeBui");
+
+    // rejections
+    check("wrong password", !Bcrypt::verify("U*U*U", "$2a$05$CCCCCCCCCCCCCCCCCCCCC.E5YPO9kmyuRGyh0XouQYb4YMJKvyOeW"));
+    check("changed hash", !Bcrypt::verify("U*U", "$2a$05$CCCCCCCCCCCCCCCCCCCCC.E5YPO9lmyuRGyh0XouQYb4YMJKvyOeW"));
+    check("bad format", !Bcrypt::verify("U*U", "$2x$05$CCCCCCCCCCCCCCCCCCCCC.E5YPO9kmyuRGyh0XouQYb4YMJKvyOeW"));
+    check("bad cost", !Bcrypt::verify("U*U", "$2a$03$CCCCCCCCCCCCCCCCCCCCC.E5YPO9kmyuRGyh0XouQYb4YMJKvyOeW"));
+    check("truncated", !Bcrypt::verify("U*U", "$2a$05$CCCCCCCCCCCCCCCCCCCCC.E5YPO9kmyuRGyh0XouQYb4YMJKvyOe"));
+
+    // random salt round trip
+    {
+        std::string hash = Bcrypt::hash("correct horse", 5);
+        check("random salt verify", Bcrypt::verify("correct horse", hash) && !Bcrypt::verify("correct horsf", hash));
+    }
+
+    // continuing the verified cost N state up to N + k is the same as hashing at N + k
+    {
+        uint8_t salt[16];
+        for (int i = 0; i < 16; i++)
+            salt[i] = (uint8_t)(i * 31 + 7);
+        for (int k = 1; k <= 3; k++)
+        {
+            std::string stored = Bcrypt::hash("rehash me", 4, salt, 'b');
+            std::string rehash;
+            bool ok = Bcrypt::verifyAndMaybeRehash("rehash me", stored, 4 + k, &rehash);
+            char name[64];
+            snprintf(name, sizeof(name), "rehash cost 4 -> %d", 4 + k);
+            check(name, ok && rehash == Bcrypt::hash("rehash me", 4 + k, salt, 'b'));
+        }
+
+        std::string stored = Bcrypt::hash("rehash me", 5, salt, 'y');
+        std::string rehash = "not cleared";
+        check("no rehash at the same cost", Bcrypt::verifyAndMaybeRehash("rehash me", stored, 5, &rehash) && rehash.empty());
+        rehash = "not cleared";
+        check("no rehash on a wrong password", !Bcrypt::verifyAndMaybeRehash("rehash you", stored, 7, &rehash) && rehash.empty());
+    }
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
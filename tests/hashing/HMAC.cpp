@@ -0,0 +1,153 @@
+#include <InteractiveToolkit-Extension/hashing/HMAC.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace ITKExtension::Hashing;
+
+static int failures = 0;
+
+static std::vector<uint8_t> from_hex(const char *hex)
+{
+    std::vector<uint8_t> result;
+    for (size_t i = 0; hex[i] != 0 && hex[i + 1] != 0; i += 2)
+    {
+        unsigned int v;
+        sscanf(&hex[i], "%2x", &v);
+        result.push_back((uint8_t)v);
+    }
+    return result;
+}
+
+static std::vector<uint8_t> repeat(uint8_t v, size_t count)
+{
+    return std::vector<uint8_t>(count, v);
+}
+
+static std::vector<uint8_t> range(int first, int last)
+{
+    std::vector<uint8_t> result;
+    for (int i = first; i <= last; i++)
+        result.push_back((uint8_t)i);
+    return result;
+}
+
+static std::vector<uint8_t> text(const char *str)
+{
+    return std::vector<uint8_t>((const uint8_t *)str, (const uint8_t *)str + strlen(str));
+}
+
+static void check(const char *name, const uint8_t *result, size_t size, const char *expected_hex)
+{
+    std::vector<uint8_t> expected = from_hex(expected_hex);
+    if (expected.size() != size || memcmp(result, expected.data(), size) != 0)
+    {
+        printf("FAIL %s\n", name);
+        failures++;
+    }
+    else
+        printf("ok   %s\n", name);
+}
+
+template <typename HashT>
+static void check_hmac(const char *name, const std::vector<uint8_t> &key, const std::vector<uint8_t> &data, const char *expected_hex)
+{
+    uint8_t digest[HashT::DigestSize];
+    size_t expected_size = strlen(expected_hex) / 2;
+
+    // one shot, incremental and verify must agree
+    HMAC<HashT>::hash(key.data(), key.size(), data.data(), data.size(), digest);
+    check(name, digest, expected_size, expected_hex);
+
+    HMAC<HashT> hmac(key.data(), key.size());
+    for (size_t i = 0; i < data.size(); i += 7)
+        hmac.update(&data[i], (data.size() - i < 7) ? data.size() - i : 7);
+    hmac.finalize(digest);
+    check((std::string(name) + " (incremental)").c_str(), digest, expected_size, expected_hex);
+
+    std::vector<uint8_t> expected = from_hex(expected_hex);
+    if (!hmac.verify(data.data(), data.size(), expected.data(), expected.size()))
+    {
+        printf("FAIL %s (verify)\n", name);
+        failures++;
+    }
+}
+
+template <typename HashT>
+static void check_hkdf(const char *name,
+                       const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &salt, const std::vector<uint8_t> &info,
+                       const char *expected_prk_hex, const char *expected_okm_hex)
+{
+    uint8_t prk[HashT::DigestSize];
+    HKDF<HashT>::extract(salt.data(), salt.size(), ikm.data(), ikm.size(), prk);
+    check((std::string(name) + " PRK").c_str(), prk, HashT::DigestSize, expected_prk_hex);
+
+    std::vector<uint8_t> okm(strlen(expected_okm_hex) / 2);
+    HKDF<HashT>::derive(salt.data(), salt.size(), ikm.data(), ikm.size(), info.data(), info.size(), okm.data(), okm.size());
+    check((std::string(name) + " OKM").c_str(), okm.data(), okm.size(), expected_okm_hex);
+}
+
+int main()
+{
+    // RFC 4231, HMAC-SHA256
+    check_hmac<SHA256>("RFC 4231 case 1", repeat(0x0b, 20), text("Hi There"),
+                       "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+    check_hmac<SHA256>("RFC 4231 case 2", text("Jefe"), text("what do ya want for nothing?"),
+                       "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    check_hmac<SHA256>("RFC 4231 case 3", repeat(0xaa, 20), repeat(0xdd, 50),
+                       "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe");
+    check_hmac<SHA256>("RFC 4231 case 4", range(0x01, 0x19), repeat(0xcd, 50),
+                       "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
+    check_hmac<SHA256>("RFC 4231 case 5 (truncated)", repeat(0x0c, 20), text("Test With Truncation"),
+                       "a3b6167473100ee06e0c796c2955552b");
+    check_hmac<SHA256>("RFC 4231 case 6", repeat(0xaa, 131), text("Test Using Larger Than Block-Size Key - Hash Key First"),
+                       "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+    check_hmac<SHA256>("RFC 4231 case 7", repeat(0xaa, 131),
+                       text("This is a test using a larger than block-size key and a larger than block-size data. "
+                            "The key needs to be hashed before being used by the HMAC algorithm."),
+                       "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+
+    // RFC 2202, HMAC-SHA1
+    check_hmac<SHA1>("RFC 2202 case 1", repeat(0x0b, 20), text("Hi There"),
+                     "b617318655057264e28bc0b6fb378c8ef146be00");
+    check_hmac<SHA1>("RFC 2202 case 2", text("Jefe"), text("what do ya want for nothing?"),
+                     "effcdf6ae5eb2fa2d27416d5f184df9c259a7c79");
+    check_hmac<SHA1>("RFC 2202 case 6", repeat(0xaa, 80), text("Test Using Larger Than Block-Size Key - Hash Key First"),
+                     "aa4ae5e15272d00e95705637ce8a3b55ed402112");
+
+    // RFC 5869, HKDF
+    check_hkdf<SHA256>("RFC 5869 case 1", repeat(0x0b, 22), range(0x00, 0x0c), range(0xf0, 0xf9),
+                       "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5",
+                       "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865");
+    check_hkdf<SHA256>("RFC 5869 case 2", range(0x00, 0x4f), range(0x60, 0xaf), range(0xb0, 0xff),
+                       "06a6b88c5853361a06104c9ceb35b45cef760014904671014a193f40c15fc244",
+                       "b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c"
+                       "59045a99cac7827271cb41c65e590e09da3275600c2f09b8367793a9aca3db71"
+                       "cc30c58179ec3e87c14c01d5c1f3434f1d87");
+    check_hkdf<SHA256>("RFC 5869 case 3", repeat(0x0b, 22), std::vector<uint8_t>(), std::vector<uint8_t>(),
+                       "19ef24a32c717b167f33a91d6f648bdf96596776afdb6377ac434c1c293ccb04",
+                       "8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d9d201395faa4b61a96c8");
+    check_hkdf<SHA1>("RFC 5869 case 4", repeat(0x0b, 11), range(0x00, 0x0c), range(0xf0, 0xf9),
+                     "9b6c18c432a7bf8f0e71c8eb88f4b30baa2ba243",
+                     "085a01ea1b10f36933068b56efa5ad81a4f14b822f5b091568a9cdd4f155fda2c22e422478d305f3f896");
+
+    // expand limit: 255 blocks
+    {
+        uint8_t prk[SHA256::DigestSize] = {0};
+        std::vector<uint8_t> okm(255 * SHA256::DigestSize + 1);
+        if (HKDF<SHA256>::expand(prk, sizeof(prk), nullptr, 0, okm.data(), okm.size()) ||
+            !HKDF<SHA256>::expand(prk, sizeof(prk), nullptr, 0, okm.data(), okm.size() - 1))
+        {
+            printf("FAIL HKDF expand limit\n");
+            failures++;
+        }
+        else
+            printf("ok   HKDF expand limit\n");
+    }
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include <InteractiveToolkit-Extension/hashing/PBKDF2.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace ITKExtension::Hashing;
+
+static int failures = 0;
+
+static std::vector<uint8_t> from_hex(const char *hex)
+{
+    std::vector<uint8_t> result;
+    for (size_t i = 0; hex[i] != 0 && hex[i + 1] != 0; i += 2)
+    {
+        unsigned int v;
+        sscanf(&hex[i], "%2x", &v);
+        result.push_back((uint8_t)v);
+    }
+    return result;
+}
+
+static std::vector<uint8_t> text(const char *str)
+{
+    return std::vector<uint8_t>((const uint8_t *)str, (const uint8_t *)str + strlen(str));
+}
+
+static void check(const char *name, bool ok)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+        failures++;
+}
+
+static void check_vector(const char *name, const char *password, const char *salt, uint32_t iterations, const char *expected_hex)
+{
+    std::vector<uint8_t> expected = from_hex(expected_hex);
+    std::vector<uint8_t> derived = PBKDF2::sha256(password, text(salt), iterations, expected.size());
+    check(name, derived == expected);
+
+    std::vector<uint8_t> salt_bytes = text(salt);
+    std::string verify_name = std::string(name) + " verify";
+    check(verify_name.c_str(), PBKDF2::verifySHA256(password, salt_bytes.data(), salt_bytes.size(), iterations, expected.data(), expected.size()));
+}
+
+// every lane of the batch must match the single password derivation
+static void check_batch(size_t password_count, size_t output_len)
+{
+    std::vector<std::string> passwords;
+    for (size_t i = 0; i < password_count; i++)
+        passwords.push_back("candidate-" + std::to_string(i * 7919));
+
+    std::vector<uint8_t> salt = text("batch salt");
+    std::vector<std::vector<uint8_t>> outputs;
+    PBKDF2::sha256Batch(passwords, salt.data(), salt.size(), 37, output_len, &outputs);
+
+    bool ok = outputs.size() == password_count;
+    for (size_t i = 0; ok && i < password_count; i++)
+        ok = outputs[i] == PBKDF2::sha256(passwords[i], salt, 37, output_len);
+
+    char name[64];
+    snprintf(name, sizeof(name), "batch of %d, %d bytes", (int)password_count, (int)output_len);
+    check(name, ok);
+}
+
+int main()
+{
+    // RFC 7914 section 11
+    check_vector("rfc7914 passwd/salt c=1", "passwd", "salt", 1,
+                 "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+                 "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783");
+    check_vector("rfc7914 Password/NaCl c=80000", "Password", "NaCl", 80000,
+                 "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56"
+                 "a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d");
+
+    check_vector("password/salt c=4096", "password", "salt", 4096,
+                 "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+
+    // one lane, the 4 and 8 lane paths and a mix of both
+    check_batch(1, 32);
+    check_batch(3, 32);
+    check_batch(8, 32);
+    check_batch(9, 32);
+    check_batch(3, 80);
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+#include <InteractiveToolkit-Extension/image/BlockCompression.h>
+#include <InteractiveToolkit-Extension/image/Resample.h>
+#include <InteractiveToolkit-Extension/io/AdvancedWriter.h>
+#include <InteractiveToolkit-Extension/io/AdvancedReader.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+using namespace ITKExtension::Image;
+
+static int failures = 0;
+
+static void check(const char *name, bool ok)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+        failures++;
+}
+
+// smooth gradients with some noise, the sizes used are not multiple of 4 to cover the border padding
+static std::vector<uint8_t> make_image(int w, int h, bool opaque)
+{
+    std::vector<uint8_t> result((size_t)w * h * 4);
+    srand(7);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            for (int c = 0; c < 4; c++)
+            {
+                double v = 128.0 + 100.0 * sin(x * 0.05 + c * 1.7) * cos(y * 0.04 + c) + (rand() % 8);
+                result[((size_t)y * w + x) * 4 + c] = (uint8_t)(v < 0.0 ? 0.0 : (v > 255.0 ? 255.0 : v));
+            }
+    if (opaque)
+        for (size_t i = 3; i < result.size(); i += 4)
+            result[i] = 255;
+    return result;
+}
+
+static void check_psnr(const char *name, BlockCompression::Format format, BlockCompression::Quality quality, double min_psnr)
+{
+    const int w = 126, h = 98;
+    // BC1 turns pixels with alpha < 128 into transparent black, keep it out of the color error
+    std::vector<uint8_t> image = make_image(w, h, format == BlockCompression::Format::BC1);
+
+    std::vector<uint8_t> blocks(BlockCompression::compressedSize(format, w, h));
+    std::vector<uint8_t> decoded((size_t)w * h * 4);
+    bool ok = BlockCompression::encode(image.data(), w, h, w * 4, format, blocks.data(), quality, 2) &&
+              BlockCompression::decode(blocks.data(), w, h, format, decoded.data(), w * 4);
+
+    double psnr = ok ? BlockCompression::psnr(format, image.data(), w * 4, decoded.data(), w * 4, w, h) : 0.0;
+    char full_name[128];
+    snprintf(full_name, sizeof(full_name), "%s psnr %.2f dB >= %.1f", name, psnr, min_psnr);
+    check(full_name, ok && psnr >= min_psnr);
+}
+
+int main()
+{
+    check("bc1 block size", BlockCompression::blockSize(BlockCompression::Format::BC1) == 8);
+    check("bc7 block size", BlockCompression::blockSize(BlockCompression::Format::BC7) == 16);
+    check("compressed size rounds up to blocks", BlockCompression::compressedSize(BlockCompression::Format::BC3, 5, 9) == 2 * 3 * 16);
+
+    // encode -> decode quality
+    check_psnr("bc1 normal", BlockCompression::Format::BC1, BlockCompression::Quality::Normal, 35.0);
+    check_psnr("bc3 normal", BlockCompression::Format::BC3, BlockCompression::Quality::Normal, 36.0);
+    check_psnr("bc4 normal", BlockCompression::Format::BC4, BlockCompression::Quality::Normal, 48.0);
+    check_psnr("bc5 normal", BlockCompression::Format::BC5, BlockCompression::Quality::Normal, 48.0);
+    check_psnr("bc7 normal", BlockCompression::Format::BC7, BlockCompression::Quality::Normal, 37.0);
+    check_psnr("bc1 fast", BlockCompression::Format::BC1, BlockCompression::Quality::Fast, 34.0);
+    check_psnr("bc7 high", BlockCompression::Format::BC7, BlockCompression::Quality::High, 37.0);
+
+    // CompressedTexture write -> read
+    {
+        const int w = 37, h = 21;
+        std::vector<uint8_t> image = make_image(w, h, false);
+        auto chain = Resample::generateMipChain(image.data(), w, h, w * 4, 4);
+
+        CompressedTexture texture;
+        bool ok = texture.encode(chain, 4, BlockCompression::Format::BC7, BlockCompression::Quality::Fast, 1, false);
+        check("texture encode", ok && texture.levels.size() == chain.size());
+
+        ITKExtension::IO::AdvancedWriter writer;
+        texture.write(&writer);
+        Platform::ObjectBuffer buffer;
+        writer.writeToBuffer(&buffer, false);
+
+        ITKExtension::IO::AdvancedReader reader;
+        reader.readFromBuffer(buffer, false);
+        CompressedTexture loaded;
+        loaded.read(&reader);
+
+        bool same = loaded.format == texture.format &&
+                    loaded.srgb == texture.srgb &&
+                    loaded.levels.size() == texture.levels.size();
+        for (size_t i = 0; same && i < texture.levels.size(); i++)
+            same = loaded.levels[i].w == texture.levels[i].w &&
+                   loaded.levels[i].h == texture.levels[i].h &&
+                   loaded.levels[i].blocks == texture.levels[i].blocks;
+        check("texture write/read round trip", same);
+    }
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include <InteractiveToolkit-Extension/image/Image.h>
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/Allocator.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace ITKExtension::Image;
+
+static int failures = 0;
+
+static void check(const char *name, bool ok)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+        failures++;
+}
+
+// 13x5 1 bit grayscale, the pixel (x, y) is white when x + y is odd
+static const uint8_t gray_1bit_png[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x0d, 0x00, 0x00, 0x00, 0x05,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0xb6, 0xc3, 0x5b, 0xbc, 0x00, 0x00, 0x00,
+    0x11, 0x49, 0x44, 0x41, 0x54, 0x08, 0x99, 0x63, 0x08, 0x0d, 0x60, 0x58,
+    0xb5, 0x82, 0x01, 0x46, 0x02, 0x00, 0x22, 0x67, 0x04, 0x94, 0x6f, 0x74,
+    0xec, 0x69, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42,
+    0x60, 0x82};
+
+static bool is_checker(const Image &image, int x0, int y0)
+{
+    for (int y = 0; y < image.h; y++)
+        for (int x = 0; x < image.w; x++)
+            if (image.row(y)[x] != (((x0 + x + y0 + y) & 1) ? 255 : 0))
+                return false;
+    return true;
+}
+
+// palette indices written at 1, 2 and 4 bits must decode to the same indices
+static void check_palette(int palette_size)
+{
+    const int w = 11, h = 7;
+    std::vector<uint8_t> indices((size_t)w * h);
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = (uint8_t)((i * 7) % palette_size);
+    std::vector<uint8_t> palette((size_t)palette_size * 4);
+    for (size_t i = 0; i < palette.size(); i++)
+        palette[i] = (uint8_t)(i * 13);
+
+    int png_size = 0;
+    char *png = PNG::writePNGIndexedToMemory(&png_size, w, h, indices.data(), palette.data(), palette_size);
+    Image image = decode((const uint8_t *)png, (size_t)png_size);
+    PNG::closePNG(png);
+
+    bool ok = !image.empty() && image.w == w && image.h == h && image.chann == 1 && image.pixel_depth == 8;
+    for (int y = 0; ok && y < h; y++)
+        ok = memcmp(image.row(y), &indices[(size_t)y * w], w) == 0;
+
+    char name[64];
+    snprintf(name, sizeof(name), "decode palette of %d", palette_size);
+    check(name, ok);
+}
+
+int main()
+{
+    // 1 bit gray is unpacked to 8 bits
+    {
+        Image image = decode(gray_1bit_png, sizeof(gray_1bit_png));
+        check("decode 1 bit gray", !image.empty() && image.w == 13 && image.h == 5 &&
+                                       image.chann == 1 && image.pixel_depth == 8 &&
+                                       image.stride == 13 && image.pixelBytes() == 1);
+        check("1 bit gray levels", !image.empty() && is_checker(image, 0, 0));
+
+        Image cropped = image.crop(3, 1, 6, 3);
+        check("crop of the unpacked image", !cropped.empty() && is_checker(cropped, 3, 1));
+
+        Image copy = Image::Create(13, 5, 3);
+        check("copy to RGB", image.copyTo(copy) && copy.row(0)[1 * 3] == 255 && copy.row(0)[3 * 3 + 2] == 255 && copy.row(0)[4 * 3] == 0);
+
+        // with an odd number of rows the flip keeps the same checker
+        Image flipped = decode(gray_1bit_png, sizeof(gray_1bit_png), true);
+        check("decode 1 bit gray inverted", !flipped.empty() && is_checker(flipped, 0, 0));
+    }
+
+    check_palette(2);
+    check_palette(4);
+    check_palette(16);
+    check_palette(200);
+
+    // packed buffers are not taken as 8 bits images
+    {
+        char *buffer = (char *)allocBuffer(16);
+        check("FromBuffer rejects 1 bit", Image::FromBuffer(buffer, 13, 5, 1, 1).empty());
+    }
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include <InteractiveToolkit-Extension/image/ProgressiveDecoder.h>
+#include <InteractiveToolkit-Extension/image/PNG.h>
+#include <InteractiveToolkit-Extension/image/JPG.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+using namespace ITKExtension::Image;
+
+static int failures = 0;
+
+static void check(const char *name, bool ok)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+        failures++;
+}
+
+// smooth gradients with some noise
+static std::vector<char> make_image(int w, int h, int chann)
+{
+    std::vector<char> result((size_t)w * h * chann);
+    srand(7);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            for (int c = 0; c < chann; c++)
+            {
+                double v = 128.0 + 90.0 * sin(x * 0.05 + c * 1.7) * cos(y * 0.04 + c) + (rand() % 16);
+                result[((size_t)y * w + x) * chann + c] = (char)(uint8_t)(v < 0.0 ? 0.0 : (v > 255.0 ? 255.0 : v));
+            }
+    return result;
+}
+
+static bool same_pixels(const Image &a, const Image &b)
+{
+    if (a.empty() || b.empty() || a.w != b.w || a.h != b.h || a.chann != b.chann || a.pixel_depth != b.pixel_depth)
+        return false;
+    for (int y = 0; y < a.h; y++)
+        if (memcmp(a.row(y), b.row(y), a.rowBytes()) != 0)
+            return false;
+    return true;
+}
+
+// feeds the compressed data in chunk_size pieces, the result must match the one shot decode
+static void check_chunks(const char *name, const char *compressed, int compressed_size, size_t chunk_size, bool invertY)
+{
+    Image expected = decode((const uint8_t *)compressed, (size_t)compressed_size, invertY);
+
+    ProgressiveDecoder decoder(invertY);
+    bool ok = true;
+    for (size_t pos = 0; ok && pos < (size_t)compressed_size; pos += chunk_size)
+    {
+        size_t size = (size_t)compressed_size - pos;
+        if (size > chunk_size)
+            size = chunk_size;
+        ok = decoder.append(compressed + pos, size);
+    }
+
+    char full_name[128];
+    snprintf(full_name, sizeof(full_name), "%s, %d byte chunks%s", name, (int)chunk_size, invertY ? ", invertY" : "");
+    check(full_name, ok && !decoder.hasError() && decoder.isComplete() &&
+                         decoder.getUpdateCount() > 0 && same_pixels(decoder.image(), expected));
+}
+
+int main()
+{
+    const int w = 75, h = 53;
+
+    {
+        std::vector<char> image = make_image(w, h, 4);
+        int size = 0;
+        char *png = PNG::writePNGToMemory(&size, w, h, 4, image.data());
+        check_chunks("png rgba", png, size, 1, false);
+        check_chunks("png rgba", png, size, 37, false);
+        check_chunks("png rgba", png, size, 4096, true);
+        PNG::closePNG(png);
+    }
+
+    {
+        std::vector<char> image = make_image(w, h, 1);
+        int size = 0;
+        char *png = PNG::writePNGToMemory(&size, w, h, 1, image.data());
+        check_chunks("png gray", png, size, 64, false);
+        PNG::closePNG(png);
+    }
+
+    {
+        std::vector<char> image = make_image(w, h, 3);
+        int size = 0;
+        char *jpg = JPG::writeJPGToMemory(&size, w, h, 3, image.data(), 90);
+        check_chunks("jpg rgb", jpg, size, 1, false);
+        check_chunks("jpg rgb", jpg, size, 37, false);
+        check_chunks("jpg rgb", jpg, size, 4096, true);
+        JPG::closeJPG(jpg);
+    }
+
+    {
+        std::vector<char> image = make_image(w, h, 1);
+        int size = 0;
+        char *jpg = JPG::writeJPGToMemory(&size, w, h, 1, image.data(), 90);
+        check_chunks("jpg gray", jpg, size, 64, false);
+        JPG::closeJPG(jpg);
+    }
+
+    // a truncated stream is not complete
+    {
+        std::vector<char> image = make_image(w, h, 3);
+        int size = 0;
+        char *jpg = JPG::writeJPGToMemory(&size, w, h, 3, image.data(), 90);
+        ProgressiveDecoder decoder;
+        bool ok = decoder.append(jpg, (size_t)size / 2);
+        check("jpg half stream", ok && decoder.hasHeader() && !decoder.isComplete() &&
+                                     decoder.image().w == w && decoder.image().h == h);
+        JPG::closeJPG(jpg);
+    }
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <InteractiveToolkit-Extension/random/ChaCha20.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace ITKExtension::Random;
+
+static int failures = 0;
+
+static std::vector<uint8_t> from_hex(const char *hex)
+{
+    std::vector<uint8_t> result;
+    for (size_t i = 0; hex[i] != 0 && hex[i + 1] != 0; i += 2)
+    {
+        unsigned int v;
+        sscanf(&hex[i], "%2x", &v);
+        result.push_back((uint8_t)v);
+    }
+    return result;
+}
+
+static void check(const char *name, const uint8_t *result, size_t size, const char *expected_hex)
+{
+    std::vector<uint8_t> expected = from_hex(expected_hex);
+    if (expected.size() != size || memcmp(result, expected.data(), size) != 0)
+    {
+        printf("FAIL %s\n", name);
+        failures++;
+    }
+    else
+        printf("ok   %s\n", name);
+}
+
+static void check(const char *name, bool ok)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+        failures++;
+}
+
+int main()
+{
+    uint8_t key[32];
+    for (int i = 0; i < 32; i++)
+        key[i] = (uint8_t)i;
+
+    // RFC 7539 2.3.2: block function
+    {
+        std::vector<uint8_t> nonce = from_hex("000000090000004a00000000");
+        ChaCha20 chacha;
+        chacha.setKey(key, nonce.data(), 1);
+        uint8_t block[64];
+        chacha.block(block);
+        check("rfc7539 2.3.2 block", block, 64,
+              "10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+              "d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e");
+    }
+
+    // RFC 7539 A.1 test vector #1: all zero key and nonce, counter 0
+    {
+        uint8_t zero_key[32] = {0};
+        uint8_t zero_nonce[12] = {0};
+        ChaCha20 chacha;
+        chacha.setKey(zero_key, zero_nonce, 0);
+        uint8_t block[64];
+        chacha.block(block);
+        check("rfc7539 A.1 #1 block", block, 64,
+              "76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7"
+              "da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586");
+    }
+
+    // RFC 7539 2.4.2: the keystream XORed with the plaintext gives the ciphertext
+    {
+        const char *plaintext = "Ladies and Gentlemen of the class of '99: If I could offer you "
+                                "only one tip for the future, sunscreen would be it.";
+        size_t len = strlen(plaintext);
+        std::vector<uint8_t> nonce = from_hex("000000000000004a00000000");
+        ChaCha20 chacha;
+        chacha.setKey(key, nonce.data(), 1);
+        std::vector<uint8_t> ciphertext(len);
+        chacha.keystream(ciphertext.data(), len);
+        for (size_t i = 0; i < len; i++)
+            ciphertext[i] ^= (uint8_t)plaintext[i];
+        check("rfc7539 2.4.2 keystream", ciphertext.data(), len,
+              "6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0b"
+              "f91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f530c359f0861d8"
+              "07ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736"
+              "5af90bbf74a35be6b40b8eedf2785e42874d");
+    }
+
+    // block() advances the counter the same way keystream() does
+    {
+        std::vector<uint8_t> nonce = from_hex("000000090000004a00000000");
+        ChaCha20 a, b;
+        a.setKey(key, nonce.data(), 1);
+        b.setKey(key, nonce.data(), 1);
+        uint8_t blocks[192], stream[192];
+        for (int i = 0; i < 3; i++)
+            a.block(&blocks[i * 64]);
+        b.keystream(stream, sizeof(stream));
+        check("block and keystream agree", memcmp(blocks, stream, sizeof(blocks)) == 0);
+    }
+
+    if (failures > 0)
+        printf("%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}